@@ -0,0 +1,27 @@
+#ifndef BITMAP_FONT_H
+#define BITMAP_FONT_H
+
+#include <cstdint>
+
+/*
+Built-in 5x7 bitmap font, shared by the software rasterizer (software_renderer.h) and
+the glyph atlas of the grid view (grid_view.h), so neither needs a font file. It covers
+the characters the HUD uses; every other character is drawn as a blank.
+*/
+#define FONT_GLYPH_WIDTH 5
+#define FONT_GLYPH_HEIGHT 7
+
+// One character of the built-in font, bit 4 of a row is its leftmost pixel
+struct Glyph
+{
+    char character;
+    uint8_t rows[FONT_GLYPH_HEIGHT];
+};
+
+extern const Glyph FONT_GLYPHS[];
+extern const uint32_t FONT_GLYPH_COUNT;
+
+// Function Prototypes
+const Glyph *find_glyph(char character);
+
+#endif /* BITMAP_FONT_H */
@@ -0,0 +1,24 @@
+#ifndef BOT_H
+#define BOT_H
+
+#include <cstdint>
+#include "./tetris.h"
+
+/*
+Greedy bot: tries every placement of the current piece (placement.h) and keeps the one
+leaving the best board. Boards are scored with integer weights (per mille) on the
+aggregate column height, cleared lines, holes and bumpiness, so the choice is
+bit-exact on every machine. The bot only looks at the current piece.
+*/
+#define BOT_WEIGHT_HEIGHT -510
+#define BOT_WEIGHT_LINES 760
+#define BOT_WEIGHT_HOLES -356
+#define BOT_WEIGHT_BUMPINESS -184
+#define BOT_GAME_OVER_SCORE INT32_MIN
+
+// Function Prototypes
+int32_t evaluate_board(const GameState *game, int32_t lineCount);
+bool choose_placement(const GameState *game, PieceState *best, int32_t *bestScore);
+uint64_t get_bot_fingerprint();
+
+#endif /* BOT_H */
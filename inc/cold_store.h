@@ -0,0 +1,41 @@
+#ifndef COLD_STORE_H
+#define COLD_STORE_H
+
+#include <cstdint>
+#include <vector>
+#include "./packed_state.h"
+
+#define COLD_STORE_GROWTH_SLOTS 65536 // Slots added to the backing file whenever it is full
+
+/*
+One packed game in the backing file. Slots are exactly one cache line (and 64 slots
+one page) so paging a game in or out touches a single line of the mapping.
+*/
+struct ColdSlot
+{
+    PackedGameState state;
+    uint32_t sessionId; // Owner of the slot, 0 when the slot is free
+};
+static_assert(sizeof(ColdSlot) == 64, "cold slots are one cache line");
+
+/*
+Memory-mapped file holding the packed games of idle sessions. Not thread safe: the
+game server opens one store per worker.
+*/
+struct ColdStore
+{
+    int32_t fd;
+    ColdSlot *slots; // Mapping of the whole backing file
+    uint32_t capacity;
+    uint32_t used;
+    std::vector<uint32_t> freeSlots;
+};
+
+// Function Prototypes
+bool open_cold_store(ColdStore *store, const char *path);
+void close_cold_store(ColdStore *store);
+int64_t page_out_game(ColdStore *store, uint32_t sessionId, const GameState *game);
+bool page_in_game(ColdStore *store, uint32_t slot, uint32_t sessionId, GameState *game);
+void free_cold_slot(ColdStore *store, uint32_t slot, uint32_t sessionId);
+
+#endif /* COLD_STORE_H */
@@ -32,7 +32,8 @@ const Color BASE_COLORS[] = {
     color(0x2D, 0x99, 0x51, 0xFF),
     color(0x99, 0x2D, 0x2D, 0xFF),
     color(0x2D, 0x63, 0x99, 0xFF),
-    color(0x99, 0x63, 0x2D, 0xFF)
+    color(0x99, 0x63, 0x2D, 0xFF),
+    color(0x63, 0x63, 0x63, 0xFF) // Garbage rows of versus matches (versus.h)
 };
 
 const Color LIGHT_COLORS[] = {
@@ -43,7 +44,8 @@ const Color LIGHT_COLORS[] = {
     color(0x44, 0xE5, 0x7A, 0xFF),
     color(0xE5, 0x44, 0x44, 0xFF),
     color(0x44, 0x95, 0xE5, 0xFF),
-    color(0xE5, 0x95, 0x44, 0xFF)
+    color(0xE5, 0x95, 0x44, 0xFF),
+    color(0x95, 0x95, 0x95, 0xFF)
 };
 
 const Color DARK_COLORS[] = {
@@ -54,7 +56,8 @@ const Color DARK_COLORS[] = {
     color(0x1E, 0x66, 0x36, 0xFF),
     color(0x66, 0x1E, 0x1E, 0xFF),
     color(0x1E, 0x42, 0x66, 0xFF),
-    color(0x66, 0x42, 0x1E, 0xFF)
+    color(0x66, 0x42, 0x1E, 0xFF),
+    color(0x42, 0x42, 0x42, 0xFF)
 };
 
 #endif /*COLOR_H*/
\ No newline at end of file
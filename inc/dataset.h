@@ -0,0 +1,159 @@
+#ifndef DATASET_H
+#define DATASET_H
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "./tetris.h"
+
+/*
+Columnar dataset of bot decisions, one row per locked piece: the board before the lock,
+the piece, where it was placed, what the lock cleared and scored, and which game and
+piece of the run it was.
+
+Every column is fixed width (DATASET_COLUMN_WIDTHS), so row r of a column is
+bytes [r * width, (r + 1) * width) once its block is decoded. Rows are grouped in
+blocks of up to DATASET_BLOCK_ROWS, and each column of a block is compressed on its
+own:
+- every value is XORed with the value of the previous row of the block,
+- the bytes are transposed so byte b of every value is stored together,
+- runs of zero bytes are run-length encoded (see encode_dataset_column()).
+A column that does not shrink is stored raw. Consecutive samples of a game share most
+of their board, so the board column shrinks the most.
+
+File layout: DatasetHeader, then the blocks (a DatasetBlockHeader followed by its column
+chunks, 8 byte aligned), then the block index (one DatasetIndexEntry per block) and a
+DatasetFooter at the very end. Blocks are written by several threads, in no particular
+order. A file without a footer (the writer was killed) is read by walking the blocks
+from the header.
+*/
+#define DATASET_MAGIC 0x54534454u // "TDST"
+#define DATASET_BLOCK_MAGIC 0x4B4C4254u // "TBLK"
+#define DATASET_VERSION 1
+#define DATASET_BLOCK_ROWS 4096
+#define DATASET_BOARD_BYTES ((GameState::BOARD_WIDTH * GameState::BOARD_HEIGHT + 7) / 8)
+
+enum DatasetColumn
+{
+    DATASET_COLUMN_BOARD,       // Occupancy before the lock, bit row * BOARD_WIDTH + col (as PackedGameState::board)
+    DATASET_COLUMN_TETROMINO,   // uint8_t tetrominoIndex
+    DATASET_COLUMN_ROTATION,    // uint8_t rotation of the placement
+    DATASET_COLUMN_COLUMN,      // int8_t offsetCol of the placement
+    DATASET_COLUMN_LINES,       // uint8_t lines cleared by the lock
+    DATASET_COLUMN_SCORE_DELTA, // int32_t score added by the lock
+    DATASET_COLUMN_GAME,        // uint64_t index of the game in the run
+    DATASET_COLUMN_PIECE,       // uint16_t index of the piece in the game
+    DATASET_COLUMN_COUNT
+};
+
+const uint32_t DATASET_COLUMN_WIDTHS[DATASET_COLUMN_COUNT] = {DATASET_BOARD_BYTES, 1, 1, 1, 1, 4, 8, 2};
+
+enum DatasetCodec
+{
+    DATASET_CODEC_RAW,
+    DATASET_CODEC_XOR_RLE
+};
+
+struct DatasetSample
+{
+    uint8_t board[DATASET_BOARD_BYTES];
+    uint8_t tetrominoIndex;
+    uint8_t rotation;
+    int8_t column;
+    uint8_t lineCount;
+    int32_t scoreDelta;
+    uint64_t game;
+    uint16_t piece;
+};
+
+struct DatasetHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t columnCount;
+    uint16_t boardWidth;
+    uint16_t boardHeight;
+    uint32_t blockRows;
+    uint32_t columnWidths[DATASET_COLUMN_COUNT];
+};
+
+struct DatasetChunk
+{
+    uint32_t offset; // From the start of the block
+    uint32_t size;   // Encoded size in bytes
+    uint32_t codec;  // DatasetCodec
+};
+
+struct DatasetBlockHeader
+{
+    uint32_t magic;
+    uint32_t rowCount;
+    uint32_t size; // Of the whole block including this header and its padding
+    DatasetChunk chunks[DATASET_COLUMN_COUNT];
+};
+
+struct DatasetIndexEntry
+{
+    uint64_t offset;   // Of the block in the file
+    uint64_t firstRow; // Rows in the blocks before it
+    uint32_t rowCount;
+    uint32_t reserved;
+};
+
+struct DatasetFooter
+{
+    uint64_t indexOffset;
+    uint64_t blockCount;
+    uint64_t rowCount;
+    uint32_t magic;
+    uint32_t reserved;
+};
+
+// Rows collected by one thread until the block is full and written out
+struct DatasetBlock
+{
+    uint32_t rowCount;
+    std::vector<uint8_t> columns[DATASET_COLUMN_COUNT]; // Raw fixed width values
+    std::vector<uint8_t> encoded;                       // Scratch of the block being written
+    std::vector<uint8_t> transposed;
+};
+
+struct DatasetWriter
+{
+    int32_t fd;
+    std::mutex mutex; // Serializes the appends of blocks
+    uint64_t offset;  // End of the written blocks
+    uint64_t rowCount;
+    std::vector<DatasetIndexEntry> index;
+    bool failed; // A write failed, the file is unusable
+};
+
+struct DatasetReader
+{
+    const uint8_t *data; // Mapping of the whole file
+    size_t size;
+    const DatasetHeader *header;
+    std::vector<DatasetIndexEntry> blocks;
+    uint64_t rowCount;
+};
+
+// Function Prototypes
+void pack_dataset_board(const GameState *game, uint8_t *board);
+size_t encode_dataset_column(const uint8_t *values, uint32_t rowCount, uint32_t width, uint8_t *transposed, uint8_t *encoded);
+bool decode_dataset_column(const uint8_t *encoded, size_t size, uint32_t rowCount, uint32_t width, uint8_t *transposed, uint8_t *values);
+
+bool open_dataset_writer(DatasetWriter *writer, const char *path);
+void init_dataset_block(DatasetBlock *block);
+void add_dataset_sample(DatasetWriter *writer, DatasetBlock *block, const DatasetSample *sample);
+void get_dataset_sample(const DatasetBlock *block, uint32_t row, DatasetSample *sample);
+void flush_dataset_block(DatasetWriter *writer, DatasetBlock *block);
+bool copy_dataset_block(DatasetWriter *writer, const DatasetReader *reader, uint32_t block);
+bool sync_dataset_writer(DatasetWriter *writer);
+bool close_dataset_writer(DatasetWriter *writer);
+
+bool open_dataset(DatasetReader *reader, const char *path);
+void close_dataset(DatasetReader *reader);
+uint32_t find_dataset_block(const DatasetReader *reader, uint64_t row);
+bool read_dataset_column(const DatasetReader *reader, uint32_t block, DatasetColumn column, uint8_t *values);
+
+#endif /* DATASET_H */
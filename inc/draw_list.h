@@ -0,0 +1,40 @@
+#ifndef DRAW_LIST_H
+#define DRAW_LIST_H
+
+#include <cstdint>
+#include <vector>
+#include "./tetris.h"
+#include "./render_snapshot.h"
+
+/*
+Backend-agnostic layout of a frame. build_draw_list() turns a RenderSnapshot into a list
+of rectangles and strings, which the SDL window (main.cpp) and the software rasterizer
+(software_renderer.h) both execute, so both draw the same layout.
+*/
+#define WINDOW_HEIGHT 720
+#define BOARD_PADDING_Y 60
+#define DRAW_TEXT_LENGTH 48
+
+enum DrawCommandKind
+{
+    DRAW_FILL_RECT,
+    DRAW_OUTLINE_RECT,
+    DRAW_TEXT
+};
+
+struct DrawCommand
+{
+    DrawCommandKind kind;
+    int32_t x;
+    int32_t y;
+    int32_t width;  // Rectangles only
+    int32_t height; // Rectangles only
+    Color color;
+    TextAlign alignment;          // Text only
+    char text[DRAW_TEXT_LENGTH]; // Text only, NUL terminated
+};
+
+// Function Prototypes
+template <typename Game> void build_draw_list(const RenderSnapshot<Game> *snapshot, std::vector<DrawCommand> *commands);
+
+#endif /* DRAW_LIST_H */
@@ -0,0 +1,79 @@
+#ifndef EVAL_CACHE_H
+#define EVAL_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include "./tetris.h"
+
+/*
+Persistent cache of bot decisions (bot.h): board occupancy plus the current piece map to
+the placement the bot chose and its score. It is a memory-mapped open addressing hash
+table shared by every process that opens the file, so bot and analysis runs skip the
+early-game and common boards that earlier runs have already evaluated.
+
+Entries are one cache line and are never modified or removed once published, so
+inserts are lock-free and lookups need no synchronisation beyond the tag:
+- A writer claims an empty slot by a compare-and-swap of its tag from 0 to
+  hash | EVAL_CACHE_WRITING, fills in the entry, then stores hash | EVAL_CACHE_READY.
+- A reader only trusts an entry whose tag is READY, and compares the full key, so a hash
+  collision is never mistaken for a hit.
+A slot claimed by a writer that crashed before publishing stays unused. When the
+EVAL_CACHE_PROBES slots after the home slot are taken, the insert is dropped.
+
+File layout: EvalCacheHeader padded to one entry, then capacity EvalCacheEntries. The
+capacity is fixed when the file is created. A cache only opens for a bot with the
+fingerprint it was created for, so changing the weights or the placement rules starts
+a new cache instead of replaying stale decisions.
+*/
+#define EVAL_CACHE_MAGIC 0x4C564554u // "TEVL"
+#define EVAL_CACHE_VERSION 4
+#define EVAL_CACHE_DEFAULT_CAPACITY (1u << 20) // Entries of a new cache, 64 MB
+#define EVAL_CACHE_PROBES 16
+#define EVAL_CACHE_WRITING 1ull // Low bits of a tag
+#define EVAL_CACHE_READY 2ull
+
+struct alignas(64) EvalCacheEntry
+{
+    std::atomic<uint64_t> tag; // 0 while empty, else the hash (low bits cleared) | state
+    GameState::RowMask rows[GameState::BOARD_HEIGHT];
+    uint8_t tetrominoIndex; // Current piece, the placements reachable depend on where it is
+    uint8_t rotation;
+    int8_t offsetRow;
+    int8_t offsetCol;
+    uint8_t bestRotation; // Chosen placement of the piece
+    int8_t bestOffsetRow;
+    int8_t bestOffsetCol;
+    uint8_t found; // 0 when the piece has no placement
+    int32_t score;
+};
+static_assert(sizeof(EvalCacheEntry) == 64, "cache entries are one cache line");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "tags are shared between processes");
+
+struct EvalCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t boardWidth;
+    uint32_t boardHeight;
+    uint32_t entrySize; // sizeof(EvalCacheEntry)
+    uint32_t capacity;  // Power of two
+    uint64_t botFingerprint; // get_bot_fingerprint() of the bot whose decisions are stored
+};
+
+struct EvalCache
+{
+    int32_t fd;
+    EvalCacheHeader *header; // Mapping of the whole file
+    EvalCacheEntry *entries;
+    uint32_t mask; // capacity - 1
+    bool readOnly;
+};
+
+// Function Prototypes
+bool open_eval_cache(EvalCache *cache, const char *path, bool readOnly, uint32_t capacity);
+void close_eval_cache(EvalCache *cache);
+bool find_eval_cache(const EvalCache *cache, const GameState *game, PieceState *best, int32_t *score, bool *found);
+bool insert_eval_cache(EvalCache *cache, const GameState *game, const PieceState *best, int32_t score, bool found);
+uint32_t count_eval_cache(const EvalCache *cache);
+
+#endif /* EVAL_CACHE_H */
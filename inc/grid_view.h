@@ -0,0 +1,74 @@
+#ifndef GRID_VIEW_H
+#define GRID_VIEW_H
+
+#include <cstdint>
+#include <vector>
+#include "./tetris.h"
+#include "./render_snapshot.h"
+#include "./bitmap_font.h"
+
+/*
+Spectator wall: many games tiled in one window, each laid out like render_game() at a
+cell size picked to fit the window.
+
+Instead of a draw list executed rectangle by rectangle, the whole wall is built into one
+triangle list (GridGeometry) drawn with a single textured geometry call. The texture is
+a glyph atlas holding the built-in font (bitmap_font.h) and one white texel: rectangles
+sample the white texel and take the color of their vertices, HUD characters sample
+their glyph. Drawing order is the order of the triangles, so one call keeps the layering
+of render_game(). Empty cells are covered by one background rectangle per board, so the
+cost of a board grows with its filled cells only.
+*/
+#define GRID_VIEW_MAX_BOARDS 64
+#define GRID_VIEW_WINDOW_WIDTH 1920
+#define GRID_VIEW_WINDOW_HEIGHT 1080
+#define GRID_VIEW_GAP 6        // Pixels around every board
+#define GRID_VIEW_TEXT_LINES 2 // HUD lines above every board
+#define GRID_VIEW_TEXT_LENGTH 24
+#define GLYPH_ATLAS_COLUMNS 8
+
+// Same layout as SDL_Vertex, so the SDL window passes the geometry through as is
+struct GridVertex
+{
+    float x;
+    float y;
+    Color color;
+    float u;
+    float v;
+};
+
+struct GridGeometry
+{
+    std::vector<GridVertex> vertices;
+    std::vector<int32_t> indices; // Two triangles per rectangle
+};
+
+// RGBA32 texture of the built-in font, white glyphs on transparent texels
+struct GlyphAtlas
+{
+    int32_t width;
+    int32_t height;
+    std::vector<uint8_t> pixels;
+    int16_t cells[128]; // Atlas cell of every ASCII character, -1 for a blank
+    int16_t solidCell;  // Cell filled with white texels
+};
+
+struct GridLayout
+{
+    int32_t boardCount;
+    int32_t columns;
+    int32_t rows;
+    int32_t cellSize;   // Size of a board cell in pixels
+    int32_t textScale;  // Pixels per font pixel
+    int32_t tileWidth;  // Pixels taken by a board, its HUD and the gap
+    int32_t tileHeight;
+    int32_t originX;    // Top left corner of the first tile, centering the grid in the window
+    int32_t originY;
+};
+
+// Function Prototypes
+void init_glyph_atlas(GlyphAtlas *atlas);
+template <typename Game> void layout_grid(int32_t boardCount, int32_t width, int32_t height, GridLayout *layout);
+template <typename Game> void build_grid_geometry(const RenderSnapshot<Game> *const *snapshots, const GridLayout *layout, const GlyphAtlas *atlas, GridGeometry *geometry);
+
+#endif /* GRID_VIEW_H */
@@ -0,0 +1,109 @@
+#ifndef LEADERBOARD_H
+#define LEADERBOARD_H
+
+#include <cstdint>
+#include <ctime>
+#include "./tetris.h"
+
+/*
+Persistent high scores kept in two files:
+
+<path>.log - append-only array of LeaderboardEntry, the source of truth
+<path>.idx - memory-mapped B+tree over the log ordered by score (highest first, earlier
+             entries first on ties). Branches keep the number of entries below each
+             child, so inserts, rank lookups and top-K queries are O(log n).
+
+Opening a leaderboard only maps the index. Entries appended to the log but missing from
+the index (a crash between the two writes) are indexed on open, and an index left half
+updated by a crash, or deleted, is rebuilt from the log.
+
+One process writes (flock LOCK_EX per insert) while any number of processes may query
+(flock LOCK_SH per query). A Leaderboard is not thread safe.
+*/
+#define LEADERBOARD_MAGIC 0x445242454C525454ull // "TTRLEBRD"
+#define LEADERBOARD_NODE_SIZE 4096
+#define LEADERBOARD_LEAF_KEYS 511
+#define LEADERBOARD_BRANCH_CHILDREN 204
+#define LEADERBOARD_GROWTH_NODES 1024 // Nodes (4 MB) added to the index whenever it is full
+
+// One finished game, as appended to the log
+struct LeaderboardEntry
+{
+    int32_t score;
+    int32_t level;
+    int32_t lineCount;
+    uint32_t playerId; // Session id on the game server, 0 for the local game
+    int64_t time;      // Unix time the game ended
+};
+static_assert(sizeof(LeaderboardEntry) == 24, "log entries are 24 bytes");
+
+/*
+Node of the index. Keys are (inverted score << 32 | log position), so ascending keys are
+descending scores and a key also locates its entry in the log.
+*/
+struct LeaderboardNode
+{
+    uint16_t isLeaf;
+    uint16_t count; // Keys of a leaf or children of a branch
+    uint32_t next;  // Leaf holding the next lower scores, 0 after the last leaf
+    union
+    {
+        uint64_t keys[LEADERBOARD_LEAF_KEYS];
+        struct
+        {
+            uint64_t separators[LEADERBOARD_BRANCH_CHILDREN - 1]; // separators[i] is the lowest key under children[i + 1]
+            uint64_t sizes[LEADERBOARD_BRANCH_CHILDREN];          // Entries under each child
+            uint32_t children[LEADERBOARD_BRANCH_CHILDREN];
+        } branch;
+    };
+};
+static_assert(sizeof(LeaderboardNode) == LEADERBOARD_NODE_SIZE, "index nodes are one page");
+
+// Stored in node 0 of the index
+struct LeaderboardHeader
+{
+    uint64_t magic;
+    uint32_t root;
+    uint32_t height;     // Levels of the tree, 1 while the root is a leaf
+    uint32_t nodeCount;  // Nodes in use including the header
+    uint32_t dirty;      // Set while an insert is modifying the tree
+    uint64_t entryCount; // Log entries indexed
+};
+
+struct Leaderboard
+{
+    int32_t logFd;
+    int32_t indexFd;
+    LeaderboardNode *nodes; // Mapping of the whole index, node 0 holds the LeaderboardHeader
+    uint32_t capacity;      // Nodes mapped
+    bool readOnly;
+};
+
+// Function Prototypes
+bool open_leaderboard(Leaderboard *board, const char *path, bool readOnly);
+void close_leaderboard(Leaderboard *board);
+int64_t record_score(Leaderboard *board, const LeaderboardEntry *entry);
+uint64_t get_leaderboard_size(Leaderboard *board);
+uint64_t get_score_rank(Leaderboard *board, int32_t score);
+uint32_t get_top_scores(Leaderboard *board, uint64_t firstRank, LeaderboardEntry *entries, uint32_t count);
+
+/**
+ * @brief Fills a leaderboard entry with the result of a finished game
+ *
+ * @param game - pointer to the game that just went over
+ * @param playerId - id of the player, 0 for the local game
+ * @return LeaderboardEntry - entry to be passed to record_score()
+ */
+template <typename Game>
+inline LeaderboardEntry make_leaderboard_entry(const Game *game, uint32_t playerId)
+{
+    LeaderboardEntry entry = {};
+    entry.score = game->score;
+    entry.level = game->level;
+    entry.lineCount = game->lineCount;
+    entry.playerId = playerId;
+    entry.time = static_cast<int64_t>(::time(NULL));
+    return entry;
+}
+
+#endif /* LEADERBOARD_H */
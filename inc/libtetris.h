@@ -0,0 +1,80 @@
+#ifndef LIBTETRIS_H
+#define LIBTETRIS_H
+
+#include <stdint.h>
+
+/*
+C ABI of libtetris.so, for linking the engine from other runtimes through FFI. Games are
+opaque handles. tetris_step_batch() and tetris_export_batch() work on many games per
+call and never allocate, so the per-call overhead is paid once per batch instead of
+once per game.
+
+A game starts on the start screen exactly like a game of the server, so the keys passed
+to tetris_step_batch() together with the seed form a replay (replay.h). Press
+TETRIS_KEY_A to start playing. The game runs at 60 frames per second of game time.
+*/
+#define TETRIS_ABI_VERSION 1
+
+#if defined(__GNUC__)
+#define TETRIS_API __attribute__((visibility("default")))
+#else
+#define TETRIS_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bits of an action, the keys held during one frame (same values as InputKey)
+enum
+{
+    TETRIS_KEY_LEFT = 1 << 0,
+    TETRIS_KEY_RIGHT = 1 << 1,
+    TETRIS_KEY_UP = 1 << 2,
+    TETRIS_KEY_DOWN = 1 << 3,
+    TETRIS_KEY_A = 1 << 4,
+    TETRIS_KEY_B = 1 << 5 // Rotates counter-clockwise, TETRIS_KEY_UP clockwise
+};
+
+// Phases of a game (same values as GamePhase)
+enum
+{
+    TETRIS_PHASE_START = 0,
+    TETRIS_PHASE_PLAY = 1,
+    TETRIS_PHASE_LINE = 2,
+    TETRIS_PHASE_GAMEOVER = 3
+};
+
+typedef struct TetrisGame TetrisGame;
+
+// Exported state of a game, everything but the board
+typedef struct TetrisState
+{
+    int32_t score;
+    int32_t level;
+    int32_t lineCount;
+    int32_t phase; // TETRIS_PHASE_*
+    uint32_t frame; // Frames stepped since the last reset
+    uint32_t randomState;
+    uint8_t tetrominoIndex;
+    uint8_t rotation;
+    int8_t offsetRow;
+    int8_t offsetCol;
+} TetrisState;
+
+TETRIS_API uint32_t tetris_abi_version(void);
+TETRIS_API int32_t tetris_board_width(void);
+TETRIS_API int32_t tetris_board_height(void);
+
+TETRIS_API TetrisGame *tetris_create(uint32_t seed);
+TETRIS_API void tetris_destroy(TetrisGame *game);
+TETRIS_API void tetris_reset(TetrisGame *game, uint32_t seed);
+
+TETRIS_API void tetris_step_batch(TetrisGame *const *games, const uint8_t *actions, uint32_t count);
+TETRIS_API void tetris_export_batch(TetrisGame *const *games, uint32_t count, TetrisState *states, uint8_t *boards);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBTETRIS_H */
@@ -0,0 +1,41 @@
+#ifndef PACKED_STATE_H
+#define PACKED_STATE_H
+
+#include <cstdint>
+#include "./tetris.h"
+
+/*
+Compact form of a GameState for hosting idle games. The board is kept as occupancy
+only (one bit per cell, rows packed back to back), so the colors of merged cells are
+lost: unpacked cells all get PACKED_CELL_VALUE. The lines scratch array and
+pendingLineCount are recomputed from the board, and the timers are stored as frame
+offsets from the current frame.
+*/
+#define PACKED_CELL_VALUE 1
+
+const int32_t PACKED_BOARD_BYTES = (GameState::BOARD_WIDTH * GameState::BOARD_HEIGHT + 7) / 8;
+
+#pragma pack(push, 1)
+struct PackedGameState
+{
+    uint8_t board[PACKED_BOARD_BYTES]; // Row masks of the board, BOARD_WIDTH bits each
+    uint32_t score;
+    uint32_t randomState;
+    uint32_t frame; // Current time in frames
+    uint16_t lineCount;
+    uint8_t level;
+    uint8_t startLevel;
+    int8_t offsetRow;
+    int8_t offsetCol;
+    uint8_t bits[3]; // tetrominoIndex:3 rotation:2 phase:2 dropFrames:7 (signed) highlightFrames:5
+};
+#pragma pack(pop)
+
+static_assert(GameState::BOARD_WIDTH <= 16, "packed rows are read through 16 bit masks");
+static_assert(sizeof(PackedGameState) < 64, "a packed game fits in one cache line");
+
+// Function Prototypes
+void pack_game_state(const GameState *game, PackedGameState *packed);
+void unpack_game_state(const PackedGameState *packed, GameState *game);
+
+#endif /* PACKED_STATE_H */
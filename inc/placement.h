@@ -0,0 +1,26 @@
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+#include <vector>
+#include "./tetris.h"
+
+/*
+Placements of a piece, the resting positions it can reach from the spawn position with
+the moves of update_game_play(): one column left or right, one rotation either way with
+its wall kicks (rotate_piece), or one soft drop. Gravity is ignored, so the player is
+assumed to have as many frames per row as needed. A resting position is one where a
+soft drop would lock the piece.
+
+Placements that cover the same cells are only listed once, e.g. the four rotations of
+the square. place_piece() then merges a placement and clears the filled lines the way
+the GAME_PHASE_LINE step does.
+*/
+
+#define PLACEMENT_VERSION 2 // Bumped whenever the placements reachable from a spawn change (2: wall kicks)
+
+// Function Prototypes
+template <typename Game> void init_spawn_piece(PieceState *piece, uint8_t tetrominoIndex);
+template <typename Game> void find_placements(const Game *game, const PieceState *spawn, std::vector<PieceState> *placements);
+template <typename Game> int32_t place_piece(Game *game, const PieceState *piece);
+
+#endif /* PLACEMENT_H */
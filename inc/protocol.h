@@ -0,0 +1,169 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <cstdint>
+#include "./tetris.h"
+
+/*
+Wire format shared by the game server and its clients. All messages are fixed size
+(apart from the optional board that follows a StateMessage and the changed rows that
+follow a SpectateHeader) and little endian.
+*/
+#define DEFAULT_SERVER_PORT 7777
+#define DEFAULT_SPECTATOR_PORT 7778
+
+enum MessageType
+{
+    MESSAGE_INPUT = 1,
+    MESSAGE_STATE = 2,
+    MESSAGE_WELCOME = 3,
+    MESSAGE_SUBSCRIBE = 4,
+    MESSAGE_ACK = 5,
+    MESSAGE_SPECTATE = 6,
+    MESSAGE_VERSUS_INPUT = 7
+};
+
+// Bits of the packed keys of an InputMessage
+enum InputKey
+{
+    INPUT_KEY_LEFT = 1 << 0,
+    INPUT_KEY_RIGHT = 1 << 1,
+    INPUT_KEY_UP = 1 << 2,
+    INPUT_KEY_DOWN = 1 << 3,
+    INPUT_KEY_A = 1 << 4,
+    INPUT_KEY_B = 1 << 5
+};
+
+#pragma pack(push, 1)
+
+// Client -> server: keys held during one client frame
+struct InputMessage
+{
+    uint8_t type; // MESSAGE_INPUT
+    uint8_t keys; // InputKey bits
+};
+
+// Server -> client: state of the session after one server frame
+struct StateMessage
+{
+    uint8_t type;  // MESSAGE_STATE
+    uint8_t phase; // GamePhase
+    uint8_t tetrominoIndex;
+    uint8_t rotation;
+    int8_t offsetRow;
+    int8_t offsetCol;
+    uint8_t boardIncluded; // 1 when WIDTH * HEIGHT board bytes follow this message
+    uint8_t reserved;
+    uint32_t frame;
+    int32_t level;
+    int32_t lineCount;
+    int32_t score;
+};
+
+// Server -> client: first message of a player connection
+struct WelcomeMessage
+{
+    uint8_t type; // MESSAGE_WELCOME
+    uint32_t sessionId;
+};
+
+// Spectator -> server: first message of a spectator connection
+struct SubscribeMessage
+{
+    uint8_t type; // MESSAGE_SUBSCRIBE
+    uint32_t sessionId;
+};
+
+// Spectator -> server: the newest frame the spectator has decoded
+struct AckMessage
+{
+    uint8_t type; // MESSAGE_ACK
+    uint32_t frame;
+};
+
+/*
+Server -> spectator: the state of a game in one frame, encoded against the last frame
+the spectator acknowledged (baseFrame). Every row set in changedRows is followed by its
+BOARD_WIDTH bytes, from the top row down. A keyframe has baseFrame 0 and all rows set.
+*/
+struct SpectateHeader
+{
+    uint8_t type;  // MESSAGE_SPECTATE
+    uint8_t phase; // GamePhase
+    uint8_t tetrominoIndex;
+    uint8_t rotation;
+    int8_t offsetRow;
+    int8_t offsetCol;
+    uint16_t length; // Total length of the packet including this header
+    uint32_t sessionId;
+    uint32_t frame;
+    uint32_t baseFrame;
+    uint32_t changedRows;
+    int32_t level;
+    int32_t lineCount;
+    int32_t score;
+};
+
+/*
+Peer <-> peer over UDP: the keys of the sender in frames [firstFrame, firstFrame +
+inputCount) of a versus match (rollback.h), followed by inputCount key bytes. Every
+packet repeats the keys the receiver has not acknowledged yet, so lost packets need no
+retransmission.
+*/
+struct VersusInputHeader
+{
+    uint8_t type;       // MESSAGE_VERSUS_INPUT
+    uint8_t inputCount;
+    int16_t advantage;  // Frames the sender is ahead of the newest frame it heard of from the receiver
+    uint32_t frame;     // Next frame the sender will simulate
+    uint32_t firstFrame;
+    uint32_t ackFrame;      // The sender has the receiver's keys of every frame below this
+    uint32_t checksumFrame; // Confirmed frame of the checksum, 0 before the first one
+    uint64_t checksum;      // hash_versus_state() at the start of checksumFrame
+};
+
+#pragma pack(pop)
+
+/**
+ * @brief Packs the held keys of an InputState into InputKey bits
+ *
+ * @param input - pointer to InputState holding the keys
+ * @return uint8_t - packed keys
+ */
+inline uint8_t pack_input_keys(const InputState *input)
+{
+    return static_cast<uint8_t>((input->left ? INPUT_KEY_LEFT : 0) |
+                                (input->right ? INPUT_KEY_RIGHT : 0) |
+                                (input->up ? INPUT_KEY_UP : 0) |
+                                (input->down ? INPUT_KEY_DOWN : 0) |
+                                (input->a ? INPUT_KEY_A : 0) |
+                                (input->b ? INPUT_KEY_B : 0));
+}
+
+/**
+ * @brief Sets the held keys of an InputState from packed InputKey bits and computes the
+ * deltas against the keys it held before, the same way main() does for the keyboard
+ *
+ * @param input - pointer to InputState holding the previous keys, updated in place
+ * @param keys - packed keys of the new frame
+ */
+inline void apply_input_keys(InputState *input, uint8_t keys)
+{
+    InputState prevInput = *input;
+
+    input->left = (keys & INPUT_KEY_LEFT) != 0;
+    input->right = (keys & INPUT_KEY_RIGHT) != 0;
+    input->up = (keys & INPUT_KEY_UP) != 0;
+    input->down = (keys & INPUT_KEY_DOWN) != 0;
+    input->a = (keys & INPUT_KEY_A) != 0;
+    input->b = (keys & INPUT_KEY_B) != 0;
+
+    input->deltaLeft = input->left - prevInput.left;
+    input->deltaRight = input->right - prevInput.right;
+    input->deltaUp = input->up - prevInput.up;
+    input->deltaDown = input->down - prevInput.down;
+    input->deltaA = input->a - prevInput.a;
+    input->deltaB = input->b - prevInput.b;
+}
+
+#endif /* PROTOCOL_H */
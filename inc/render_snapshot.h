@@ -0,0 +1,184 @@
+#ifndef RENDER_SNAPSHOT_H
+#define RENDER_SNAPSHOT_H
+
+#include <atomic>
+#include <cstdint>
+#include "./tetris.h"
+
+/*
+Hand-off between the simulation thread and the render thread of the game. The
+simulation publishes an immutable RenderSnapshot after every step through a triple
+buffer, and the render thread sends the keys it samples through a single producer,
+single consumer ring. Neither side ever waits for the other.
+*/
+#define INPUT_QUEUE_SIZE 64 // Key samples buffered between the threads (power of two)
+#define SNAPSHOT_FRESH 4u   // Set in SnapshotBuffer::middle while the middle snapshot is unread
+
+// Everything render_game() draws, copied out of the game by the simulation
+template <typename Game>
+struct RenderSnapshot
+{
+    uint8_t board[Game::BOARD_WIDTH * Game::BOARD_HEIGHT];
+    uint8_t lines[Game::BOARD_HEIGHT];
+    PieceState piece;
+    PieceState silhouette; // Piece dropped as far as it goes
+    GamePhase phase;
+
+    int32_t level;
+    int32_t startLevel;
+    int32_t lineCount;
+    int32_t score;
+    uint32_t frame;
+
+    int64_t leaderboardRank;  // Rank of the last finished game, -1 when it was not recorded
+    uint64_t leaderboardSize; // Games on the leaderboard
+};
+
+/*
+Triple buffer of snapshots. The writer owns one snapshot, the reader owns another and the
+third sits in the middle. Publishing and acquiring swap the owned snapshot with the middle one.
+*/
+template <typename Game>
+struct SnapshotBuffer
+{
+    RenderSnapshot<Game> snapshots[3];
+    alignas(64) std::atomic<uint32_t> middle; // Index of the middle snapshot, with SNAPSHOT_FRESH once published
+    alignas(64) uint32_t writeIndex;          // Only touched by the simulation
+    alignas(64) uint32_t readIndex;           // Only touched by the render thread
+};
+
+// Ring of packed InputKey bits sampled by the render thread
+struct InputQueue
+{
+    uint8_t keys[INPUT_QUEUE_SIZE];
+    alignas(64) std::atomic<uint32_t> head; // Next sample to pop, written by the simulation
+    alignas(64) std::atomic<uint32_t> tail; // Next sample to push, written by the render thread
+};
+
+/**
+ * @brief Empties a snapshot buffer. The writer starts on snapshot 0, the middle is 1 and
+ * the reader holds 2, which stays zeroed (GAME_PHASE_START) until the first publish.
+ *
+ * @param buffer - pointer to SnapshotBuffer to be initialised
+ */
+template <typename Game>
+inline void init_snapshot_buffer(SnapshotBuffer<Game> *buffer)
+{
+    memset(buffer->snapshots, 0, sizeof(buffer->snapshots));
+    buffer->writeIndex = 0;
+    buffer->middle.store(1);
+    buffer->readIndex = 2;
+}
+
+/**
+ * @brief Returns the snapshot the simulation may fill next
+ *
+ * @param buffer - pointer to SnapshotBuffer shared with the render thread
+ * @return RenderSnapshot* - snapshot owned by the simulation
+ */
+template <typename Game>
+inline RenderSnapshot<Game> *get_write_snapshot(SnapshotBuffer<Game> *buffer)
+{
+    return &buffer->snapshots[buffer->writeIndex];
+}
+
+/**
+ * @brief Publishes the filled write snapshot, replacing an unread one in the middle
+ *
+ * @param buffer - pointer to SnapshotBuffer shared with the render thread
+ */
+template <typename Game>
+inline void publish_snapshot(SnapshotBuffer<Game> *buffer)
+{
+    uint32_t previous = buffer->middle.exchange(buffer->writeIndex | SNAPSHOT_FRESH, std::memory_order_acq_rel);
+    buffer->writeIndex = previous & ~SNAPSHOT_FRESH;
+}
+
+/**
+ * @brief Takes the newest published snapshot, or keeps the current one if nothing new was published
+ *
+ * @param buffer - pointer to SnapshotBuffer shared with the simulation
+ * @return const RenderSnapshot* - snapshot owned by the render thread until the next call
+ */
+template <typename Game>
+inline const RenderSnapshot<Game> *acquire_snapshot(SnapshotBuffer<Game> *buffer)
+{
+    if (buffer->middle.load(std::memory_order_relaxed) & SNAPSHOT_FRESH)
+    {
+        uint32_t previous = buffer->middle.exchange(buffer->readIndex, std::memory_order_acq_rel);
+        buffer->readIndex = previous & ~SNAPSHOT_FRESH;
+    }
+    return &buffer->snapshots[buffer->readIndex];
+}
+
+/**
+ * @brief Copies what render_game() needs out of the game, including the silhouette
+ * that used to be computed while rendering
+ *
+ * @param game - pointer to the game after a simulation step
+ * @param frame - number of frames simulated
+ * @param snapshot - pointer to RenderSnapshot to be filled
+ */
+template <typename Game>
+inline void capture_render_snapshot(const Game *game, uint32_t frame, RenderSnapshot<Game> *snapshot)
+{
+    memcpy(snapshot->board, game->board, sizeof(snapshot->board));
+    memcpy(snapshot->lines, game->lines, sizeof(snapshot->lines));
+    snapshot->piece = game->piece;
+    snapshot->phase = game->phase;
+    snapshot->level = game->level;
+    snapshot->startLevel = game->startLevel;
+    snapshot->lineCount = game->lineCount;
+    snapshot->score = game->score;
+    snapshot->frame = frame;
+
+    PieceState piece = game->piece;
+    while (check_piece_valid(&piece, game))
+    {
+        piece.offsetRow++;
+    }
+    piece.offsetRow--;
+    snapshot->silhouette = piece;
+}
+
+/**
+ * @brief Pushes the keys sampled by the render thread
+ *
+ * @param queue - pointer to InputQueue shared with the simulation
+ * @param keys - packed InputKey bits
+ * @return true - keys queued
+ * @return false - the queue is full and the sample was dropped
+ */
+inline bool push_input_keys(InputQueue *queue, uint8_t keys)
+{
+    uint32_t tail = queue->tail.load(std::memory_order_relaxed);
+    if (tail - queue->head.load(std::memory_order_acquire) == INPUT_QUEUE_SIZE)
+    {
+        return false;
+    }
+    queue->keys[tail % INPUT_QUEUE_SIZE] = keys;
+    queue->tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+/**
+ * @brief Pops the oldest key sample
+ *
+ * @param queue - pointer to InputQueue shared with the render thread
+ * @param keys - receives the packed InputKey bits
+ * @return true - a sample was popped
+ * @return false - the queue is empty
+ */
+inline bool pop_input_keys(InputQueue *queue, uint8_t *keys)
+{
+    uint32_t head = queue->head.load(std::memory_order_relaxed);
+    if (head == queue->tail.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+    *keys = queue->keys[head % INPUT_QUEUE_SIZE];
+    queue->head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+#endif /* RENDER_SNAPSHOT_H */
@@ -0,0 +1,58 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <cstdint>
+#include <vector>
+#include "./tetris.h"
+
+/*
+A recorded game: the state of its random piece generator, its start level and the keys
+held on the start screen, and the packed InputKey bits of every frame from there. The engine only
+uses integer frame counters and the start screen resets everything else, so stepping the
+keys from init_replay_cursor() (setting GameState::frame to n before frame n)
+reproduces every frame of the game exactly, on any machine.
+
+File layout: ReplayHeader followed by frameCount bytes of keys.
+*/
+#define REPLAY_MAGIC 0x4C505254u // "TRPL"
+#define REPLAY_VERSION 4
+
+#pragma pack(push, 1)
+struct ReplayHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t boardWidth; // GameState::BOARD_WIDTH of the recording engine
+    uint32_t randomState;    // GameState::randomState on the start screen
+    int32_t startLevel;      // GameState::startLevel on the start screen
+    uint8_t heldKeys;        // Keys held on the frame before frame 0
+    uint32_t gameStartFrame; // Frame the recorded game left the start screen
+    uint32_t frameCount;
+};
+#pragma pack(pop)
+
+struct Replay
+{
+    uint32_t randomState;
+    int32_t startLevel;
+    uint8_t heldKeys;
+    uint32_t gameStartFrame;
+    std::vector<uint8_t> keys; // keys[n] is applied on frame n + 1
+};
+
+// Position in a replay. Copying a cursor snapshots the game, so playback can resume from any copy.
+struct ReplayCursor
+{
+    GameState game;
+    InputState input;
+    uint32_t frame; // Frames stepped
+};
+
+// Function Prototypes
+void init_replay_game(GameState *game, uint32_t seed);
+void init_replay_cursor(ReplayCursor *cursor, const Replay *replay);
+bool step_replay(ReplayCursor *cursor, const Replay *replay);
+bool write_replay(const char *path, const Replay *replay);
+bool read_replay(const char *path, Replay *replay);
+
+#endif /* REPLAY_H */
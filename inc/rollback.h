@@ -0,0 +1,102 @@
+#ifndef ROLLBACK_H
+#define ROLLBACK_H
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include <netinet/in.h>
+#include "./versus.h"
+#include "./protocol.h"
+
+/*
+Rollback netcode for versus matches (versus.h) between two peers over UDP.
+
+Every tick a peer simulates the next frame at once with its own keys and a prediction of
+the remote keys (the last remote keys it received), so local input has no delay. The
+state at the start of each of the last ROLLBACK_WINDOW frames is kept in a ring of save
+states. When the real remote keys of a frame arrive and differ from the prediction the
+frame was simulated with, the match is restored to the start of that frame and
+re-simulated up to the present within the same tick. A save state is one copy of the
+VersusState and a frame is two update_game() calls, so rolling back a 100 ms link
+(6 frames round trip) costs a few microseconds.
+
+A peer never runs more than ROLLBACK_WINDOW frames ahead of the remote keys it has, and
+waits a few ticks when it is further ahead of the remote than the remote is of it, so
+both peers see the same latency. Frames whose remote keys are all known are confirmed;
+every ROLLBACK_CHECKSUM_INTERVAL frames the peers exchange a hash of the confirmed match
+and flag a desync if they differ.
+*/
+#define ROLLBACK_WINDOW 32 // Frames of save states, the most a prediction can be wrong for
+#define ROLLBACK_KEY_RING (ROLLBACK_WINDOW * 2)
+#define ROLLBACK_PACKET_INPUTS ROLLBACK_KEY_RING // Keys repeated in one packet at most
+#define ROLLBACK_CHECKSUM_INTERVAL 60
+#define ROLLBACK_CHECKSUMS 8 // Local checksums kept for the remote ones still in flight
+#define ROLLBACK_SYNC_INTERVAL 60
+#define ROLLBACK_MAX_WAIT_TICKS 8
+
+// Artificial link conditions applied to the outgoing packets, for testing on loopback
+struct RollbackLink
+{
+    uint32_t latencyMilliseconds;
+    uint32_t lossPercent;
+};
+
+struct DelayedPacket
+{
+    uint64_t sendTime; // Monotonic time in nanoseconds
+    std::vector<uint8_t> bytes;
+};
+
+struct RollbackStats
+{
+    uint64_t rollbacks;
+    uint64_t resimulatedFrames;
+    uint32_t maxRollbackFrames;
+    uint64_t stalledTicks; // Ticks spent waiting for remote keys
+    uint64_t syncTicks;    // Ticks spent letting the remote catch up
+    uint64_t packetsSent;
+    uint64_t packetsReceived;
+    uint64_t packetsLost; // Dropped by the artificial link
+};
+
+struct RollbackSession
+{
+    int32_t fd;
+    sockaddr_in remote;
+    int32_t localPlayer;
+
+    VersusState state;                  // At the start of frame state.frame
+    VersusState saved[ROLLBACK_WINDOW]; // saved[f % ROLLBACK_WINDOW] is the match at the start of frame f
+    uint8_t localKeys[ROLLBACK_KEY_RING];     // Indexed by frame % ROLLBACK_KEY_RING
+    uint8_t remoteKeys[ROLLBACK_KEY_RING];
+    uint8_t predictedKeys[ROLLBACK_KEY_RING]; // Remote keys each frame was simulated with
+
+    uint32_t remoteFrames;   // Remote keys are known for every frame below this
+    uint32_t remoteAck;      // The remote has our keys of every frame below this
+    uint32_t remoteFrame;    // Newest frame the remote said it would simulate
+    int32_t remoteAdvantage; // Frames the remote said it is ahead of us
+    uint32_t waitTicks;      // Ticks left to let the remote catch up
+    uint32_t nextSyncFrame;
+
+    uint32_t checksumFrame; // Next confirmed frame to hash
+    uint32_t checksumFrames[ROLLBACK_CHECKSUMS];
+    uint64_t checksums[ROLLBACK_CHECKSUMS];
+    uint32_t remoteChecksumFrame;
+    uint64_t remoteChecksum;
+    bool desynced;
+    uint32_t desyncFrame;
+
+    RollbackLink link;
+    std::deque<DelayedPacket> delayed;
+    uint32_t linkRandomState;
+    RollbackStats stats;
+};
+
+// Function Prototypes
+bool open_rollback_session(RollbackSession *session, uint16_t localPort, const char *remoteAddress, uint16_t remotePort, int32_t localPlayer, uint32_t seed);
+void close_rollback_session(RollbackSession *session);
+bool advance_rollback_session(RollbackSession *session, uint8_t keys);
+void poll_rollback_session(RollbackSession *session);
+uint32_t get_confirmed_frame(const RollbackSession *session);
+
+#endif /* ROLLBACK_H */
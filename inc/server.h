@@ -0,0 +1,121 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "./tetris.h"
+#include "./protocol.h"
+#include "./spectator.h"
+#include "./cold_store.h"
+#include "./leaderboard.h"
+#include "./replay.h"
+#include "./telemetry_export.h"
+
+#define SERVER_MAX_WORKERS 64
+#define SESSION_ID_WORKER_SHIFT 24       // Session ids hold the worker index above this bit
+#define SESSION_INPUT_QUEUE_SIZE 16      // Client frames buffered per session (power of two)
+#define SESSION_MAX_PENDING_OUTPUT 65536 // Unsent bytes after which state messages to a slow client are skipped
+#define SPECTATOR_MAX_QUEUED_PACKETS 32  // Unsent packets after which a slow spectator skips frames
+
+struct ServerConfig
+{
+    uint16_t port;       // TCP port every worker listens on for players (SO_REUSEPORT)
+    uint16_t spectatorPort; // TCP port every worker listens on for spectators
+    int32_t workerCount; // Number of worker threads, each owning one shard of sessions
+    int32_t maxCatchUpFrames; // Frames a late worker may simulate in one go before skipping ahead
+
+    const char *coldStorePath; // Backing file prefix for idle games (one file per worker), NULL keeps every game resident
+    uint32_t idleFrames;       // Frames without input after which a game is paged out
+    bool pauseIdleGames;       // Also page out games in play, which then pause until the next input
+
+    const char *leaderboardPath; // Leaderboard recording every finished game, NULL disables it
+    const char *replayPath;      // Directory receiving a replay of every finished game, NULL disables it
+    const char *telemetryPath;   // File the gameplay telemetry is exported to every TELEMETRY_EXPORT_SECONDS, NULL disables it
+};
+
+// Kinds of file descriptors registered with a worker's epoll instance
+enum ConnectionKind
+{
+    CONNECTION_PLAYER_LISTENER,
+    CONNECTION_SPECTATOR_LISTENER,
+    CONNECTION_MAILBOX,
+    CONNECTION_PLAYER,
+    CONNECTION_SPECTATOR
+};
+
+// First member of everything registered with epoll, so events can be dispatched on kind
+struct Connection
+{
+    ConnectionKind kind;
+    int32_t fd;
+};
+
+struct Spectator;
+
+// Parts of a session that are only allocated while its game is resident
+struct HotGame
+{
+    GameState game;
+    uint8_t sentBoard[GameState::BOARD_WIDTH * GameState::BOARD_HEIGHT]; // Board last sent to the client
+    bool boardSent;
+};
+
+/*
+One game hosted by the server. Sessions are owned by exactly one worker and only
+ever touched by that worker's thread. An idle game is paged out to the worker's
+ColdStore and restored on the next input.
+*/
+struct Session
+{
+    Connection connection;
+    uint32_t id;    // Worker index above SESSION_ID_WORKER_SHIFT, so any worker can find the owner
+    uint32_t frame; // Number of frames simulated
+
+    HotGame *hot;     // NULL while the game is paged out
+    uint32_t coldSlot; // Slot of the paged out game in the worker's ColdStore
+    uint32_t idleFrames; // Frames simulated since the last client input
+    InputState input;
+
+    // Ring of packed keys received from the client, one entry per client frame
+    uint8_t inputQueue[SESSION_INPUT_QUEUE_SIZE];
+    uint32_t inputHead;
+    uint32_t inputTail;
+    uint8_t readBuffer[sizeof(InputMessage)]; // Start of a message split across reads
+    uint32_t readLength;
+
+    uint8_t *writeBuffer; // Output batched during a frame and flushed once per frame, NULL while paged out
+    uint32_t writeLength;
+    uint32_t writeOffset;
+    bool waitingWritable; // EPOLLOUT armed because the socket buffer was full
+
+    std::vector<Spectator *> spectators;
+    SpectatorHistory *history; // Delta bases, only allocated while the game has spectators
+
+    Replay *replay; // Keys of the current game since its start screen, NULL unless the server records replays
+};
+
+/*
+A connection watching one session. It lives on the worker owning that session once it
+subscribed. Its output is a queue of packets shared with the other spectators of the game.
+*/
+struct Spectator
+{
+    Connection connection;
+    uint32_t sessionId;
+    Session *session; // NULL until subscribed
+    uint32_t ackedFrame; // Newest frame the spectator acknowledged, 0 before the first ack
+
+    uint8_t readBuffer[sizeof(AckMessage)]; // Start of a message split across reads
+    uint32_t readLength;
+
+    std::deque<SpectatorPacketRef> queue; // Packets not yet fully sent
+    uint32_t queueOffset;                 // Bytes of the front packet already sent
+    bool waitingWritable;
+};
+
+void init_server_config(ServerConfig *config);
+int32_t run_server(const ServerConfig *config);
+void stop_server();
+
+#endif /* SERVER_H */
@@ -0,0 +1,30 @@
+#ifndef SOFTWARE_RENDERER_H
+#define SOFTWARE_RENDERER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "./draw_list.h"
+#include "./bitmap_font.h"
+
+/*
+Offscreen rasterizer for draw lists, used to render frames without a window or SDL.
+Pixels are packed RGB24, top row first, which is what PPM images and raw video encoders
+(ffmpeg -f rawvideo -pix_fmt rgb24) expect. Text uses the built-in 5x7 bitmap font
+(bitmap_font.h) scaled by FONT_SCALE.
+*/
+#define FONT_SCALE 2
+
+struct Framebuffer
+{
+    int32_t width;
+    int32_t height;
+    std::vector<uint8_t> pixels; // width * height * 3 bytes
+};
+
+// Function Prototypes
+void init_framebuffer(Framebuffer *framebuffer, int32_t width, int32_t height);
+void rasterize_draw_list(Framebuffer *framebuffer, const std::vector<DrawCommand> *commands);
+bool write_framebuffer(FILE *file, const Framebuffer *framebuffer, bool ppmHeader);
+
+#endif /* SOFTWARE_RENDERER_H */
@@ -0,0 +1,56 @@
+#ifndef SPECTATOR_H
+#define SPECTATOR_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "./tetris.h"
+#include "./protocol.h"
+
+#define SPECTATOR_HISTORY_SIZE 64 // Frames a spectator may lag behind before it gets a keyframe
+
+const int32_t SPECTATOR_BOARD_SIZE = GameState::BOARD_WIDTH * GameState::BOARD_HEIGHT;
+static_assert(GameState::BOARD_HEIGHT <= 32, "changedRows holds one bit per board row");
+
+/*
+Boards of the most recent frames of one game, indexed by frame % SPECTATOR_HISTORY_SIZE.
+The server keeps one per spectated game as delta bases, a spectator keeps one with the
+frames it decoded.
+*/
+struct SpectatorHistory
+{
+    uint32_t frames[SPECTATOR_HISTORY_SIZE]; // Frame stored in each slot, 0 when empty
+    uint8_t boards[SPECTATOR_HISTORY_SIZE][SPECTATOR_BOARD_SIZE];
+};
+
+/*
+An encoded SpectateHeader plus its rows. Packets are immutable once encoded and shared by
+every spectator that acknowledged the same base frame.
+*/
+struct SpectatorPacket
+{
+    std::vector<uint8_t> bytes;
+};
+typedef std::shared_ptr<const SpectatorPacket> SpectatorPacketRef;
+
+// State of a game as reconstructed by a spectator
+struct SpectatorView
+{
+    uint32_t sessionId;
+    uint32_t frame;
+    uint8_t board[SPECTATOR_BOARD_SIZE];
+    PieceState piece;
+    GamePhase phase;
+    int32_t level;
+    int32_t lineCount;
+    int32_t score;
+    SpectatorHistory history;
+};
+
+// Function Prototypes
+const uint8_t *get_history_board(const SpectatorHistory *history, uint32_t frame);
+void record_history_board(SpectatorHistory *history, uint32_t frame, const uint8_t *board);
+SpectatorPacketRef encode_spectator_packet(const SpectatorHistory *history, uint32_t sessionId, uint32_t frame, uint32_t baseFrame, const GameState *game);
+int32_t decode_spectator_packet(SpectatorView *view, const uint8_t *bytes, uint32_t length);
+
+#endif /* SPECTATOR_H */
@@ -0,0 +1,118 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "./tetris.h"
+#include "./eval_cache.h"
+#include "./dataset.h"
+
+/*
+A batch of bot games (bot.h) played across threads, which can be checkpointed to disk
+and resumed bit-exactly.
+
+The games are dealt to laneCount lanes. Lane l plays games l, l + laneCount, ...
+one after the other, and game i is seeded from the seed of the run and i. Lanes never
+interact, and the results of the run are the sums of the results of the lanes, so a run
+gives the same results whatever the number of threads and wherever it is interrupted.
+
+Threads step their lanes SWEEP_EPOCH_PLACEMENTS pieces at a time. A checkpoint bumps
+the generation of the sweep, and each thread copies its lanes into the snapshot buffer
+at the end of its current epoch and carries on. A lane is self-contained (game, frame,
+position in the run and results), so the copies don't need to be taken at the same
+epoch. Once every thread has copied, the snapshot is written out while the lanes keep
+running.
+
+With a dataset attached, every locked piece is also recorded as a sample (dataset.h).
+Threads flush their samples when they copy their lanes, and the dataset is synced before
+each checkpoint is written, so the file holds every sample up to the checkpoint. A resumed
+run keeps those, drops the samples recorded after the checkpoint (the pieces it plays
+again, with the same game and piece indices) and appends to the file.
+
+Checkpoint layout: SweepHeader followed by laneCount SweepLanes, written sequentially
+to <path>.tmp, synced and renamed over <path>. Resuming maps the file and copies the
+lanes back.
+*/
+#define SWEEP_MAGIC 0x50575354u // "TSWP"
+#define SWEEP_VERSION 3
+#define SWEEP_EPOCH_PLACEMENTS 256
+#define SWEEP_CHECKPOINT_SECONDS 60
+
+struct SweepResults
+{
+    uint64_t games;
+    uint64_t cappedGames; // Games stopped at maxPieces rather than by a game over
+    uint64_t pieces;
+    uint64_t lines;
+    uint64_t score;
+    int32_t bestScore;
+    int32_t bestLevel;
+    uint64_t checksum; // Order dependent hash of the results of every game
+};
+
+struct SweepLane
+{
+    GameState game; // Current game, stored as its raw bytes
+    uint32_t frame;  // Frames stepped in the current game
+    uint32_t pieces; // Pieces placed in the current game
+    uint64_t gameIndex; // Index of the current game in the run, done once it reaches gameCount
+    SweepResults results;
+};
+
+struct SweepHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t boardWidth;
+    uint32_t laneSize;  // sizeof(SweepLane) of the writing build
+    uint32_t laneCount;
+    uint64_t seed;
+    uint64_t gameCount;
+    uint32_t maxPieces;
+    uint32_t complete; // Every game of the run has been played
+};
+
+// State of one sweep thread, merged into the sweep when the thread exits
+struct SweepWorker
+{
+    uint64_t cacheHits;
+    uint64_t cacheMisses;
+    DatasetBlock samples; // Decisions not yet written to the dataset
+};
+
+struct Sweep
+{
+    uint64_t seed;
+    uint64_t gameCount;
+    uint32_t maxPieces;
+    std::vector<SweepLane> lanes;
+    EvalCache *cache; // Decisions shared with other runs, NULL to evaluate every board
+    DatasetWriter *dataset; // Receives a sample per locked piece, NULL to record nothing
+
+    std::atomic<uint64_t> cacheHits; // Bot decisions of this process found in the cache
+    std::atomic<uint64_t> cacheMisses;
+
+    std::vector<SweepLane> snapshot; // Copies of the lanes taken for the next checkpoint
+    std::atomic<uint32_t> generation; // Checkpoints requested so far
+    std::atomic<bool> stopping;        // Threads stop at the end of their epoch
+    std::mutex mutex;
+    std::condition_variable changed;
+    uint32_t copiedThreads;  // Threads that copied their lanes for the current generation
+    uint32_t finishedThreads; // Threads whose lanes have played every game
+    uint32_t exitedThreads; // Threads that left their loop after a stop
+};
+
+// Function Prototypes
+void init_sweep(Sweep *sweep, uint64_t seed, uint64_t gameCount, uint32_t laneCount, uint32_t maxPieces);
+bool step_sweep_lane(const Sweep *sweep, SweepLane *lane, uint32_t pieceCount, SweepWorker *worker);
+void get_sweep_results(const std::vector<SweepLane> &lanes, SweepResults *results);
+bool run_sweep(Sweep *sweep, uint32_t threadCount, const char *checkpointPath, uint32_t checkpointSeconds);
+void stop_sweep(Sweep *sweep);
+bool write_sweep_checkpoint(const char *path, const Sweep *sweep, const std::vector<SweepLane> &lanes);
+bool read_sweep_checkpoint(const char *path, Sweep *sweep);
+bool resume_sweep_dataset(const Sweep *sweep, DatasetWriter *writer, const char *path);
+
+#endif /* SWEEP_H */
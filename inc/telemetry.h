@@ -0,0 +1,61 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <atomic>
+#include <cstdint>
+
+/*
+Gameplay telemetry counted by the engine on every thread that steps games. Each thread
+owns one TelemetryCounters block and is its only writer, so counting is a relaxed load
+and store with no locked instruction and no shared cache line. Blocks are linked into a
+global list that is only ever pushed to. collect_telemetry() sums them with relaxed loads
+and never blocks the writers. The block of an exited thread keeps its counts and is
+handed to the next new thread. The totals are exported by telemetry_export.h.
+*/
+#define TELEMETRY_TETROMINOS 7
+#define TELEMETRY_LEVELS 30 // Game overs are bucketed by level, the last bucket holds level 29 and above
+
+struct TelemetryCounters
+{
+    std::atomic<uint64_t> pieceSpawns[TELEMETRY_TETROMINOS]; // By tetromino index
+    std::atomic<uint64_t> softDrops;      // Soft drops asked for by the player
+    std::atomic<uint64_t> hardDrops;
+    std::atomic<uint64_t> lineClears[4];  // Clears of 1, 2, 3 and 4 lines
+    std::atomic<uint64_t> levelUps;
+    std::atomic<uint64_t> gamesStarted;
+    std::atomic<uint64_t> gameOvers[TELEMETRY_LEVELS]; // By level at the game over
+    std::atomic<uint64_t> playFrames;     // Frames stepped in GAME_PHASE_PLAY and GAME_PHASE_LINE
+
+    std::atomic<bool> claimed;   // Owned by a running thread
+    TelemetryCounters *next;     // Set before the block is published, then constant
+};
+
+// Totals over every thread
+struct TelemetrySnapshot
+{
+    uint64_t pieceSpawns[TELEMETRY_TETROMINOS];
+    uint64_t softDrops;
+    uint64_t hardDrops;
+    uint64_t lineClears[4];
+    uint64_t levelUps;
+    uint64_t gamesStarted;
+    uint64_t gameOvers[TELEMETRY_LEVELS];
+    uint64_t playFrames;
+};
+
+// Function Prototypes
+TelemetryCounters *get_telemetry_counters();
+void collect_telemetry(TelemetrySnapshot *snapshot);
+
+/**
+ * @brief Adds to a counter of the calling thread's block, which only that thread writes
+ *
+ * @param counter - pointer to the counter
+ * @param count - amount to add
+ */
+inline void add_telemetry(std::atomic<uint64_t> *counter, uint64_t count = 1)
+{
+    counter->store(counter->load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+}
+
+#endif /* TELEMETRY_H */
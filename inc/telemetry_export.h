@@ -0,0 +1,24 @@
+#ifndef TELEMETRY_EXPORT_H
+#define TELEMETRY_EXPORT_H
+
+#include <cstdint>
+#include "./telemetry.h"
+
+/*
+Export of the gameplay telemetry (telemetry.h), kept out of the engine so that only the
+programs exporting it start a thread.
+
+A background thread started by start_telemetry_export() writes the totals every
+interval in the Prometheus text format. It writes to <path>.tmp and renames that over
+<path>, so readers (e.g. the node_exporter textfile collector) never see a partial file.
+Average game length is tetris_play_frames_total / tetris_game_overs_total, and the
+pieces per game ("depth" of a game over) is tetris_piece_spawns_total / tetris_games_started_total.
+*/
+#define TELEMETRY_EXPORT_SECONDS 10
+
+// Function Prototypes
+bool write_telemetry(const char *path);
+bool start_telemetry_export(const char *path, uint32_t intervalSeconds);
+void stop_telemetry_export();
+
+#endif /* TELEMETRY_EXPORT_H */
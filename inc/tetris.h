@@ -3,17 +3,21 @@
 
 #include <cstdio>
 #include <cstring>
+#include <type_traits>
 #include "./tetromino.h"
 #include "./colors.h"
 using namespace std;
 
 /*
 Height and width are taken from Nintendo Tetris's wiki page
+These are the dimensions of the default board (GameState). The engine itself is
+templated on the board dimensions, see GameStateT below.
 */
 #define WIDTH 14
 #define HEIGHT 22         // Adding two hidden rows to spawn the pieces
 #define VISIBLE_HEIGHT 20 // Actual board height
 #define GRID_SIZE 30
+#define LINE_HIGHLIGHT_FRAMES 30 // Cleared lines are highlighted for 500 ms
 #define ARRAY_COUNT(x) (sizeof(x) / sizeof(x)[0])
 
 // Frames taken from Nintendo Tetris's wiki page
@@ -60,6 +64,11 @@ enum GamePhase {
     GAME_PHASE_GAMEOVER
 };
 
+enum RotationDirection {
+    ROTATION_CW,  // Clockwise, the up key
+    ROTATION_CCW  // Counter-clockwise, the B key
+};
+
 enum TextAlign{
     TEXT_ALIGN_LEFT,
     TEXT_ALIGN_CENTER,
@@ -74,10 +83,64 @@ struct PieceState
     int32_t rotation;     // Rotation of the tetromino
 };
 
-struct GameState
+/*
+Precomputed occupancy of a tetromino in one rotation. Bit c of rows[r] is set when
+cell (r, c) of the rotated tetromino matrix is filled. minRow..maxRow and minCol..maxCol
+bound the filled cells so that bounds checks do not need to walk the matrix.
+*/
+struct PieceMask
+{
+    uint8_t rows[4];
+    int8_t minRow;
+    int8_t maxRow;
+    int8_t minCol;
+    int8_t maxCol;
+};
+
+/*
+Precomputed rotation of a tetromino a quarter turn out of one rotation: the mask of the
+rotated tetromino and its wall kicks (tetromino.h) as row and column offsets, tried in
+order. Repeated offsets are dropped, so the square tries a single one.
+*/
+struct RotationKicks
+{
+    const PieceMask *mask;
+    int32_t rotation; // Rotation after the turn
+    int32_t kickCount;
+    int8_t rows[TETROMINO_KICKS];
+    int8_t cols[TETROMINO_KICKS];
+};
+
+/*
+Row occupancy masks of the board. Bit c of a row mask is set when column c is filled.
+Boards up to 16, 32 and 64 columns use a single 16, 32 and 64 bit integer per row.
+Wider boards fall back to WideRow, a multi-word bitset.
+*/
+template <int32_t Width>
+struct WideRow
+{
+    uint64_t words[(Width + 63) / 64];
+};
+
+template <int32_t Width>
+struct RowMaskType
+{
+    typedef typename conditional<(Width <= 16), uint16_t,
+            typename conditional<(Width <= 32), uint32_t,
+            typename conditional<(Width <= 64), uint64_t, WideRow<Width> >::type>::type>::type Type;
+};
+
+template <int32_t Width, int32_t Height, int32_t VisibleHeight>
+struct GameStateT
 {
-    uint8_t board[WIDTH * HEIGHT];
-    uint8_t lines[HEIGHT];  // Stores the number of lines that are filled
+    static const int32_t BOARD_WIDTH = Width;
+    static const int32_t BOARD_HEIGHT = Height;
+    static const int32_t BOARD_VISIBLE_HEIGHT = VisibleHeight;
+    typedef typename RowMaskType<Width>::Type RowMask;
+
+    uint8_t board[Width * Height];
+    uint8_t lines[Height];  // Stores the number of lines that are filled
+    RowMask rows[Height];   // Occupancy masks kept in sync with board
 
     PieceState piece;
     GamePhase phase;
@@ -89,11 +152,19 @@ struct GameState
     int32_t pendingLineCount;
     int32_t score;
 
-    float nextDropTime; // Next drop time of the tetromino piece
-    float time;         // Current time
-    float highlightEndTime;
+    uint32_t frame;             // Current frame, set by the caller before every update_game()
+    uint32_t nextDropFrame;     // Frame of the next drop of the tetromino piece
+    uint32_t highlightEndFrame; // Frame the cleared lines stop being highlighted
+
+    uint32_t randomState; // State of the game's random piece generator
 };
 
+// Board sizes compiled into the engine (see the explicit instantiations in tetris.cpp)
+typedef GameStateT<WIDTH, HEIGHT, VISIBLE_HEIGHT> GameState; // Default 14 wide board
+typedef GameStateT<10, HEIGHT, VISIBLE_HEIGHT> GameState10;  // Standard 10 wide board
+typedef GameStateT<40, HEIGHT, VISIBLE_HEIGHT> GameState40;  // Wide stress board
+typedef GameStateT<80, HEIGHT, VISIBLE_HEIGHT> GameState80;  // Generic (multi-word) fallback
+
 struct InputState
 {
     uint8_t left;
@@ -101,12 +172,14 @@ struct InputState
     uint8_t up;
     uint8_t down;
     uint8_t a;
+    uint8_t b;
 
     int8_t deltaLeft;
     int8_t deltaRight;
     int8_t deltaUp;
     int8_t deltaDown;
     int8_t deltaA;
+    int8_t deltaB;
 };
 
 // Function Prototypes
@@ -115,18 +188,23 @@ uint8_t tetromino_get(const Tetromino *tetromino, int32_t row, int32_t col, int3
 uint8_t matrix_get(const uint8_t *values, int32_t width, int32_t row, int32_t col);
 void matrix_set(uint8_t *values, int32_t width, int32_t row, int32_t col, uint8_t value);
 
-bool check_piece_valid(PieceState *piece, const uint8_t *board, int32_t width, int32_t height);
-void merge_piece(GameState *game);
-void spawn_piece(GameState *game);
-bool soft_drop(GameState *game);
+const PieceMask *get_piece_mask(uint8_t tetrominoIndex, int32_t rotation);
+const RotationKicks *get_rotation_kicks(uint8_t tetrominoIndex, int32_t rotation, RotationDirection direction);
+
+template <typename Game> bool check_mask_valid(const PieceMask *mask, int32_t offsetRow, int32_t offsetCol, const Game *game);
+template <typename Game> bool check_piece_valid(const PieceState *piece, const Game *game);
+template <typename Game> bool rotate_piece(PieceState *piece, RotationDirection direction, const Game *game);
+template <typename Game> void merge_piece(Game *game);
+template <typename Game> void spawn_piece(Game *game);
+template <typename Game> bool soft_drop(Game *game);
 
-int32_t find_lines(const uint8_t *values, int32_t width, int32_t height, uint8_t *linesOut);
-void clear_lines(const uint8_t* values, int32_t width, int32_t height, const uint8_t* lines);
+template <typename Game> int32_t find_lines(Game *game);
+template <typename Game> void clear_lines(Game *game);
 
-void update_game_start(GameState *game, const InputState* input);
-void update_game_line(GameState* game);
-void update_game_gameover(GameState *game, const InputState* input);
-void update_game_play(GameState *game, const InputState *input);
-void update_game(GameState *game, const InputState *input);
+template <typename Game> void update_game_start(Game *game, const InputState *input);
+template <typename Game> void update_game_line(Game *game);
+template <typename Game> void update_game_gameover(Game *game, const InputState *input);
+template <typename Game> void update_game_play(Game *game, const InputState *input);
+template <typename Game> void update_game(Game *game, const InputState *input);
 
 #endif /*TETRIS_H*/
\ No newline at end of file
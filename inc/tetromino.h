@@ -74,4 +74,48 @@ const Tetromino TETROMINOS[]{
 
 };
 
+/*
+Wall kicks of the Super Rotation System. KICKS[from][direction][kick] is the (column, row)
+offset tried for the kick-th time when a piece rotates out of SRS state from (0 is the
+SRS spawn orientation, 1 a clockwise turn from it), clockwise (direction 0) or
+counter-clockwise (direction 1). Rows grow downwards like the board, so a
+negative row offset kicks the piece up. The first offset where the rotated piece fits is
+taken; the rotation fails if none does.
+*/
+#define TETROMINO_KICKS 5
+
+typedef int8_t KickTable[4][2][TETROMINO_KICKS][2];
+
+// J, L, S, T and Z share one table
+const KickTable KICKS_JLSTZ{
+    {{{0, 0}, {-1, 0}, {-1, -1}, {0, 2}, {-1, 2}}, {{0, 0}, {1, 0}, {1, -1}, {0, 2}, {1, 2}}},
+    {{{0, 0}, {1, 0}, {1, 1}, {0, -2}, {1, -2}}, {{0, 0}, {1, 0}, {1, 1}, {0, -2}, {1, -2}}},
+    {{{0, 0}, {1, 0}, {1, -1}, {0, 2}, {1, 2}}, {{0, 0}, {-1, 0}, {-1, -1}, {0, 2}, {-1, 2}}},
+    {{{0, 0}, {-1, 0}, {-1, 1}, {0, -2}, {-1, -2}}, {{0, 0}, {-1, 0}, {-1, 1}, {0, -2}, {-1, -2}}}
+};
+
+const KickTable KICKS_I{
+    {{{0, 0}, {-2, 0}, {1, 0}, {-2, 1}, {1, -2}}, {{0, 0}, {-1, 0}, {2, 0}, {-1, -2}, {2, 1}}},
+    {{{0, 0}, {-1, 0}, {2, 0}, {-1, -2}, {2, 1}}, {{0, 0}, {2, 0}, {-1, 0}, {2, -1}, {-1, 2}}},
+    {{{0, 0}, {2, 0}, {-1, 0}, {2, -1}, {-1, 2}}, {{0, 0}, {1, 0}, {-2, 0}, {1, 2}, {-2, -1}}},
+    {{{0, 0}, {1, 0}, {-2, 0}, {1, 2}, {-2, -1}}, {{0, 0}, {-2, 0}, {1, 0}, {-2, 1}, {1, -2}}}
+};
+
+// The square only ever tries its own position
+const KickTable KICKS_O{};
+
+// SRS state of rotation 0 of every tetromino, in TETROMINOS order. The T spawns pointing down, SRS state 2.
+const int32_t TETROMINO_KICK_STATES[]{0, 0, 2, 0, 0, 0, 0};
+
+// Kick table of every tetromino, in TETROMINOS order
+const KickTable *const TETROMINO_KICK_TABLES[]{
+    &KICKS_I,
+    &KICKS_O,
+    &KICKS_JLSTZ,
+    &KICKS_JLSTZ,
+    &KICKS_JLSTZ,
+    &KICKS_JLSTZ,
+    &KICKS_JLSTZ
+};
+
 #endif /* TETROMINOS_H */
\ No newline at end of file
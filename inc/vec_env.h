@@ -0,0 +1,100 @@
+#ifndef VEC_ENV_H
+#define VEC_ENV_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "./tetris.h"
+#include "./protocol.h"
+
+/*
+Vectorized environment shared with trainer processes through POSIX shared memory
+(/dev/shm/<name>). A host process steps envCount games in lockstep. Each step writes one
+VecObservation per game into a ring of ringSize slots, and the trainer answers with one
+byte of InputKey bits per game in a parallel ring of actions. Nothing is copied or
+serialized: both sides read and write the mapping directly.
+
+Observation t lives in slot t % ringSize and stays valid until observation t + ringSize
+is published, so a trainer can keep the last ringSize - 1 observations without copying
+them. Publishing and submitting are counted by two 32-bit sequence words. Each side
+spins briefly on them and then sleeps on them with FUTEX_WAIT, and the other side wakes
+it with FUTEX_WAKE.
+
+Layout: VecEnvHeader at offset 0, observations at observationOffset
+(ringSize * envCount VecObservations, slot-major), and actions at actionOffset
+(ringSize * envCount bytes, slot-major).
+*/
+#define VEC_ENV_MAGIC 0x564E4554u // "TENV"
+#define VEC_ENV_VERSION 1
+#define VEC_ENV_SPIN_COUNT 2000 // Polls of a sequence word before sleeping on it
+
+// Result of a game for one step of the environment
+struct VecObservation
+{
+    int32_t scoreDelta; // Change over the step, the reward
+    int32_t levelDelta;
+    int32_t lineDelta;
+    int32_t score; // Totals of the current game
+    int32_t level;
+    int32_t lineCount;
+    uint32_t frame; // Frames since the game was reset
+
+    PieceState piece;
+    uint8_t phase; // GamePhase
+    uint8_t done;  // The game went over during the step; the rest of the observation is the next game
+    GameState::RowMask rows[GameState::BOARD_HEIGHT]; // Board occupancy, bit c of rows[r] is cell (r, c)
+};
+
+struct VecEnvHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t envCount;
+    uint32_t ringSize;
+    uint32_t boardWidth;
+    uint32_t boardHeight;
+    uint32_t observationSize; // sizeof(VecObservation)
+    uint32_t frameSkip;       // Frames each action is held for
+    uint64_t observationOffset;
+    uint64_t actionOffset;
+
+    alignas(64) std::atomic<uint32_t> observationSequence; // Observations published, written by the host
+    alignas(64) std::atomic<uint32_t> actionSequence;      // Action sets submitted, written by the trainer
+    alignas(64) std::atomic<uint32_t> shutdown;            // Set by either side to stop the other
+};
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "sequence words are shared between processes");
+
+struct VecEnv
+{
+    VecEnvHeader *header; // Mapping of the whole shared memory object
+    size_t size;
+    VecObservation *observations;
+    uint8_t *actions;
+};
+
+// Host side state of the games, only touched by the host process
+struct VecEnvHost
+{
+    VecEnv env;
+    std::vector<GameState> games;
+    std::vector<InputState> inputs;
+    std::vector<uint32_t> frames;
+    uint32_t randomState; // Seeds of new games
+};
+
+// Function Prototypes
+bool create_vec_env(VecEnv *env, const char *name, uint32_t envCount, uint32_t ringSize, uint32_t frameSkip);
+bool attach_vec_env(VecEnv *env, const char *name);
+void close_vec_env(VecEnv *env);
+void unlink_vec_env(const char *name);
+VecObservation *get_observations(VecEnv *env, uint32_t step);
+uint8_t *get_actions(VecEnv *env, uint32_t step);
+void publish_observations(VecEnv *env, uint32_t step);
+bool wait_observations(VecEnv *env, uint32_t step);
+void submit_actions(VecEnv *env, uint32_t step);
+bool wait_actions(VecEnv *env, uint32_t step);
+void shutdown_vec_env(VecEnv *env);
+void init_vec_env_host(VecEnvHost *host, uint32_t seed);
+uint32_t run_vec_env_host(VecEnvHost *host);
+
+#endif /* VEC_ENV_H */
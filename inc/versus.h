@@ -0,0 +1,40 @@
+#ifndef VERSUS_H
+#define VERSUS_H
+
+#include <cstdint>
+#include "./tetris.h"
+
+/*
+Head-to-head match: two games started from the same seed, so both players get the same
+pieces, stepped together one frame at a time with the keys of both players. Clearing
+2, 3 or 4 lines at once sends 1, 2 or 4 garbage rows to the opponent, after cancelling
+the garbage the sender itself has pending. Pending garbage rises from the bottom of the
+board as soon as the next piece spawns, with one hole at a column drawn from the match's
+own generator. The first player to top out loses.
+
+The whole match is one trivially copyable struct and step_versus() only depends on it
+and the keys, so a copy of the struct is a complete save state (see rollback.h).
+*/
+#define VERSUS_PLAYERS 2
+#define VERSUS_GARBAGE_CELL 8 // Color index of garbage cells (colors.h)
+#define VERSUS_NO_WINNER -1
+#define VERSUS_DRAW 2
+
+const int32_t VERSUS_GARBAGE_LINES[] = {0, 0, 1, 2, 4}; // Garbage rows sent per lines cleared at once
+
+struct VersusState
+{
+    GameState games[VERSUS_PLAYERS];
+    InputState inputs[VERSUS_PLAYERS]; // Keys held by each player in the last frame
+    int32_t pendingGarbage[VERSUS_PLAYERS];
+    uint32_t frame;
+    uint32_t randomState; // Generator of the garbage holes
+    int32_t winner;       // Index of the winner, VERSUS_DRAW or VERSUS_NO_WINNER while the match runs
+};
+
+// Function Prototypes
+void init_versus(VersusState *versus, uint32_t seed);
+void step_versus(VersusState *versus, const uint8_t *keys);
+uint64_t hash_versus_state(const VersusState *versus);
+
+#endif /* VERSUS_H */
@@ -1,15 +1,91 @@
 #include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
 #include <iostream>
+#include <thread>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 #include "./inc/tetris.h"
+#include "./inc/leaderboard.h"
+#include "./inc/protocol.h"
+#include "./inc/render_snapshot.h"
+#include "./inc/draw_list.h"
+#include "./inc/grid_view.h"
+#include "./inc/replay.h"
+#include "./inc/bot.h"
+#include "./inc/rollback.h"
+
+#define SIMULATION_MAX_CATCH_UP_FRAMES 4 // Steps taken at once after a stall before the simulation skips ahead
+#define GRID_BOT_DELAY_FRAMES 10          // Frames a bot waits before dropping a new piece, so its games can be followed
+#define GRID_RESTART_FRAMES 180           // Frames a finished game stays on the wall before the next one starts
+#define VERSUS_WINDOW_WIDTH (GameState::BOARD_WIDTH * GRID_SIZE * VERSUS_PLAYERS)
+
+/*
+State shared by the simulation thread and the render (main) thread. The game and the
+leaderboard belong to the simulation thread alone; the render thread only sends keys
+through input and reads the snapshots.
+*/
+struct Simulation
+{
+    GameState game;
+    InputQueue input;
+    SnapshotBuffer<GameState> snapshots;
+    Leaderboard leaderboard;
+    bool leaderboardOpen;
+    std::atomic<bool> running;
+};
+
+// One bot game of the spectator wall
+struct GridBoard
+{
+    GameState game;
+    uint32_t frame;
+    uint32_t waitFrames; // Frames since the current piece spawned or the game ended
+    uint32_t games;      // Games played on this board, seeds the next one
+};
+
+/*
+State shared by the simulation thread of the spectator wall and the render thread. Every
+board publishes its own snapshots, so the render thread reads each board like the single
+game view reads its game.
+*/
+struct GridSimulation
+{
+    GridBoard boards[GRID_VIEW_MAX_BOARDS];
+    SnapshotBuffer<GameState> snapshots[GRID_VIEW_MAX_BOARDS];
+    int32_t boardCount;
+    uint64_t seed;
+    std::atomic<bool> running;
+};
+
+/*
+State shared by the simulation thread of a networked versus match and the render thread.
+The rollback session belongs to the simulation thread; the render thread sends the local
+keys through input and reads a snapshot of each player's game.
+*/
+struct VersusSimulation
+{
+    RollbackSession session;
+    InputQueue input;
+    SnapshotBuffer<GameState> snapshots[VERSUS_PLAYERS];
+    std::atomic<bool> running;
+};
 
 // Function Prototypes
 void fill_rect(SDL_Renderer *renderer, int32_t x, int32_t y, int32_t width, int32_t height, Color color);
 void draw_string(SDL_Renderer *renderer, TTF_Font *font, const char *text, int32_t x, int32_t y, TextAlign alignment, Color color);
-void draw_cell(SDL_Renderer *renderer, int32_t row, int32_t col, uint8_t colorValue, int32_t xOffset, int32_t yOffset, bool outline);
-void draw_piece(SDL_Renderer *renderer, const PieceState *piece, int32_t xOffset, int32_t yOffset, bool outline);
-void render_game(const GameState *game, SDL_Renderer *renderer, TTF_Font *font);
+void render_draw_list(const std::vector<DrawCommand> *commands, SDL_Renderer *renderer, TTF_Font *font);
+template <typename Game> void render_game(const RenderSnapshot<Game> *snapshot, SDL_Renderer *renderer, TTF_Font *font);
+void run_simulation(Simulation *simulation);
+void start_grid_game(const GridSimulation *simulation, int32_t index, GridBoard *board);
+void step_grid_board(const GridSimulation *simulation, int32_t index, GridBoard *board);
+void run_grid_simulation(GridSimulation *simulation);
+SDL_Texture *create_atlas_texture(SDL_Renderer *renderer, const GlyphAtlas *atlas);
+void run_grid_view(SDL_Renderer *renderer, int32_t boardCount, uint64_t seed);
+uint8_t read_keyboard_keys(const uint8_t *keyStates);
+void run_versus_simulation(VersusSimulation *simulation);
+void run_versus_view(SDL_Renderer *renderer, VersusSimulation *simulation);
 
 /**
  * @brief Creates and fills the rectangle properties with the received parameters
@@ -94,168 +170,470 @@ void draw_string(SDL_Renderer *renderer, TTF_Font *font, const char *text, int32
 }
 
 /**
- * @brief - Creates the cell (i.e. any object that is) to be drawn on the SDL window
+ * @brief - Executes a draw list on the SDL renderer
  *
- * @param renderer - a pointer to SDL_Renderer* that renders the created cell
- * @param row - the row at which the cell is to be drawn
- * @param col - the column at which the cell is to be drawn
- * @param colorValue - index value for the various Color arrays
- * @param xOffset - x offset of the cell
- * @param yOffset - y offset of the cell
- * @param outline - if true, draws a silhouette of the tetromino piece on the board
+ * @param commands - draw list built by build_draw_list()
+ * @param renderer - a pointer to SDL_Renderer* that renders the commands
+ * @param font - a pointer to TTF_Font* holding the font type of the text to be rendererd
  */
-void draw_cell(SDL_Renderer *renderer, int32_t row, int32_t col, uint8_t colorValue, int32_t xOffset, int32_t yOffset, bool outline = false)
+void render_draw_list(const std::vector<DrawCommand> *commands, SDL_Renderer *renderer, TTF_Font *font)
 {
+    for (size_t i = 0; i < commands->size(); i++)
+    {
+        const DrawCommand *command = &(*commands)[i];
+        switch (command->kind)
+        {
+        case DRAW_FILL_RECT:
+            fill_rect(renderer, command->x, command->y, command->width, command->height, command->color);
+            break;
+        case DRAW_OUTLINE_RECT:
+            draw_rect(renderer, command->x, command->y, command->width, command->height, command->color);
+            break;
+        case DRAW_TEXT:
+            draw_string(renderer, font, command->text, command->x, command->y, command->alignment, command->color);
+            break;
+        }
+    }
+}
 
-    Color baseColor = BASE_COLORS[colorValue];
-    Color lightColor = LIGHT_COLORS[colorValue];
-    Color darkColor = DARK_COLORS[colorValue];
+/**
+ * @brief - Renders the game objects on the board
+ *
+ * @param snapshot - pointer to RenderSnapshot published by the simulation thread
+ * @param renderer - a pointer to SDL_Renderer* that renders the game object
+ * @param font - a pointer to TTF_Font* holding the font type of the text to be rendererd
+ */
+template <typename Game>
+void render_game(const RenderSnapshot<Game> *snapshot, SDL_Renderer *renderer, TTF_Font *font)
+{
+    static std::vector<DrawCommand> commands;
+    build_draw_list(snapshot, &commands);
+    render_draw_list(&commands, renderer, font);
+}
 
-    int32_t edge = GRID_SIZE / 8;
+/**
+ * @brief - Simulation thread. Steps the game at a fixed 60 frames per second and publishes
+ * a snapshot after each batch of steps.
+ * A slow render thread never delays a step.
+ *
+ * @param simulation - pointer to Simulation shared with the render thread
+ */
+void run_simulation(Simulation *simulation)
+{
+    const std::chrono::nanoseconds frameDuration(static_cast<int64_t>(TARGET_SECONDS_PER_FRAME * 1e9));
 
-    int32_t x = col * GRID_SIZE + xOffset;
-    int32_t y = row * GRID_SIZE + yOffset;
+    GameState *game = &simulation->game;
+    InputState input = {};
+    uint8_t heldKeys = 0;
+    uint32_t frame = 0;
+    int64_t lastRank = -1;
+    std::chrono::steady_clock::time_point nextFrameTime = std::chrono::steady_clock::now();
 
-    // Drawing a silhoutte if outline is true
-    if (outline)
+    while (simulation->running.load(std::memory_order_relaxed))
     {
-        draw_rect(renderer, x, y, GRID_SIZE, GRID_SIZE, baseColor);
-        return;
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        int32_t frames = 0;
+        while (now >= nextFrameTime && frames < SIMULATION_MAX_CATCH_UP_FRAMES)
+        {
+            // A key pressed and released between two steps is still held for one step
+            uint8_t keys;
+            uint8_t pressedKeys = 0;
+            while (pop_input_keys(&simulation->input, &keys))
+            {
+                pressedKeys |= keys;
+                heldKeys = keys;
+            }
+            apply_input_keys(&input, heldKeys | pressedKeys);
+
+            frame++;
+            game->frame = frame;
+            GamePhase prevPhase = game->phase;
+            update_game(game, &input);
+            if (simulation->leaderboardOpen && game->phase == GAME_PHASE_GAMEOVER && prevPhase != GAME_PHASE_GAMEOVER)
+            {
+                LeaderboardEntry entry = make_leaderboard_entry(game, 0);
+                lastRank = record_score(&simulation->leaderboard, &entry);
+            }
+
+            nextFrameTime += frameDuration;
+            frames++;
+        }
+        if (now >= nextFrameTime)
+        {
+            nextFrameTime = now + frameDuration;
+        }
+
+        if (frames > 0)
+        {
+            RenderSnapshot<GameState> *snapshot = get_write_snapshot(&simulation->snapshots);
+            capture_render_snapshot(game, frame, snapshot);
+            snapshot->leaderboardRank = lastRank;
+            snapshot->leaderboardSize = simulation->leaderboardOpen ? get_leaderboard_size(&simulation->leaderboard) : 0;
+            publish_snapshot(&simulation->snapshots);
+        }
+        std::this_thread::sleep_until(nextFrameTime);
     }
+}
+
+/**
+ * @brief Starts the next game of a board of the spectator wall and leaves its start screen
+ *
+ * @param simulation - pointer to GridSimulation owning the board
+ * @param index - index of the board on the wall
+ * @param board - pointer to the board
+ */
+void start_grid_game(const GridSimulation *simulation, int32_t index, GridBoard *board)
+{
+    uint32_t seed = static_cast<uint32_t>((simulation->seed * GRID_VIEW_MAX_BOARDS + index) * 2654435761u + board->games * 40503u);
+    init_replay_game(&board->game, seed ? seed : 1);
+    board->games++;
+    board->frame = 0;
+    board->waitFrames = 0;
 
-    // Filling the dark color first followed by light color and then by base color to generate nice affects
-    fill_rect(renderer, x, y, GRID_SIZE, GRID_SIZE, darkColor);
-    fill_rect(renderer, x + edge, y + edge, GRID_SIZE - edge, GRID_SIZE - edge, lightColor);
-    fill_rect(renderer, x + edge, y + edge, GRID_SIZE - edge * 2, GRID_SIZE - edge * 2, baseColor);
+    InputState input = {};
+    input.a = 1;
+    input.deltaA = 1;
+    board->frame++;
+    board->game.frame = board->frame;
+    update_game(&board->game, &input);
 }
 
 /**
- * @brief - Draws the tetromino piece on the SDL window
+ * @brief Steps a board of the spectator wall by one frame. The bot lets every piece fall
+ * for GRID_BOT_DELAY_FRAMES, then moves it to its chosen placement and hard drops it.
  *
- * @param renderer - a pointer to SDL_Renderer* for renderering the piece
- * @param piece - piece to be rendered
- * @param xOffset - x offset of the piece when placed on the SDL window
- * @param yOffset - y offset of the piece when placed on the SDL window
- * @param outline - if true, draws a silhouette of the tetromino piece on the board
+ * @param simulation - pointer to GridSimulation owning the board
+ * @param index - index of the board on the wall
+ * @param board - pointer to the board
  */
-void draw_piece(SDL_Renderer *renderer, const PieceState *piece, int32_t xOffset, int32_t yOffset, bool outline = false)
+void step_grid_board(const GridSimulation *simulation, int32_t index, GridBoard *board)
 {
-    const Tetromino *tetromino = TETROMINOS + piece->tetrominoIndex;
-    for (int32_t row = 0; row < tetromino->side; row++)
+    GameState *game = &board->game;
+    InputState input = {};
+    board->waitFrames++;
+    if (game->phase == GAME_PHASE_GAMEOVER)
     {
-        for (int32_t col = 0; col < tetromino->side; col++)
+        if (board->waitFrames >= GRID_RESTART_FRAMES)
         {
-            uint8_t value = tetromino_get(tetromino, row, col, piece->rotation);
-            if (value)
-            {
-                draw_cell(renderer, row + piece->offsetRow, col + piece->offsetCol, value, xOffset, yOffset, outline);
-            }
+            start_grid_game(simulation, index, board);
         }
+        return;
     }
+    if (game->phase == GAME_PHASE_PLAY && board->waitFrames >= GRID_BOT_DELAY_FRAMES)
+    {
+        PieceState best;
+        int32_t score;
+        if (choose_placement(game, &best, &score))
+        {
+            game->piece = best;
+        }
+        input.a = 1;
+        input.deltaA = 1;
+        board->waitFrames = 0;
+    }
+    else if (game->phase != GAME_PHASE_PLAY)
+    {
+        board->waitFrames = 0;
+    }
+
+    board->frame++;
+    game->frame = board->frame;
+    update_game(game, &input);
 }
 
 /**
- * @brief - Draws the game board on the SDL window
+ * @brief - Simulation thread of the spectator wall. Steps every board at a fixed 60 frames
+ * per second, like run_simulation(), and publishes a snapshot of each board after each batch of steps.
  *
- * @param renderer - a pointer to SDL_Renderer* for renderering the board
- * @param board - the board to be rendered
- * @param width - width of the board
- * @param height - height of the board
- * @param xOffset - x offset of the board when placed on the SDL window
- * @param yOffset - y offset of the board when placed on the SDL window
+ * @param simulation - pointer to GridSimulation shared with the render thread
  */
-void draw_board(SDL_Renderer *renderer, const uint8_t *board, int32_t width, int32_t height, int32_t xOffset, int32_t yOffset)
+void run_grid_simulation(GridSimulation *simulation)
 {
-    for (int32_t row = 0; row < height; row++)
+    const std::chrono::nanoseconds frameDuration(static_cast<int64_t>(TARGET_SECONDS_PER_FRAME * 1e9));
+    std::chrono::steady_clock::time_point nextFrameTime = std::chrono::steady_clock::now();
+
+    while (simulation->running.load(std::memory_order_relaxed))
     {
-        for (int32_t col = 0; col < width; col++)
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        int32_t frames = 0;
+        while (now >= nextFrameTime && frames < SIMULATION_MAX_CATCH_UP_FRAMES)
+        {
+            for (int32_t i = 0; i < simulation->boardCount; i++)
+            {
+                step_grid_board(simulation, i, &simulation->boards[i]);
+            }
+            nextFrameTime += frameDuration;
+            frames++;
+        }
+        if (now >= nextFrameTime)
+        {
+            nextFrameTime = now + frameDuration;
+        }
+
+        if (frames > 0)
         {
-            uint8_t value = matrix_get(board, width, row, col);
-            draw_cell(renderer, row, col, value, xOffset, yOffset);
-            // if (value)
-            // {
-            //     draw_cell(renderer, row, col, value, xOffset, yOffset);
-            // }
+            for (int32_t i = 0; i < simulation->boardCount; i++)
+            {
+                const GridBoard *board = &simulation->boards[i];
+                RenderSnapshot<GameState> *snapshot = get_write_snapshot(&simulation->snapshots[i]);
+                capture_render_snapshot(&board->game, board->frame, snapshot);
+                snapshot->leaderboardRank = -1;
+                snapshot->leaderboardSize = 0;
+                publish_snapshot(&simulation->snapshots[i]);
+            }
         }
+        std::this_thread::sleep_until(nextFrameTime);
     }
 }
 
 /**
- * @brief - Renders the game objects on the board
+ * @brief Uploads the glyph atlas of the grid geometry to a texture
  *
- * @param game - pointer to GameState that contains the current state of the game
- * @param renderer - a pointer to SDL_Renderer* that renders the game object
- * @param font - a pointer to TTF_Font* holding the font type of the text to be rendererd
+ * @param renderer - a pointer to SDL_Renderer* of the window
+ * @param atlas - pointer to the glyph atlas
+ * @return SDL_Texture* - texture of the atlas, blended by its alpha
+ */
+SDL_Texture *create_atlas_texture(SDL_Renderer *renderer, const GlyphAtlas *atlas)
+{
+    static_assert(sizeof(GridVertex) == sizeof(SDL_Vertex) && offsetof(GridVertex, color) == offsetof(SDL_Vertex, color) &&
+                      offsetof(GridVertex, u) == offsetof(SDL_Vertex, tex_coord),
+                  "grid vertices are passed to SDL_RenderGeometry() as they are");
+
+    SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, atlas->width, atlas->height);
+    SDL_UpdateTexture(texture, NULL, atlas->pixels.data(), atlas->width * 4);
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    return texture;
+}
+
+/**
+ * @brief - Runs the spectator wall until the window is closed: boardCount bot games tiled
+ * in the window, all drawn with one geometry call textured by the glyph atlas
+ *
+ * @param renderer - a pointer to SDL_Renderer* of the window
+ * @param boardCount - number of games on the wall
+ * @param seed - seed of the games
  */
-void render_game(const GameState *game, SDL_Renderer *renderer, TTF_Font *font)
+void run_grid_view(SDL_Renderer *renderer, int32_t boardCount, uint64_t seed)
 {
+    GlyphAtlas atlas;
+    init_glyph_atlas(&atlas);
+    SDL_Texture *atlasTexture = create_atlas_texture(renderer, &atlas);
 
-    int32_t paddingY = 60;
+    GridLayout layout;
+    layout_grid<GameState>(boardCount, GRID_VIEW_WINDOW_WIDTH, GRID_VIEW_WINDOW_HEIGHT, &layout);
 
-    draw_board(renderer, game->board, WIDTH, HEIGHT, 0, paddingY);
-    if (game->phase == GAME_PHASE_PLAY)
+    GridSimulation *simulation = new GridSimulation();
+    simulation->boardCount = boardCount;
+    simulation->seed = seed;
+    for (int32_t i = 0; i < boardCount; i++)
     {
-        draw_piece(renderer, &game->piece, 0, paddingY);
+        init_snapshot_buffer(&simulation->snapshots[i]);
+        start_grid_game(simulation, i, &simulation->boards[i]);
+    }
+    simulation->running.store(true);
+    std::thread simulationThread(run_grid_simulation, simulation);
 
-        PieceState piece = game->piece;
-        while (check_piece_valid(&piece, game->board, WIDTH, HEIGHT))
+    const RenderSnapshot<GameState> *snapshots[GRID_VIEW_MAX_BOARDS];
+    GridGeometry geometry;
+    bool quit = false;
+    while (!quit)
+    {
+        SDL_Event e;
+        while (SDL_PollEvent(&e) != 0)
         {
-            piece.offsetRow++;
+            if (e.type == SDL_QUIT)
+            {
+                quit = true;
+            }
         }
-        piece.offsetRow--;
-    
-        // Draw the silhouette of the piece
-        draw_piece(renderer, &piece, 0, paddingY, true);
+
+        // Quit when escape key is pressed
+        if (SDL_GetKeyboardState(NULL)[SDL_SCANCODE_ESCAPE])
+        {
+            quit = true;
+        }
+
+        for (int32_t i = 0; i < boardCount; i++)
+        {
+            snapshots[i] = acquire_snapshot(&simulation->snapshots[i]);
+        }
+        build_grid_geometry(snapshots, &layout, &atlas, &geometry);
+
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+        SDL_RenderClear(renderer);
+        SDL_RenderGeometry(renderer, atlasTexture, reinterpret_cast<const SDL_Vertex *>(geometry.vertices.data()),
+                           static_cast<int>(geometry.vertices.size()), geometry.indices.data(), static_cast<int>(geometry.indices.size()));
+        SDL_RenderPresent(renderer);
     }
 
-    // Highlights the filled lines which will be cleared from the screen
-    Color highlightColor = color(0xFF, 0xFF, 0xFF, 0xFF);
-    if (game->phase == GAME_PHASE_LINE)
+    simulation->running.store(false);
+    simulationThread.join();
+    delete simulation;
+    SDL_DestroyTexture(atlasTexture);
+}
+
+/**
+ * @brief Packs the keys held on the keyboard
+ *
+ * @param keyStates - keyboard state from SDL_GetKeyboardState()
+ * @return uint8_t - packed InputKey bits
+ */
+uint8_t read_keyboard_keys(const uint8_t *keyStates)
+{
+    return static_cast<uint8_t>((keyStates[SDL_SCANCODE_LEFT] ? INPUT_KEY_LEFT : 0) |
+                                (keyStates[SDL_SCANCODE_RIGHT] ? INPUT_KEY_RIGHT : 0) |
+                                (keyStates[SDL_SCANCODE_UP] ? INPUT_KEY_UP : 0) |
+                                (keyStates[SDL_SCANCODE_DOWN] ? INPUT_KEY_DOWN : 0) |
+                                (keyStates[SDL_SCANCODE_SPACE] ? INPUT_KEY_A : 0) |
+                                (keyStates[SDL_SCANCODE_Z] ? INPUT_KEY_B : 0));
+}
+
+/**
+ * @brief - Simulation thread of a versus match. Ticks the rollback session at a fixed 60
+ * ticks per second, like run_simulation(), and publishes a snapshot of both games after
+ * each batch of ticks, rollbacks included.
+ *
+ * @param simulation - pointer to VersusSimulation shared with the render thread
+ */
+void run_versus_simulation(VersusSimulation *simulation)
+{
+    const std::chrono::nanoseconds frameDuration(static_cast<int64_t>(TARGET_SECONDS_PER_FRAME * 1e9));
+    RollbackSession *session = &simulation->session;
+    uint8_t heldKeys = 0;
+    uint8_t pressedKeys = 0;
+    std::chrono::steady_clock::time_point nextFrameTime = std::chrono::steady_clock::now();
+
+    while (simulation->running.load(std::memory_order_relaxed))
     {
-        for (int32_t row = 0; row < HEIGHT; row++)
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        int32_t frames = 0;
+        while (now >= nextFrameTime && frames < SIMULATION_MAX_CATCH_UP_FRAMES)
         {
-            if (game->lines[row])
+            // A key pressed and released between two frames is still held for one frame
+            uint8_t keys;
+            while (pop_input_keys(&simulation->input, &keys))
+            {
+                pressedKeys |= keys;
+                heldKeys = keys;
+            }
+            if (advance_rollback_session(session, heldKeys | pressedKeys))
             {
-                int32_t x = 0;
-                int32_t y = row * GRID_SIZE + paddingY;
+                pressedKeys = 0;
+            }
+
+            nextFrameTime += frameDuration;
+            frames++;
+        }
+        if (now >= nextFrameTime)
+        {
+            nextFrameTime = now + frameDuration;
+        }
 
-                fill_rect(renderer, x, y, WIDTH * GRID_SIZE, GRID_SIZE, highlightColor);
+        if (frames > 0)
+        {
+            for (int32_t player = 0; player < VERSUS_PLAYERS; player++)
+            {
+                RenderSnapshot<GameState> *snapshot = get_write_snapshot(&simulation->snapshots[player]);
+                capture_render_snapshot(&session->state.games[player], session->state.frame, snapshot);
+                snapshot->leaderboardRank = -1;
+                snapshot->leaderboardSize = 0;
+                publish_snapshot(&simulation->snapshots[player]);
             }
         }
+        std::this_thread::sleep_until(nextFrameTime);
     }
-    else if (game->phase == GAME_PHASE_GAMEOVER)
+}
+
+/**
+ * @brief - Runs a versus match until the window is closed: the local game and the remote
+ * one side by side, drawn like the spectator wall
+ *
+ * @param renderer - a pointer to SDL_Renderer* of the window
+ * @param simulation - pointer to VersusSimulation with an open session
+ */
+void run_versus_view(SDL_Renderer *renderer, VersusSimulation *simulation)
+{
+    GlyphAtlas atlas;
+    init_glyph_atlas(&atlas);
+    SDL_Texture *atlasTexture = create_atlas_texture(renderer, &atlas);
+
+    GridLayout layout;
+    layout_grid<GameState>(VERSUS_PLAYERS, VERSUS_WINDOW_WIDTH, WINDOW_HEIGHT, &layout);
+
+    for (int32_t player = 0; player < VERSUS_PLAYERS; player++)
     {
-        int32_t x = WIDTH * GRID_SIZE / 2;
-        int32_t y = HEIGHT * GRID_SIZE / 2;
-        draw_string(renderer, font, "GAME OVER", x, y, TEXT_ALIGN_CENTER, highlightColor);
+        init_snapshot_buffer(&simulation->snapshots[player]);
     }
-    else if (game->phase == GAME_PHASE_START)
+    simulation->input.head.store(0);
+    simulation->input.tail.store(0);
+    simulation->running.store(true);
+    std::thread simulationThread(run_versus_simulation, simulation);
+
+    const RenderSnapshot<GameState> *snapshots[VERSUS_PLAYERS];
+    GridGeometry geometry;
+    bool quit = false;
+    while (!quit)
     {
-        int32_t x = WIDTH * GRID_SIZE / 2;
-        int32_t y = HEIGHT * GRID_SIZE / 2;
-        draw_string(renderer, font, "PRESS SPACE TO START", x, y, TEXT_ALIGN_CENTER, highlightColor);
+        SDL_Event e;
+        while (SDL_PollEvent(&e) != 0)
+        {
+            if (e.type == SDL_QUIT)
+            {
+                quit = true;
+            }
+        }
 
-        string buffer = "STARTING LEVEL: " + to_string(game->startLevel);
-        draw_string(renderer, font, buffer.c_str(), x, y + 30, TEXT_ALIGN_CENTER, highlightColor);
-    }
+        const uint8_t *keyStates = SDL_GetKeyboardState(NULL);
 
-    fill_rect(renderer, 0, paddingY, WIDTH * GRID_SIZE, (HEIGHT - VISIBLE_HEIGHT) * GRID_SIZE, color(0x00, 0x00, 0x00, 0x00));
+        // Quit when escape key is pressed
+        if (keyStates[SDL_SCANCODE_ESCAPE])
+        {
+            quit = true;
+        }
+        push_input_keys(&simulation->input, read_keyboard_keys(keyStates));
 
-    // Display the level
-    string buffer = "LEVEL: " + to_string(game->level);
-    draw_string(renderer, font, buffer.c_str(), 5, 5, TEXT_ALIGN_LEFT, highlightColor);
+        for (int32_t player = 0; player < VERSUS_PLAYERS; player++)
+        {
+            snapshots[player] = acquire_snapshot(&simulation->snapshots[player]);
+        }
+        build_grid_geometry(snapshots, &layout, &atlas, &geometry);
 
-    // Display the score
-    buffer = "SCORE: " + to_string(game->score);
-    draw_string(renderer, font, buffer.c_str(), 5, 35, TEXT_ALIGN_LEFT, highlightColor);
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+        SDL_RenderClear(renderer);
+        SDL_RenderGeometry(renderer, atlasTexture, reinterpret_cast<const SDL_Vertex *>(geometry.vertices.data()),
+                           static_cast<int>(geometry.vertices.size()), geometry.indices.data(), static_cast<int>(geometry.indices.size()));
+        SDL_RenderPresent(renderer);
+    }
 
-    // Display the line count
-    buffer = "LINES: " + to_string(game->lineCount);
-    draw_string(renderer, font, buffer.c_str(), 5, 65, TEXT_ALIGN_LEFT, highlightColor);
+    simulation->running.store(false);
+    simulationThread.join();
+    SDL_DestroyTexture(atlasTexture);
 }
 
-int main(void)
+int main(int argc, char **argv)
 {
+    // tetris.o grid [boards] [seed] shows a wall of bot games instead of a playable game
+    bool grid = argc > 1 && strcmp(argv[1], "grid") == 0;
+    int32_t boardCount = grid && argc > 2 ? atoi(argv[2]) : GRID_VIEW_MAX_BOARDS;
+    uint64_t seed = grid && argc > 3 ? strtoull(argv[3], NULL, 10) : 1;
+    boardCount = boardCount < 1 ? 1 : (boardCount > GRID_VIEW_MAX_BOARDS ? GRID_VIEW_MAX_BOARDS : boardCount);
+
+    // tetris.o versus <local port> <remote address> <remote port> <player> [seed] plays a match against another peer
+    bool versus = argc > 5 && strcmp(argv[1], "versus") == 0;
+    VersusSimulation *versusSimulation = NULL;
+    if (versus)
+    {
+        versusSimulation = new VersusSimulation();
+        uint32_t versusSeed = argc > 6 ? static_cast<uint32_t>(atoi(argv[6])) : 1;
+        if (!open_rollback_session(&versusSimulation->session, static_cast<uint16_t>(atoi(argv[2])), argv[3],
+                                   static_cast<uint16_t>(atoi(argv[4])), atoi(argv[5]), versusSeed))
+        {
+            cerr << "Could not open the versus session on port " << argv[2] << endl;
+            delete versusSimulation;
+            return 1;
+        }
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO) < 0)
     {
         return 1;
@@ -266,23 +644,49 @@ int main(void)
         return 2;
     }
 
-    SDL_Window *window = SDL_CreateWindow("Tetris", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 420, 720, SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN);
+    int32_t windowWidth = grid ? GRID_VIEW_WINDOW_WIDTH : (versus ? VERSUS_WINDOW_WIDTH : GameState::BOARD_WIDTH * GRID_SIZE);
+    int32_t windowHeight = grid ? GRID_VIEW_WINDOW_HEIGHT : WINDOW_HEIGHT;
+    SDL_Window *window = SDL_CreateWindow("Tetris", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, windowWidth, windowHeight, SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN);
     SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    if (grid)
+    {
+        run_grid_view(renderer, boardCount, seed);
+        SDL_DestroyRenderer(renderer);
+        SDL_Quit();
+        return 0;
+    }
+    if (versus)
+    {
+        run_versus_view(renderer, versusSimulation);
+        close_rollback_session(&versusSimulation->session);
+        delete versusSimulation;
+        SDL_DestroyRenderer(renderer);
+        SDL_Quit();
+        return 0;
+    }
 
     const char *fontName = "./chicken_pie/chicken_pie.ttf";
     TTF_Font *font = TTF_OpenFont(fontName, 16);
 
-    GameState game = {};
-    InputState input = {};
+    Simulation *simulation = new Simulation();
+    GameState *game = &simulation->game;
+    init_snapshot_buffer(&simulation->snapshots);
+    simulation->input.head.store(0);
+    simulation->input.tail.store(0);
+
+    // High scores persist across runs, the game is still playable without them
+    simulation->leaderboardOpen = open_leaderboard(&simulation->leaderboard, "./tetris_scores", false);
 
-    spawn_piece(&game);
+    spawn_piece(game);
 
-    game.piece.tetrominoIndex = 2;
+    game->piece.tetrominoIndex = 2;
+
+    simulation->running.store(true);
+    std::thread simulationThread(run_simulation, simulation);
 
     bool quit = false;
     while (!quit)
     {
-        game.time = SDL_GetTicks() / 1000.0;
         SDL_Event e;
         while (SDL_PollEvent(&e) != 0)
         {
@@ -301,32 +705,27 @@ int main(void)
             quit = true;
         }
 
-        InputState prevInput = input;
-
-        input.left = keyStates[SDL_SCANCODE_LEFT];
-        input.right = keyStates[SDL_SCANCODE_RIGHT];
-        input.up = keyStates[SDL_SCANCODE_UP];
-        input.down = keyStates[SDL_SCANCODE_DOWN];
-        input.a = keyStates[SDL_SCANCODE_SPACE];
-
-        input.deltaLeft = input.left - prevInput.left;
-        input.deltaRight = input.right - prevInput.right;
-        input.deltaUp = input.up - prevInput.up;
-        input.deltaDown = input.down - prevInput.down;
-        input.deltaA = input.a - prevInput.a;
+        push_input_keys(&simulation->input, read_keyboard_keys(keyStates));
 
         SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
         SDL_RenderClear(renderer);
 
-        update_game(&game, &input);
-        render_game(&game, renderer, font);
+        render_game(acquire_snapshot(&simulation->snapshots), renderer, font);
 
         SDL_RenderPresent(renderer);
     }
 
+    simulation->running.store(false);
+    simulationThread.join();
+    if (simulation->leaderboardOpen)
+    {
+        close_leaderboard(&simulation->leaderboard);
+    }
+    delete simulation;
+
     TTF_CloseFont(font);
     SDL_DestroyRenderer(renderer);
     SDL_Quit();
 
     return 0;
-}
\ No newline at end of file
+}
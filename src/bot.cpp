@@ -0,0 +1,93 @@
+#include <vector>
+#include "../inc/bot.h"
+#include "../inc/placement.h"
+
+/**
+ * @brief Scores a board after a placement, higher is better
+ *
+ * @param game - pointer to the game holding the board
+ * @param lineCount - number of lines the placement cleared
+ * @return int32_t - weighted sum of the board features
+ */
+int32_t evaluate_board(const GameState *game, int32_t lineCount)
+{
+    int32_t heights[GameState::BOARD_WIDTH];
+    int32_t aggregateHeight = 0;
+    int32_t holes = 0;
+    for (int32_t col = 0; col < GameState::BOARD_WIDTH; col++)
+    {
+        int32_t row = 0;
+        while (row < GameState::BOARD_HEIGHT && !((game->rows[row] >> col) & 1))
+        {
+            row++;
+        }
+        heights[col] = GameState::BOARD_HEIGHT - row;
+        aggregateHeight += heights[col];
+        for (; row < GameState::BOARD_HEIGHT; row++)
+        {
+            holes += !((game->rows[row] >> col) & 1);
+        }
+    }
+
+    int32_t bumpiness = 0;
+    for (int32_t col = 1; col < GameState::BOARD_WIDTH; col++)
+    {
+        bumpiness += heights[col] > heights[col - 1] ? heights[col] - heights[col - 1] : heights[col - 1] - heights[col];
+    }
+
+    return BOT_WEIGHT_HEIGHT * aggregateHeight + BOT_WEIGHT_LINES * lineCount + BOT_WEIGHT_HOLES * holes +
+           BOT_WEIGHT_BUMPINESS * bumpiness;
+}
+
+/**
+ * @brief Chooses where to place the current piece of a game. Ties keep the placement found first.
+ *
+ * @param game - pointer to the game, its piece is the one to place
+ * @param best - receives the chosen placement
+ * @param bestScore - receives the score of the board the placement leaves
+ * @return true - a placement was chosen
+ * @return false - the piece cannot move from where it is, best and bestScore are left untouched
+ */
+bool choose_placement(const GameState *game, PieceState *best, int32_t *bestScore)
+{
+    // Reused across calls, only the occupancy masks of the scratch board are read
+    static thread_local std::vector<PieceState> placements;
+    static thread_local GameState scratchGame;
+    GameState *scratch = &scratchGame;
+    find_placements(game, &game->piece, &placements);
+
+    bool found = false;
+    for (size_t i = 0; i < placements.size(); i++)
+    {
+        memcpy(scratch->rows, game->rows, sizeof(scratch->rows));
+        int32_t lineCount = place_piece(scratch, &placements[i]);
+        int32_t score = lineCount < 0 ? BOT_GAME_OVER_SCORE : evaluate_board(scratch, lineCount);
+        if (!found || score > *bestScore)
+        {
+            *bestScore = score;
+            *best = placements[i];
+            found = true;
+        }
+    }
+    return found;
+}
+
+/**
+ * @brief Fingerprints everything that decides the choices of the bot: its weights and the
+ * version of the placement rules. Stored decisions (eval_cache.h) are only reused by a
+ * bot with the same fingerprint.
+ *
+ * @return uint64_t - FNV-1a hash of the weights and PLACEMENT_VERSION
+ */
+uint64_t get_bot_fingerprint()
+{
+    const int64_t values[] = {BOT_WEIGHT_HEIGHT, BOT_WEIGHT_LINES, BOT_WEIGHT_HOLES, BOT_WEIGHT_BUMPINESS,
+                              BOT_GAME_OVER_SCORE, PLACEMENT_VERSION};
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(values);
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < sizeof(values); i++)
+    {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
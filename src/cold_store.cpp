@@ -0,0 +1,154 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "../inc/cold_store.h"
+
+// Function Prototypes
+static bool grow_cold_store(ColdStore *store);
+
+/**
+ * @brief Creates (or truncates) the backing file and maps it
+ *
+ * @param store - pointer to ColdStore to be opened
+ * @param path - path of the backing file
+ * @return true - store opened
+ * @return false - the file could not be created or mapped
+ */
+bool open_cold_store(ColdStore *store, const char *path)
+{
+    store->fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    store->slots = NULL;
+    store->capacity = 0;
+    store->used = 0;
+    store->freeSlots.clear();
+    if (store->fd < 0)
+    {
+        return false;
+    }
+    if (!grow_cold_store(store))
+    {
+        close(store->fd);
+        store->fd = -1;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Unmaps and closes the backing file. The packed games are discarded.
+ *
+ * @param store - pointer to ColdStore to be closed
+ */
+void close_cold_store(ColdStore *store)
+{
+    if (store->slots)
+    {
+        munmap(store->slots, static_cast<size_t>(store->capacity) * sizeof(ColdSlot));
+    }
+    if (store->fd >= 0)
+    {
+        close(store->fd);
+    }
+    store->fd = -1;
+    store->slots = NULL;
+    store->capacity = 0;
+    store->freeSlots.clear();
+}
+
+/**
+ * @brief Extends the backing file by COLD_STORE_GROWTH_SLOTS slots and remaps it
+ *
+ * @param store - pointer to ColdStore to be grown
+ * @return true - store grown
+ * @return false - the file could not be extended or remapped
+ */
+static bool grow_cold_store(ColdStore *store)
+{
+    size_t oldSize = static_cast<size_t>(store->capacity) * sizeof(ColdSlot);
+    size_t newSize = oldSize + static_cast<size_t>(COLD_STORE_GROWTH_SLOTS) * sizeof(ColdSlot);
+    if (ftruncate(store->fd, static_cast<off_t>(newSize)) < 0)
+    {
+        return false;
+    }
+
+    void *mapping = store->slots ? mremap(store->slots, oldSize, newSize, MREMAP_MAYMOVE)
+                                 : mmap(NULL, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, store->fd, 0);
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+
+    store->slots = static_cast<ColdSlot *>(mapping);
+    store->capacity += COLD_STORE_GROWTH_SLOTS;
+    return true;
+}
+
+/**
+ * @brief Packs a game into a free slot of the store. The page cache writes it back to the
+ * backing file and reclaims it under memory pressure.
+ *
+ * @param store - pointer to ColdStore receiving the game
+ * @param sessionId - id of the session owning the game, must not be 0
+ * @param game - pointer to GameState to be paged out
+ * @return int64_t - slot holding the game or -1 if the store could not grow
+ */
+int64_t page_out_game(ColdStore *store, uint32_t sessionId, const GameState *game)
+{
+    uint32_t slot;
+    if (!store->freeSlots.empty())
+    {
+        slot = store->freeSlots.back();
+        store->freeSlots.pop_back();
+    }
+    else
+    {
+        if (store->used == store->capacity && !grow_cold_store(store))
+        {
+            return -1;
+        }
+        slot = store->used++;
+    }
+
+    pack_game_state(game, &store->slots[slot].state);
+    store->slots[slot].sessionId = sessionId;
+    return slot;
+}
+
+/**
+ * @brief Restores a game from its slot and frees the slot
+ *
+ * @param store - pointer to ColdStore holding the game
+ * @param slot - slot returned by page_out_game()
+ * @param sessionId - id of the session owning the game
+ * @param game - pointer to GameState receiving the game
+ * @return true - game restored
+ * @return false - the slot does not belong to the session
+ */
+bool page_in_game(ColdStore *store, uint32_t slot, uint32_t sessionId, GameState *game)
+{
+    if (slot >= store->used || store->slots[slot].sessionId != sessionId)
+    {
+        return false;
+    }
+
+    unpack_game_state(&store->slots[slot].state, game);
+    store->slots[slot].sessionId = 0;
+    store->freeSlots.push_back(slot);
+    return true;
+}
+
+/**
+ * @brief Frees the slot of a game that will not be restored (its session was closed)
+ *
+ * @param store - pointer to ColdStore holding the game
+ * @param slot - slot returned by page_out_game()
+ * @param sessionId - id of the session owning the game
+ */
+void free_cold_slot(ColdStore *store, uint32_t slot, uint32_t sessionId)
+{
+    if (slot < store->used && store->slots[slot].sessionId == sessionId)
+    {
+        store->slots[slot].sessionId = 0;
+        store->freeSlots.push_back(slot);
+    }
+}
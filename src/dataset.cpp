@@ -0,0 +1,604 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../inc/dataset.h"
+
+#define DATASET_ZERO_RUN 0x80 // Control bytes from here on are runs of (c - 0x7F) zero bytes, below it literals of c + 1 bytes
+
+static_assert(sizeof(DatasetHeader) % 8 == 0 && sizeof(DatasetIndexEntry) % 8 == 0, "file structures keep 8 byte alignment");
+
+// Function Prototypes
+inline size_t align_dataset_size(size_t size);
+static bool write_dataset_bytes(DatasetWriter *writer, const void *data, size_t size, uint64_t offset);
+static void append_dataset_block(DatasetWriter *writer, const void *data, size_t size, uint32_t rowCount);
+static bool read_dataset_block_header(const DatasetReader *reader, uint64_t offset, const DatasetBlockHeader **header);
+
+/**
+ * @brief Rounds a size up to a multiple of 8 bytes
+ *
+ * @param size - size in bytes
+ * @return size_t - aligned size
+ */
+inline size_t align_dataset_size(size_t size)
+{
+    return (size + 7) & ~static_cast<size_t>(7);
+}
+
+/**
+ * @brief Packs the occupancy of a board, BOARD_WIDTH bits per row with the rows back to back
+ *
+ * @param game - pointer to the game
+ * @param board - receives DATASET_BOARD_BYTES bytes
+ */
+void pack_dataset_board(const GameState *game, uint8_t *board)
+{
+    memset(board, 0, DATASET_BOARD_BYTES);
+    for (int32_t row = 0; row < GameState::BOARD_HEIGHT; row++)
+    {
+        uint32_t bit = row * GameState::BOARD_WIDTH;
+        for (uint32_t mask = game->rows[row]; mask; mask &= mask - 1)
+        {
+            uint32_t index = bit + static_cast<uint32_t>(__builtin_ctz(mask));
+            board[index >> 3] |= static_cast<uint8_t>(1 << (index & 7));
+        }
+    }
+}
+
+/**
+ * @brief Compresses one column of a block: XOR with the previous row, byte transposition, zero run-length encoding
+ *
+ * @param values - rowCount values of width bytes
+ * @param rowCount - number of rows
+ * @param width - width of a value in bytes
+ * @param transposed - scratch of rowCount * width bytes
+ * @param encoded - receives the encoded column, needs rowCount * width * 129 / 128 + 1 bytes
+ * @return size_t - encoded size in bytes
+ */
+size_t encode_dataset_column(const uint8_t *values, uint32_t rowCount, uint32_t width, uint8_t *transposed, uint8_t *encoded)
+{
+    for (uint32_t b = 0; b < width; b++)
+    {
+        uint8_t previous = 0;
+        for (uint32_t row = 0; row < rowCount; row++)
+        {
+            uint8_t value = values[row * width + b];
+            transposed[b * rowCount + row] = value ^ previous;
+            previous = value;
+        }
+    }
+
+    size_t size = static_cast<size_t>(rowCount) * width;
+    size_t length = 0;
+    size_t i = 0;
+    while (i < size)
+    {
+        if (transposed[i] == 0)
+        {
+            size_t run = 1;
+            while (i + run < size && run < 128 && transposed[i + run] == 0)
+            {
+                run++;
+            }
+            encoded[length++] = static_cast<uint8_t>(DATASET_ZERO_RUN + run - 1);
+            i += run;
+            continue;
+        }
+
+        // Literal up to the next pair of zeros, a lone zero is cheaper inside the literal
+        size_t end = i + 1;
+        while (end < size && end - i < 128 && !(transposed[end] == 0 && end + 1 < size && transposed[end + 1] == 0))
+        {
+            end++;
+        }
+        encoded[length++] = static_cast<uint8_t>(end - i - 1);
+        memcpy(encoded + length, transposed + i, end - i);
+        length += end - i;
+        i = end;
+    }
+    return length;
+}
+
+/**
+ * @brief Decompresses one column encoded by encode_dataset_column()
+ *
+ * @param encoded - encoded column
+ * @param size - encoded size in bytes
+ * @param rowCount - number of rows
+ * @param width - width of a value in bytes
+ * @param transposed - scratch of rowCount * width bytes
+ * @param values - receives rowCount values of width bytes
+ * @return true - column decoded
+ * @return false - the encoded column is corrupt
+ */
+bool decode_dataset_column(const uint8_t *encoded, size_t size, uint32_t rowCount, uint32_t width, uint8_t *transposed, uint8_t *values)
+{
+    size_t total = static_cast<size_t>(rowCount) * width;
+    size_t length = 0;
+    size_t i = 0;
+    while (i < size)
+    {
+        uint8_t control = encoded[i++];
+        if (control >= DATASET_ZERO_RUN)
+        {
+            size_t run = control - DATASET_ZERO_RUN + 1;
+            if (length + run > total)
+            {
+                return false;
+            }
+            memset(transposed + length, 0, run);
+            length += run;
+        }
+        else
+        {
+            size_t run = control + 1u;
+            if (length + run > total || i + run > size)
+            {
+                return false;
+            }
+            memcpy(transposed + length, encoded + i, run);
+            length += run;
+            i += run;
+        }
+    }
+    if (length != total)
+    {
+        return false;
+    }
+
+    for (uint32_t b = 0; b < width; b++)
+    {
+        uint8_t previous = 0;
+        for (uint32_t row = 0; row < rowCount; row++)
+        {
+            previous ^= transposed[b * rowCount + row];
+            values[row * width + b] = previous;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Writes bytes at an offset of the dataset file
+ *
+ * @param writer - pointer to the writer
+ * @param data - bytes to be written
+ * @param size - number of bytes
+ * @param offset - offset in the file
+ * @return true - bytes written
+ * @return false - the write failed
+ */
+static bool write_dataset_bytes(DatasetWriter *writer, const void *data, size_t size, uint64_t offset)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    while (size > 0)
+    {
+        ssize_t result = pwrite(writer->fd, bytes, size, static_cast<off_t>(offset));
+        if (result <= 0)
+        {
+            return false;
+        }
+        bytes += result;
+        size -= static_cast<size_t>(result);
+        offset += static_cast<uint64_t>(result);
+    }
+    return true;
+}
+
+/**
+ * @brief Creates (or truncates) a dataset file and writes its header
+ *
+ * @param writer - pointer to DatasetWriter to be opened
+ * @param path - path of the dataset file
+ * @return true - writer opened
+ * @return false - the file could not be created
+ */
+bool open_dataset_writer(DatasetWriter *writer, const char *path)
+{
+    writer->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    writer->offset = 0;
+    writer->rowCount = 0;
+    writer->index.clear();
+    writer->failed = false;
+    if (writer->fd < 0)
+    {
+        return false;
+    }
+
+    DatasetHeader header = {};
+    header.magic = DATASET_MAGIC;
+    header.version = DATASET_VERSION;
+    header.columnCount = DATASET_COLUMN_COUNT;
+    header.boardWidth = GameState::BOARD_WIDTH;
+    header.boardHeight = GameState::BOARD_HEIGHT;
+    header.blockRows = DATASET_BLOCK_ROWS;
+    memcpy(header.columnWidths, DATASET_COLUMN_WIDTHS, sizeof(header.columnWidths));
+    if (!write_dataset_bytes(writer, &header, sizeof(header), 0))
+    {
+        close(writer->fd);
+        writer->fd = -1;
+        return false;
+    }
+    writer->offset = sizeof(header);
+    return true;
+}
+
+/**
+ * @brief Allocates the buffers of an empty block
+ *
+ * @param block - pointer to DatasetBlock to be initialised
+ */
+void init_dataset_block(DatasetBlock *block)
+{
+    size_t blockBytes = 0;
+    block->rowCount = 0;
+    for (uint32_t column = 0; column < DATASET_COLUMN_COUNT; column++)
+    {
+        block->columns[column].resize(static_cast<size_t>(DATASET_BLOCK_ROWS) * DATASET_COLUMN_WIDTHS[column]);
+        blockBytes += align_dataset_size(block->columns[column].size() * 129 / 128 + 1);
+    }
+    block->encoded.resize(align_dataset_size(sizeof(DatasetBlockHeader)) + blockBytes);
+    block->transposed.resize(static_cast<size_t>(DATASET_BLOCK_ROWS) * DATASET_BOARD_BYTES);
+}
+
+/**
+ * @brief Adds a sample to a block, writing the block out once it is full
+ *
+ * @param writer - pointer to the writer the block belongs to
+ * @param block - pointer to the block of the calling thread
+ * @param sample - pointer to the sample
+ */
+void add_dataset_sample(DatasetWriter *writer, DatasetBlock *block, const DatasetSample *sample)
+{
+    const void *fields[DATASET_COLUMN_COUNT] = {sample->board, &sample->tetrominoIndex, &sample->rotation, &sample->column,
+                                                &sample->lineCount, &sample->scoreDelta, &sample->game, &sample->piece};
+    for (uint32_t column = 0; column < DATASET_COLUMN_COUNT; column++)
+    {
+        uint32_t width = DATASET_COLUMN_WIDTHS[column];
+        memcpy(block->columns[column].data() + static_cast<size_t>(block->rowCount) * width, fields[column], width);
+    }
+    block->rowCount++;
+    if (block->rowCount == DATASET_BLOCK_ROWS)
+    {
+        flush_dataset_block(writer, block);
+    }
+}
+
+/**
+ * @brief Reads back a row of a block, the reverse of add_dataset_sample()
+ *
+ * @param block - pointer to the block
+ * @param row - index of the row in the block
+ * @param sample - receives the row
+ */
+void get_dataset_sample(const DatasetBlock *block, uint32_t row, DatasetSample *sample)
+{
+    void *fields[DATASET_COLUMN_COUNT] = {sample->board, &sample->tetrominoIndex, &sample->rotation, &sample->column,
+                                          &sample->lineCount, &sample->scoreDelta, &sample->game, &sample->piece};
+    for (uint32_t column = 0; column < DATASET_COLUMN_COUNT; column++)
+    {
+        uint32_t width = DATASET_COLUMN_WIDTHS[column];
+        memcpy(fields[column], block->columns[column].data() + static_cast<size_t>(row) * width, width);
+    }
+}
+
+/**
+ * @brief Compresses the rows of a block and appends it to the file. The compression runs
+ * on the calling thread, only the append itself is serialized.
+ *
+ * @param writer - pointer to the writer
+ * @param block - pointer to the block, empty afterwards
+ */
+void flush_dataset_block(DatasetWriter *writer, DatasetBlock *block)
+{
+    if (block->rowCount == 0)
+    {
+        return;
+    }
+
+    DatasetBlockHeader header = {};
+    header.magic = DATASET_BLOCK_MAGIC;
+    header.rowCount = block->rowCount;
+    size_t size = align_dataset_size(sizeof(header));
+    for (uint32_t column = 0; column < DATASET_COLUMN_COUNT; column++)
+    {
+        uint32_t width = DATASET_COLUMN_WIDTHS[column];
+        size_t rawSize = static_cast<size_t>(block->rowCount) * width;
+        uint8_t *chunk = block->encoded.data() + size;
+        size_t chunkSize = encode_dataset_column(block->columns[column].data(), block->rowCount, width, block->transposed.data(), chunk);
+        header.chunks[column].codec = DATASET_CODEC_XOR_RLE;
+        if (chunkSize >= rawSize)
+        {
+            memcpy(chunk, block->columns[column].data(), rawSize);
+            chunkSize = rawSize;
+            header.chunks[column].codec = DATASET_CODEC_RAW;
+        }
+        header.chunks[column].offset = static_cast<uint32_t>(size);
+        header.chunks[column].size = static_cast<uint32_t>(chunkSize);
+        memset(chunk + chunkSize, 0, align_dataset_size(chunkSize) - chunkSize);
+        size += align_dataset_size(chunkSize);
+    }
+    header.size = static_cast<uint32_t>(size);
+    memset(block->encoded.data(), 0, align_dataset_size(sizeof(header)));
+    memcpy(block->encoded.data(), &header, sizeof(header));
+
+    append_dataset_block(writer, block->encoded.data(), size, block->rowCount);
+    block->rowCount = 0;
+}
+
+/**
+ * @brief Appends an encoded block to the file and to the block index
+ *
+ * @param writer - pointer to the writer
+ * @param data - the block, DatasetBlockHeader first
+ * @param size - size of the block in bytes
+ * @param rowCount - rows of the block
+ */
+static void append_dataset_block(DatasetWriter *writer, const void *data, size_t size, uint32_t rowCount)
+{
+    std::lock_guard<std::mutex> lock(writer->mutex);
+    DatasetIndexEntry entry = {};
+    entry.offset = writer->offset;
+    entry.firstRow = writer->rowCount;
+    entry.rowCount = rowCount;
+    if (!writer->failed && write_dataset_bytes(writer, data, size, writer->offset))
+    {
+        writer->index.push_back(entry);
+        writer->offset += size;
+        writer->rowCount += rowCount;
+    }
+    else
+    {
+        writer->failed = true;
+    }
+}
+
+/**
+ * @brief Appends a block of another dataset as it is, without decoding it
+ *
+ * @param writer - pointer to the writer
+ * @param reader - pointer to the dataset holding the block
+ * @param block - index of the block in the reader
+ * @return true - block appended
+ * @return false - the block is corrupt or a write failed
+ */
+bool copy_dataset_block(DatasetWriter *writer, const DatasetReader *reader, uint32_t block)
+{
+    const DatasetBlockHeader *header;
+    if (block >= reader->blocks.size() || !read_dataset_block_header(reader, reader->blocks[block].offset, &header))
+    {
+        return false;
+    }
+    append_dataset_block(writer, header, header->size, header->rowCount);
+    return !writer->failed;
+}
+
+/**
+ * @brief Makes the blocks appended so far durable
+ *
+ * @param writer - pointer to the writer
+ * @return true - every block appended so far is on disk
+ * @return false - a write or the sync failed
+ */
+bool sync_dataset_writer(DatasetWriter *writer)
+{
+    std::lock_guard<std::mutex> lock(writer->mutex);
+    return !writer->failed && fdatasync(writer->fd) == 0;
+}
+
+/**
+ * @brief Writes the block index and footer and closes the file. Blocks still held by threads must be flushed first.
+ *
+ * @param writer - pointer to the writer
+ * @return true - every block, the index and the footer were written
+ * @return false - a write failed
+ */
+bool close_dataset_writer(DatasetWriter *writer)
+{
+    if (writer->fd < 0)
+    {
+        return false;
+    }
+
+    DatasetFooter footer = {};
+    footer.indexOffset = writer->offset;
+    footer.blockCount = writer->index.size();
+    footer.rowCount = writer->rowCount;
+    footer.magic = DATASET_MAGIC;
+    size_t indexSize = writer->index.size() * sizeof(DatasetIndexEntry);
+    bool written = !writer->failed && write_dataset_bytes(writer, writer->index.data(), indexSize, writer->offset) &&
+                   write_dataset_bytes(writer, &footer, sizeof(footer), writer->offset + indexSize);
+    written = close(writer->fd) == 0 && written;
+    writer->fd = -1;
+    return written;
+}
+
+/**
+ * @brief Validates the header of the block at an offset of a mapped dataset
+ *
+ * @param reader - pointer to the reader
+ * @param offset - offset of the block
+ * @param header - receives the header of the block
+ * @return true - the block is complete and its chunks lie inside it
+ * @return false - there is no valid block at the offset
+ */
+static bool read_dataset_block_header(const DatasetReader *reader, uint64_t offset, const DatasetBlockHeader **header)
+{
+    if (offset % 8 != 0 || offset + sizeof(DatasetBlockHeader) > reader->size)
+    {
+        return false;
+    }
+    const DatasetBlockHeader *block = reinterpret_cast<const DatasetBlockHeader *>(reader->data + offset);
+    if (block->magic != DATASET_BLOCK_MAGIC || block->rowCount == 0 || block->rowCount > reader->header->blockRows ||
+        block->size < sizeof(DatasetBlockHeader) || offset + block->size > reader->size)
+    {
+        return false;
+    }
+    for (uint32_t column = 0; column < DATASET_COLUMN_COUNT; column++)
+    {
+        const DatasetChunk *chunk = &block->chunks[column];
+        if (static_cast<uint64_t>(chunk->offset) + chunk->size > block->size)
+        {
+            return false;
+        }
+    }
+    *header = block;
+    return true;
+}
+
+/**
+ * @brief Maps a dataset file and loads its block index, walking the blocks if the writer never wrote the footer
+ *
+ * @param reader - pointer to DatasetReader to be opened
+ * @param path - path of the dataset file
+ * @return true - dataset opened
+ * @return false - the file could not be mapped or is not a dataset of this engine
+ */
+bool open_dataset(DatasetReader *reader, const char *path)
+{
+    reader->data = NULL;
+    reader->size = 0;
+    reader->blocks.clear();
+    reader->rowCount = 0;
+
+    int32_t fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(DatasetHeader))
+    {
+        close(fd);
+        return false;
+    }
+    void *mapping = mmap(NULL, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+    reader->data = static_cast<const uint8_t *>(mapping);
+    reader->size = static_cast<size_t>(info.st_size);
+    reader->header = reinterpret_cast<const DatasetHeader *>(reader->data);
+
+    const DatasetHeader *header = reader->header;
+    if (header->magic != DATASET_MAGIC || header->version != DATASET_VERSION || header->columnCount != DATASET_COLUMN_COUNT ||
+        header->boardWidth != GameState::BOARD_WIDTH || header->boardHeight != GameState::BOARD_HEIGHT ||
+        memcmp(header->columnWidths, DATASET_COLUMN_WIDTHS, sizeof(header->columnWidths)) != 0)
+    {
+        close_dataset(reader);
+        return false;
+    }
+
+    const DatasetFooter *footer = reinterpret_cast<const DatasetFooter *>(reader->data + reader->size - sizeof(DatasetFooter));
+    if (reader->size >= sizeof(DatasetHeader) + sizeof(DatasetFooter) && footer->magic == DATASET_MAGIC &&
+        footer->indexOffset + footer->blockCount * sizeof(DatasetIndexEntry) + sizeof(DatasetFooter) == reader->size)
+    {
+        const DatasetIndexEntry *entries = reinterpret_cast<const DatasetIndexEntry *>(reader->data + footer->indexOffset);
+        reader->blocks.assign(entries, entries + footer->blockCount);
+        reader->rowCount = footer->rowCount;
+        return true;
+    }
+
+    // No footer: recover every complete block
+    uint64_t offset = sizeof(DatasetHeader);
+    const DatasetBlockHeader *block;
+    while (read_dataset_block_header(reader, offset, &block))
+    {
+        DatasetIndexEntry entry = {};
+        entry.offset = offset;
+        entry.firstRow = reader->rowCount;
+        entry.rowCount = block->rowCount;
+        reader->blocks.push_back(entry);
+        reader->rowCount += block->rowCount;
+        offset += block->size;
+    }
+    return true;
+}
+
+/**
+ * @brief Unmaps a dataset
+ *
+ * @param reader - pointer to the reader
+ */
+void close_dataset(DatasetReader *reader)
+{
+    if (reader->data)
+    {
+        munmap(const_cast<uint8_t *>(reader->data), reader->size);
+    }
+    reader->data = NULL;
+    reader->size = 0;
+    reader->blocks.clear();
+    reader->rowCount = 0;
+}
+
+/**
+ * @brief Finds the block holding a row
+ *
+ * @param reader - pointer to the reader
+ * @param row - index of the row in the dataset
+ * @return uint32_t - index of the block, or the number of blocks if the row is past the end
+ */
+uint32_t find_dataset_block(const DatasetReader *reader, uint64_t row)
+{
+    uint32_t low = 0;
+    uint32_t high = static_cast<uint32_t>(reader->blocks.size());
+    while (low < high)
+    {
+        uint32_t middle = low + (high - low) / 2;
+        const DatasetIndexEntry *entry = &reader->blocks[middle];
+        if (row < entry->firstRow)
+        {
+            high = middle;
+        }
+        else if (row >= entry->firstRow + entry->rowCount)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            return middle;
+        }
+    }
+    return static_cast<uint32_t>(reader->blocks.size());
+}
+
+/**
+ * @brief Decodes one column of a block into fixed width values
+ *
+ * @param reader - pointer to the reader
+ * @param block - index of the block
+ * @param column - column to be decoded
+ * @param values - receives rowCount * DATASET_COLUMN_WIDTHS[column] bytes
+ * @return true - column decoded
+ * @return false - the block is corrupt
+ */
+bool read_dataset_column(const DatasetReader *reader, uint32_t block, DatasetColumn column, uint8_t *values)
+{
+    const DatasetBlockHeader *header;
+    if (block >= reader->blocks.size() || !read_dataset_block_header(reader, reader->blocks[block].offset, &header))
+    {
+        return false;
+    }
+
+    const DatasetChunk *chunk = &header->chunks[column];
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(header) + chunk->offset;
+    uint32_t width = DATASET_COLUMN_WIDTHS[column];
+    if (chunk->codec == DATASET_CODEC_RAW)
+    {
+        if (chunk->size != static_cast<size_t>(header->rowCount) * width)
+        {
+            return false;
+        }
+        memcpy(values, data, chunk->size);
+        return true;
+    }
+    if (chunk->codec != DATASET_CODEC_XOR_RLE)
+    {
+        return false;
+    }
+    std::vector<uint8_t> transposed(static_cast<size_t>(header->rowCount) * width);
+    return decode_dataset_column(data, chunk->size, header->rowCount, width, transposed.data(), values);
+}
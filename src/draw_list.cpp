@@ -0,0 +1,240 @@
+#include <string>
+#include "../inc/draw_list.h"
+
+// Function Prototypes
+static void push_fill_rect(std::vector<DrawCommand> *commands, int32_t x, int32_t y, int32_t width, int32_t height, Color color);
+static void push_outline_rect(std::vector<DrawCommand> *commands, int32_t x, int32_t y, int32_t width, int32_t height, Color color);
+static void push_text(std::vector<DrawCommand> *commands, const std::string &text, int32_t x, int32_t y, TextAlign alignment, Color color);
+static void push_cell(std::vector<DrawCommand> *commands, int32_t row, int32_t col, uint8_t colorValue, int32_t xOffset, int32_t yOffset, bool outline);
+static void push_piece(std::vector<DrawCommand> *commands, const PieceState *piece, int32_t xOffset, int32_t yOffset, bool outline);
+static void push_board(std::vector<DrawCommand> *commands, const uint8_t *board, int32_t width, int32_t height, int32_t xOffset, int32_t yOffset);
+
+/**
+ * @brief Appends a filled rectangle
+ *
+ * @param commands - draw list receiving the rectangle
+ * @param x - x coordinate of the rectangle
+ * @param y - y coordinate of the rectangle
+ * @param width - width of the rectangle
+ * @param height - height of the rectangle
+ * @param color - fill color
+ */
+static void push_fill_rect(std::vector<DrawCommand> *commands, int32_t x, int32_t y, int32_t width, int32_t height, Color color)
+{
+    DrawCommand command = {};
+    command.kind = DRAW_FILL_RECT;
+    command.x = x;
+    command.y = y;
+    command.width = width;
+    command.height = height;
+    command.color = color;
+    commands->push_back(command);
+}
+
+/**
+ * @brief Appends the one pixel outline of a rectangle
+ *
+ * @param commands - draw list receiving the rectangle
+ * @param x - x coordinate of the rectangle
+ * @param y - y coordinate of the rectangle
+ * @param width - width of the rectangle
+ * @param height - height of the rectangle
+ * @param color - outline color
+ */
+static void push_outline_rect(std::vector<DrawCommand> *commands, int32_t x, int32_t y, int32_t width, int32_t height, Color color)
+{
+    DrawCommand command = {};
+    command.kind = DRAW_OUTLINE_RECT;
+    command.x = x;
+    command.y = y;
+    command.width = width;
+    command.height = height;
+    command.color = color;
+    commands->push_back(command);
+}
+
+/**
+ * @brief Appends a string, truncated to DRAW_TEXT_LENGTH - 1 characters
+ *
+ * @param commands - draw list receiving the string
+ * @param text - text to be displayed
+ * @param x - x coordinate of the anchor of the text
+ * @param y - y coordinate of the top of the text
+ * @param alignment - alignment of the text on the anchor
+ * @param color - color of the text
+ */
+static void push_text(std::vector<DrawCommand> *commands, const std::string &text, int32_t x, int32_t y, TextAlign alignment, Color color)
+{
+    DrawCommand command = {};
+    command.kind = DRAW_TEXT;
+    command.x = x;
+    command.y = y;
+    command.color = color;
+    command.alignment = alignment;
+    snprintf(command.text, sizeof(command.text), "%s", text.c_str());
+    commands->push_back(command);
+}
+
+/**
+ * @brief Appends one cell of the board or of a piece
+ *
+ * @param commands - draw list receiving the cell
+ * @param row - the row at which the cell is to be drawn
+ * @param col - the column at which the cell is to be drawn
+ * @param colorValue - index value for the various Color arrays
+ * @param xOffset - x offset of the cell
+ * @param yOffset - y offset of the cell
+ * @param outline - if true, draws a silhouette of the tetromino piece on the board
+ */
+static void push_cell(std::vector<DrawCommand> *commands, int32_t row, int32_t col, uint8_t colorValue, int32_t xOffset, int32_t yOffset, bool outline)
+{
+    Color baseColor = BASE_COLORS[colorValue];
+    Color lightColor = LIGHT_COLORS[colorValue];
+    Color darkColor = DARK_COLORS[colorValue];
+
+    int32_t edge = GRID_SIZE / 8;
+
+    int32_t x = col * GRID_SIZE + xOffset;
+    int32_t y = row * GRID_SIZE + yOffset;
+
+    // Drawing a silhoutte if outline is true
+    if (outline)
+    {
+        push_outline_rect(commands, x, y, GRID_SIZE, GRID_SIZE, baseColor);
+        return;
+    }
+
+    // Filling the dark color first followed by light color and then by base color to generate nice affects
+    push_fill_rect(commands, x, y, GRID_SIZE, GRID_SIZE, darkColor);
+    push_fill_rect(commands, x + edge, y + edge, GRID_SIZE - edge, GRID_SIZE - edge, lightColor);
+    push_fill_rect(commands, x + edge, y + edge, GRID_SIZE - edge * 2, GRID_SIZE - edge * 2, baseColor);
+}
+
+/**
+ * @brief Appends the cells of a tetromino piece
+ *
+ * @param commands - draw list receiving the piece
+ * @param piece - piece to be drawn
+ * @param xOffset - x offset of the piece
+ * @param yOffset - y offset of the piece
+ * @param outline - if true, draws a silhouette of the tetromino piece on the board
+ */
+static void push_piece(std::vector<DrawCommand> *commands, const PieceState *piece, int32_t xOffset, int32_t yOffset, bool outline)
+{
+    const Tetromino *tetromino = TETROMINOS + piece->tetrominoIndex;
+    for (int32_t row = 0; row < tetromino->side; row++)
+    {
+        for (int32_t col = 0; col < tetromino->side; col++)
+        {
+            uint8_t value = tetromino_get(tetromino, row, col, piece->rotation);
+            if (value)
+            {
+                push_cell(commands, row + piece->offsetRow, col + piece->offsetCol, value, xOffset, yOffset, outline);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Appends every cell of the board
+ *
+ * @param commands - draw list receiving the board
+ * @param board - the board to be drawn
+ * @param width - width of the board
+ * @param height - height of the board
+ * @param xOffset - x offset of the board
+ * @param yOffset - y offset of the board
+ */
+static void push_board(std::vector<DrawCommand> *commands, const uint8_t *board, int32_t width, int32_t height, int32_t xOffset, int32_t yOffset)
+{
+    for (int32_t row = 0; row < height; row++)
+    {
+        for (int32_t col = 0; col < width; col++)
+        {
+            uint8_t value = matrix_get(board, width, row, col);
+            push_cell(commands, row, col, value, xOffset, yOffset, false);
+        }
+    }
+}
+
+/**
+ * @brief Lays out the game objects of one frame. The list is cleared first, so one list
+ * can be reused for every frame.
+ *
+ * @param snapshot - pointer to RenderSnapshot of the frame
+ * @param commands - draw list receiving the frame
+ */
+template <typename Game>
+void build_draw_list(const RenderSnapshot<Game> *snapshot, std::vector<DrawCommand> *commands)
+{
+    const int32_t width = Game::BOARD_WIDTH;
+    const int32_t height = Game::BOARD_HEIGHT;
+    const int32_t visibleHeight = Game::BOARD_VISIBLE_HEIGHT;
+
+    int32_t paddingY = BOARD_PADDING_Y;
+
+    commands->clear();
+    push_board(commands, snapshot->board, width, height, 0, paddingY);
+    if (snapshot->phase == GAME_PHASE_PLAY)
+    {
+        push_piece(commands, &snapshot->piece, 0, paddingY, false);
+
+        // Draw the silhouette of the piece
+        push_piece(commands, &snapshot->silhouette, 0, paddingY, true);
+    }
+
+    // Highlights the filled lines which will be cleared from the screen
+    Color highlightColor = color(0xFF, 0xFF, 0xFF, 0xFF);
+    if (snapshot->phase == GAME_PHASE_LINE)
+    {
+        for (int32_t row = 0; row < height; row++)
+        {
+            if (snapshot->lines[row])
+            {
+                int32_t x = 0;
+                int32_t y = row * GRID_SIZE + paddingY;
+
+                push_fill_rect(commands, x, y, width * GRID_SIZE, GRID_SIZE, highlightColor);
+            }
+        }
+    }
+    else if (snapshot->phase == GAME_PHASE_GAMEOVER)
+    {
+        int32_t x = width * GRID_SIZE / 2;
+        int32_t y = height * GRID_SIZE / 2;
+        push_text(commands, "GAME OVER", x, y, TEXT_ALIGN_CENTER, highlightColor);
+
+        if (snapshot->leaderboardRank >= 0)
+        {
+            string buffer = "RANK: " + to_string(snapshot->leaderboardRank + 1) + " OF " + to_string(snapshot->leaderboardSize);
+            push_text(commands, buffer, x, y + 30, TEXT_ALIGN_CENTER, highlightColor);
+        }
+    }
+    else if (snapshot->phase == GAME_PHASE_START)
+    {
+        int32_t x = width * GRID_SIZE / 2;
+        int32_t y = height * GRID_SIZE / 2;
+        push_text(commands, "PRESS SPACE TO START", x, y, TEXT_ALIGN_CENTER, highlightColor);
+
+        string buffer = "STARTING LEVEL: " + to_string(snapshot->startLevel);
+        push_text(commands, buffer, x, y + 30, TEXT_ALIGN_CENTER, highlightColor);
+    }
+
+    push_fill_rect(commands, 0, paddingY, width * GRID_SIZE, (height - visibleHeight) * GRID_SIZE, color(0x00, 0x00, 0x00, 0x00));
+
+    // Display the level
+    string buffer = "LEVEL: " + to_string(snapshot->level);
+    push_text(commands, buffer, 5, 5, TEXT_ALIGN_LEFT, highlightColor);
+
+    // Display the score
+    buffer = "SCORE: " + to_string(snapshot->score);
+    push_text(commands, buffer, 5, 35, TEXT_ALIGN_LEFT, highlightColor);
+
+    // Display the line count
+    buffer = "LINES: " + to_string(snapshot->lineCount);
+    push_text(commands, buffer, 5, 65, TEXT_ALIGN_LEFT, highlightColor);
+}
+
+template void build_draw_list<GameState>(const RenderSnapshot<GameState> *snapshot, std::vector<DrawCommand> *commands);
+template void build_draw_list<GameState10>(const RenderSnapshot<GameState10> *snapshot, std::vector<DrawCommand> *commands);
+template void build_draw_list<GameState40>(const RenderSnapshot<GameState40> *snapshot, std::vector<DrawCommand> *commands);
@@ -0,0 +1,265 @@
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../inc/eval_cache.h"
+#include "../inc/bot.h"
+
+static_assert(sizeof(EvalCacheHeader) <= sizeof(EvalCacheEntry), "the header is padded to one entry");
+
+// Function Prototypes
+static uint64_t hash_eval_key(const GameState *game);
+inline bool match_eval_key(const EvalCacheEntry *entry, const GameState *game);
+inline uint32_t get_eval_slot(const EvalCache *cache, uint64_t hash, uint32_t probe);
+
+/**
+ * @brief Hashes the board occupancy and the current piece of a game
+ *
+ * @param game - pointer to the game
+ * @return uint64_t - hash with the two state bits of a tag cleared, never 0. The slots are
+ * indexed by the bits above them (get_eval_slot()), so every slot can be a home slot.
+ */
+static uint64_t hash_eval_key(const GameState *game)
+{
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(game->rows);
+    uint64_t hash = static_cast<uint64_t>(game->piece.tetrominoIndex) | static_cast<uint64_t>(game->piece.rotation & 3) << 8 |
+                    static_cast<uint64_t>(static_cast<uint8_t>(game->piece.offsetRow)) << 16 |
+                    static_cast<uint64_t>(static_cast<uint8_t>(game->piece.offsetCol)) << 24;
+    hash = (hash ^ 0x9E3779B97F4A7C15ull) * 0xFF51AFD7ED558CCDull;
+    for (size_t offset = 0; offset < sizeof(game->rows); offset += 8)
+    {
+        uint64_t word = 0;
+        memcpy(&word, bytes + offset, sizeof(game->rows) - offset < 8 ? sizeof(game->rows) - offset : 8);
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 32;
+    }
+    hash &= ~(EVAL_CACHE_WRITING | EVAL_CACHE_READY);
+    return hash ? hash : 4;
+}
+
+/**
+ * @brief Gets the slot of a probe. The low bits of the hash are the same for every key, so
+ * the slot is taken from the bits above them.
+ *
+ * @param cache - pointer to the open cache
+ * @param hash - hash of the key, from hash_eval_key()
+ * @param probe - number of slots after the home slot
+ * @return uint32_t - index of the slot
+ */
+inline uint32_t get_eval_slot(const EvalCache *cache, uint64_t hash, uint32_t probe)
+{
+    return static_cast<uint32_t>(((hash >> 2) + probe) & cache->mask);
+}
+
+/**
+ * @brief Compares the key of a published entry with a game
+ *
+ * @param entry - pointer to the entry
+ * @param game - pointer to the game
+ * @return true - the entry holds the decision for the board and piece of the game
+ * @return false - the entry is for another board or piece
+ */
+inline bool match_eval_key(const EvalCacheEntry *entry, const GameState *game)
+{
+    return entry->tetrominoIndex == game->piece.tetrominoIndex && entry->rotation == (game->piece.rotation & 3) &&
+           entry->offsetRow == game->piece.offsetRow && entry->offsetCol == game->piece.offsetCol &&
+           memcmp(entry->rows, game->rows, sizeof(entry->rows)) == 0;
+}
+
+/**
+ * @brief Opens (or creates) a cache file and maps it
+ *
+ * @param cache - pointer to EvalCache to be opened
+ * @param path - path of the cache file
+ * @param readOnly - map the file read only, inserts are then refused
+ * @param capacity - entries of the file if it is created, rounded up to a power of two
+ * @return true - cache opened
+ * @return false - the file could not be opened or was created for another engine or bot
+ */
+bool open_eval_cache(EvalCache *cache, const char *path, bool readOnly, uint32_t capacity)
+{
+    *cache = {};
+    cache->fd = -1;
+    cache->readOnly = readOnly;
+    cache->fd = open(path, readOnly ? O_RDONLY | O_CLOEXEC : O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (cache->fd < 0)
+    {
+        return false;
+    }
+
+    // Whoever finds the file empty initializes it while the others wait on the lock
+    flock(cache->fd, LOCK_EX);
+    struct stat info;
+    bool valid = fstat(cache->fd, &info) == 0;
+    if (valid && info.st_size == 0 && !readOnly)
+    {
+        uint32_t rounded = 1;
+        while (rounded < capacity)
+        {
+            rounded <<= 1;
+        }
+        EvalCacheHeader header = {};
+        header.magic = EVAL_CACHE_MAGIC;
+        header.version = EVAL_CACHE_VERSION;
+        header.boardWidth = GameState::BOARD_WIDTH;
+        header.boardHeight = GameState::BOARD_HEIGHT;
+        header.entrySize = sizeof(EvalCacheEntry);
+        header.capacity = rounded;
+        header.botFingerprint = get_bot_fingerprint();
+        info.st_size = static_cast<off_t>(sizeof(EvalCacheEntry)) * (static_cast<off_t>(rounded) + 1);
+        valid = ftruncate(cache->fd, info.st_size) == 0 && pwrite(cache->fd, &header, sizeof(header), 0) == sizeof(header);
+    }
+    flock(cache->fd, LOCK_UN);
+
+    size_t size = static_cast<size_t>(info.st_size);
+    void *mapping = MAP_FAILED;
+    if (valid && size >= sizeof(EvalCacheEntry))
+    {
+        mapping = mmap(NULL, size, readOnly ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, cache->fd, 0);
+    }
+    if (mapping == MAP_FAILED)
+    {
+        close(cache->fd);
+        cache->fd = -1;
+        return false;
+    }
+
+    cache->header = static_cast<EvalCacheHeader *>(mapping);
+    const EvalCacheHeader *header = cache->header;
+    if (header->magic != EVAL_CACHE_MAGIC || header->version != EVAL_CACHE_VERSION ||
+        header->boardWidth != GameState::BOARD_WIDTH || header->boardHeight != GameState::BOARD_HEIGHT ||
+        header->entrySize != sizeof(EvalCacheEntry) || header->botFingerprint != get_bot_fingerprint() || header->capacity == 0 || (header->capacity & (header->capacity - 1)) != 0 ||
+        size != sizeof(EvalCacheEntry) * (static_cast<size_t>(header->capacity) + 1))
+    {
+        munmap(mapping, size);
+        close(cache->fd);
+        *cache = {};
+        cache->fd = -1;
+        return false;
+    }
+    cache->entries = reinterpret_cast<EvalCacheEntry *>(static_cast<uint8_t *>(mapping) + sizeof(EvalCacheEntry));
+    cache->mask = header->capacity - 1;
+    return true;
+}
+
+/**
+ * @brief Unmaps and closes a cache, a cache that was never opened is left as is
+ *
+ * @param cache - pointer to EvalCache to be closed
+ */
+void close_eval_cache(EvalCache *cache)
+{
+    if (cache->header)
+    {
+        munmap(cache->header, sizeof(EvalCacheEntry) * (static_cast<size_t>(cache->mask) + 2));
+    }
+    if (cache->fd >= 0)
+    {
+        close(cache->fd);
+    }
+    cache->header = NULL;
+    cache->entries = NULL;
+    cache->fd = -1;
+}
+
+/**
+ * @brief Looks up the decision of the bot for the board and current piece of a game
+ *
+ * @param cache - pointer to the open cache
+ * @param game - pointer to the game
+ * @param best - receives the cached placement, when found is set
+ * @param score - receives the score of the placement
+ * @param found - receives whether the piece had a placement at all
+ * @return true - the decision was cached
+ * @return false - the board and piece are not in the cache
+ */
+bool find_eval_cache(const EvalCache *cache, const GameState *game, PieceState *best, int32_t *score, bool *found)
+{
+    uint64_t hash = hash_eval_key(game);
+    for (uint32_t probe = 0; probe < EVAL_CACHE_PROBES; probe++)
+    {
+        const EvalCacheEntry *entry = &cache->entries[get_eval_slot(cache, hash, probe)];
+        uint64_t tag = entry->tag.load(std::memory_order_acquire);
+        if (tag == 0)
+        {
+            break;
+        }
+        if (tag == (hash | EVAL_CACHE_READY) && match_eval_key(entry, game))
+        {
+            *best = game->piece;
+            best->rotation = entry->bestRotation;
+            best->offsetRow = entry->bestOffsetRow;
+            best->offsetCol = entry->bestOffsetCol;
+            *score = entry->score;
+            *found = entry->found != 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Publishes the decision of the bot for the board and current piece of a game
+ *
+ * @param cache - pointer to the open cache
+ * @param game - pointer to the game
+ * @param best - pointer to the chosen placement, ignored unless found
+ * @param score - score of the placement
+ * @param found - whether the piece had a placement at all
+ * @return true - the decision is in the cache, inserted by this call or another writer
+ * @return false - the cache is read only or the probed slots are full
+ */
+bool insert_eval_cache(EvalCache *cache, const GameState *game, const PieceState *best, int32_t score, bool found)
+{
+    if (cache->readOnly)
+    {
+        return false;
+    }
+
+    uint64_t hash = hash_eval_key(game);
+    for (uint32_t probe = 0; probe < EVAL_CACHE_PROBES; probe++)
+    {
+        EvalCacheEntry *entry = &cache->entries[get_eval_slot(cache, hash, probe)];
+        uint64_t tag = entry->tag.load(std::memory_order_acquire);
+        if (tag == 0 && entry->tag.compare_exchange_strong(tag, hash | EVAL_CACHE_WRITING, std::memory_order_acquire))
+        {
+            memcpy(entry->rows, game->rows, sizeof(entry->rows));
+            entry->tetrominoIndex = game->piece.tetrominoIndex;
+            entry->rotation = static_cast<uint8_t>(game->piece.rotation & 3);
+            entry->offsetRow = static_cast<int8_t>(game->piece.offsetRow);
+            entry->offsetCol = static_cast<int8_t>(game->piece.offsetCol);
+            entry->bestRotation = static_cast<uint8_t>(found ? best->rotation : 0);
+            entry->bestOffsetRow = static_cast<int8_t>(found ? best->offsetRow : 0);
+            entry->bestOffsetCol = static_cast<int8_t>(found ? best->offsetCol : 0);
+            entry->found = found;
+            entry->score = score;
+            entry->tag.store(hash | EVAL_CACHE_READY, std::memory_order_release);
+            return true;
+        }
+
+        // The compare-and-swap reloads the tag when another writer claimed the slot first
+        if ((tag & ~(EVAL_CACHE_WRITING | EVAL_CACHE_READY)) == hash &&
+            ((tag & EVAL_CACHE_WRITING) || match_eval_key(entry, game)))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Counts the published entries of a cache by scanning it
+ *
+ * @param cache - pointer to the open cache
+ * @return uint32_t - number of entries
+ */
+uint32_t count_eval_cache(const EvalCache *cache)
+{
+    uint32_t count = 0;
+    for (uint32_t i = 0; i <= cache->mask; i++)
+    {
+        count += (cache->entries[i].tag.load(std::memory_order_relaxed) & EVAL_CACHE_READY) != 0;
+    }
+    return count;
+}
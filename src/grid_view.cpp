@@ -0,0 +1,361 @@
+#include "../inc/grid_view.h"
+
+const int32_t GLYPH_CELL_WIDTH = FONT_GLYPH_WIDTH + 2; // A transparent texel around every glyph
+const int32_t GLYPH_CELL_HEIGHT = FONT_GLYPH_HEIGHT + 2;
+const int32_t GRID_TEXT_LINE_HEIGHT = FONT_GLYPH_HEIGHT + 2;
+const int32_t GRID_TEXT_ADVANCE = FONT_GLYPH_WIDTH + 1;
+
+// Function Prototypes
+static void push_quad(GridGeometry *geometry, float x, float y, float width, float height, Color color, float u0, float v0, float u1, float v1);
+static void push_grid_rect(GridGeometry *geometry, const GlyphAtlas *atlas, int32_t x, int32_t y, int32_t width, int32_t height, Color color);
+static void push_grid_outline(GridGeometry *geometry, const GlyphAtlas *atlas, int32_t x, int32_t y, int32_t size, Color color);
+static void push_grid_text(GridGeometry *geometry, const GlyphAtlas *atlas, const char *text, int32_t x, int32_t y, int32_t scale, TextAlign alignment, Color color);
+static void push_grid_cell(GridGeometry *geometry, const GlyphAtlas *atlas, int32_t x, int32_t y, int32_t size, uint8_t colorValue);
+template <typename Game> static void push_grid_piece(GridGeometry *geometry, const GlyphAtlas *atlas, const PieceState *piece, int32_t x, int32_t y, int32_t size, bool outline);
+
+/**
+ * @brief Renders the built-in font into an atlas, one cell per glyph plus a white cell for rectangles
+ *
+ * @param atlas - pointer to GlyphAtlas to be filled
+ */
+void init_glyph_atlas(GlyphAtlas *atlas)
+{
+    int32_t cellCount = static_cast<int32_t>(FONT_GLYPH_COUNT) + 1;
+    atlas->width = GLYPH_ATLAS_COLUMNS * GLYPH_CELL_WIDTH;
+    atlas->height = (cellCount + GLYPH_ATLAS_COLUMNS - 1) / GLYPH_ATLAS_COLUMNS * GLYPH_CELL_HEIGHT;
+    atlas->pixels.assign(static_cast<size_t>(atlas->width) * atlas->height * 4, 0);
+    for (int32_t i = 0; i < 128; i++)
+    {
+        atlas->cells[i] = -1;
+    }
+
+    for (int32_t cell = 0; cell < cellCount; cell++)
+    {
+        const Glyph *glyph = cell < static_cast<int32_t>(FONT_GLYPH_COUNT) ? &FONT_GLYPHS[cell] : NULL;
+        int32_t left = cell % GLYPH_ATLAS_COLUMNS * GLYPH_CELL_WIDTH;
+        int32_t top = cell / GLYPH_ATLAS_COLUMNS * GLYPH_CELL_HEIGHT;
+        for (int32_t row = 0; row < GLYPH_CELL_HEIGHT; row++)
+        {
+            for (int32_t col = 0; col < GLYPH_CELL_WIDTH; col++)
+            {
+                bool set = glyph == NULL;
+                if (glyph && row >= 1 && row <= FONT_GLYPH_HEIGHT && col >= 1 && col <= FONT_GLYPH_WIDTH)
+                {
+                    set = (glyph->rows[row - 1] & (0x10 >> (col - 1))) != 0;
+                }
+                if (set)
+                {
+                    memset(&atlas->pixels[(static_cast<size_t>(top + row) * atlas->width + left + col) * 4], 0xFF, 4);
+                }
+            }
+        }
+
+        if (glyph)
+        {
+            atlas->cells[static_cast<uint8_t>(glyph->character) & 0x7F] = static_cast<int16_t>(cell);
+            if (glyph->character >= 'A' && glyph->character <= 'Z')
+            {
+                atlas->cells[glyph->character - 'A' + 'a'] = static_cast<int16_t>(cell);
+            }
+        }
+        else
+        {
+            atlas->solidCell = static_cast<int16_t>(cell);
+        }
+    }
+}
+
+/**
+ * @brief Picks the number of columns giving the largest boards that fit the window
+ *
+ * @param boardCount - number of boards, at most GRID_VIEW_MAX_BOARDS
+ * @param width - width of the window
+ * @param height - height of the window
+ * @param layout - receives the layout
+ */
+template <typename Game>
+void layout_grid(int32_t boardCount, int32_t width, int32_t height, GridLayout *layout)
+{
+    *layout = {};
+    layout->boardCount = boardCount;
+    layout->columns = 1;
+    layout->rows = 1;
+    layout->cellSize = 1;
+    layout->textScale = 1;
+    for (int32_t columns = 1; columns <= boardCount; columns++)
+    {
+        int32_t rows = (boardCount + columns - 1) / columns;
+        for (int32_t textScale = 2; textScale >= 1; textScale--)
+        {
+            int32_t hudHeight = GRID_VIEW_TEXT_LINES * GRID_TEXT_LINE_HEIGHT * textScale;
+            int32_t cellWidth = (width / columns - GRID_VIEW_GAP * 2) / Game::BOARD_WIDTH;
+            int32_t cellHeight = (height / rows - GRID_VIEW_GAP * 2 - hudHeight) / Game::BOARD_VISIBLE_HEIGHT;
+            int32_t cellSize = cellWidth < cellHeight ? cellWidth : cellHeight;
+
+            // Large text only once cells are as large as the text is tall
+            if ((textScale == 1 || cellSize >= GRID_TEXT_LINE_HEIGHT * textScale) && cellSize > layout->cellSize)
+            {
+                layout->columns = columns;
+                layout->rows = rows;
+                layout->cellSize = cellSize;
+                layout->textScale = textScale;
+            }
+        }
+    }
+
+    layout->tileWidth = Game::BOARD_WIDTH * layout->cellSize + GRID_VIEW_GAP * 2;
+    layout->tileHeight = GRID_VIEW_TEXT_LINES * GRID_TEXT_LINE_HEIGHT * layout->textScale +
+                         Game::BOARD_VISIBLE_HEIGHT * layout->cellSize + GRID_VIEW_GAP * 2;
+    layout->originX = (width - layout->columns * layout->tileWidth) / 2;
+    layout->originY = (height - layout->rows * layout->tileHeight) / 2;
+    layout->originX = layout->originX > 0 ? layout->originX : 0;
+    layout->originY = layout->originY > 0 ? layout->originY : 0;
+}
+
+/**
+ * @brief Appends a textured rectangle as two triangles
+ *
+ * @param geometry - geometry receiving the rectangle
+ * @param x - x coordinate of the rectangle
+ * @param y - y coordinate of the rectangle
+ * @param width - width of the rectangle
+ * @param height - height of the rectangle
+ * @param color - color modulating the texture
+ * @param u0 - left texture coordinate
+ * @param v0 - top texture coordinate
+ * @param u1 - right texture coordinate
+ * @param v1 - bottom texture coordinate
+ */
+static void push_quad(GridGeometry *geometry, float x, float y, float width, float height, Color color, float u0, float v0, float u1, float v1)
+{
+    int32_t first = static_cast<int32_t>(geometry->vertices.size());
+    geometry->vertices.push_back(GridVertex{x, y, color, u0, v0});
+    geometry->vertices.push_back(GridVertex{x + width, y, color, u1, v0});
+    geometry->vertices.push_back(GridVertex{x + width, y + height, color, u1, v1});
+    geometry->vertices.push_back(GridVertex{x, y + height, color, u0, v1});
+
+    const int32_t corners[6] = {0, 1, 2, 0, 2, 3};
+    for (int32_t i = 0; i < 6; i++)
+    {
+        geometry->indices.push_back(first + corners[i]);
+    }
+}
+
+/**
+ * @brief Appends a filled rectangle, sampling the white cell of the atlas
+ *
+ * @param geometry - geometry receiving the rectangle
+ * @param atlas - pointer to the glyph atlas
+ * @param x - x coordinate of the rectangle
+ * @param y - y coordinate of the rectangle
+ * @param width - width of the rectangle
+ * @param height - height of the rectangle
+ * @param color - fill color
+ */
+static void push_grid_rect(GridGeometry *geometry, const GlyphAtlas *atlas, int32_t x, int32_t y, int32_t width, int32_t height, Color color)
+{
+    float u = (atlas->solidCell % GLYPH_ATLAS_COLUMNS * GLYPH_CELL_WIDTH + GLYPH_CELL_WIDTH * 0.5f) / atlas->width;
+    float v = (atlas->solidCell / GLYPH_ATLAS_COLUMNS * GLYPH_CELL_HEIGHT + GLYPH_CELL_HEIGHT * 0.5f) / atlas->height;
+    push_quad(geometry, static_cast<float>(x), static_cast<float>(y), static_cast<float>(width), static_cast<float>(height), color, u, v, u, v);
+}
+
+/**
+ * @brief Appends the one pixel outline of a square
+ *
+ * @param geometry - geometry receiving the outline
+ * @param atlas - pointer to the glyph atlas
+ * @param x - x coordinate of the square
+ * @param y - y coordinate of the square
+ * @param size - side of the square
+ * @param color - outline color
+ */
+static void push_grid_outline(GridGeometry *geometry, const GlyphAtlas *atlas, int32_t x, int32_t y, int32_t size, Color color)
+{
+    push_grid_rect(geometry, atlas, x, y, size, 1, color);
+    push_grid_rect(geometry, atlas, x, y + size - 1, size, 1, color);
+    push_grid_rect(geometry, atlas, x, y + 1, 1, size - 2, color);
+    push_grid_rect(geometry, atlas, x + size - 1, y + 1, 1, size - 2, color);
+}
+
+/**
+ * @brief Appends one rectangle per character of a string, blanks are skipped
+ *
+ * @param geometry - geometry receiving the text
+ * @param atlas - pointer to the glyph atlas
+ * @param text - text to be displayed
+ * @param x - x coordinate of the anchor of the text
+ * @param y - y coordinate of the top of the text
+ * @param scale - pixels per font pixel
+ * @param alignment - alignment of the text on the anchor
+ * @param color - color of the text
+ */
+static void push_grid_text(GridGeometry *geometry, const GlyphAtlas *atlas, const char *text, int32_t x, int32_t y, int32_t scale, TextAlign alignment, Color color)
+{
+    int32_t length = static_cast<int32_t>(strlen(text));
+    int32_t width = (length * GRID_TEXT_ADVANCE - 1) * scale;
+    if (alignment == TEXT_ALIGN_CENTER)
+    {
+        x -= width / 2;
+    }
+    else if (alignment == TEXT_ALIGN_RIGHT)
+    {
+        x -= width;
+    }
+
+    for (int32_t i = 0; i < length; i++, x += GRID_TEXT_ADVANCE * scale)
+    {
+        int32_t cell = atlas->cells[static_cast<uint8_t>(text[i]) & 0x7F];
+        if (cell < 0)
+        {
+            continue;
+        }
+        float u0 = static_cast<float>(cell % GLYPH_ATLAS_COLUMNS * GLYPH_CELL_WIDTH + 1) / atlas->width;
+        float v0 = static_cast<float>(cell / GLYPH_ATLAS_COLUMNS * GLYPH_CELL_HEIGHT + 1) / atlas->height;
+        float u1 = u0 + static_cast<float>(FONT_GLYPH_WIDTH) / atlas->width;
+        float v1 = v0 + static_cast<float>(FONT_GLYPH_HEIGHT) / atlas->height;
+        push_quad(geometry, static_cast<float>(x), static_cast<float>(y), static_cast<float>(FONT_GLYPH_WIDTH * scale),
+                  static_cast<float>(FONT_GLYPH_HEIGHT * scale), color, u0, v0, u1, v1);
+    }
+}
+
+/**
+ * @brief Appends one filled cell, bevelled like push_cell() once cells are large enough to show it
+ *
+ * @param geometry - geometry receiving the cell
+ * @param atlas - pointer to the glyph atlas
+ * @param x - x coordinate of the cell
+ * @param y - y coordinate of the cell
+ * @param size - side of the cell
+ * @param colorValue - index value for the various Color arrays
+ */
+static void push_grid_cell(GridGeometry *geometry, const GlyphAtlas *atlas, int32_t x, int32_t y, int32_t size, uint8_t colorValue)
+{
+    int32_t edge = size / 8;
+    if (edge == 0)
+    {
+        push_grid_rect(geometry, atlas, x, y, size, size, BASE_COLORS[colorValue]);
+        return;
+    }
+    push_grid_rect(geometry, atlas, x, y, size, size, DARK_COLORS[colorValue]);
+    push_grid_rect(geometry, atlas, x + edge, y + edge, size - edge, size - edge, LIGHT_COLORS[colorValue]);
+    push_grid_rect(geometry, atlas, x + edge, y + edge, size - edge * 2, size - edge * 2, BASE_COLORS[colorValue]);
+}
+
+/**
+ * @brief Appends the visible cells of a tetromino piece
+ *
+ * @param geometry - geometry receiving the piece
+ * @param atlas - pointer to the glyph atlas
+ * @param piece - piece to be drawn
+ * @param x - x coordinate of the first visible row of the board
+ * @param y - y coordinate of the first visible row of the board
+ * @param size - side of a cell
+ * @param outline - if true, draws a silhouette of the tetromino piece on the board
+ */
+template <typename Game>
+static void push_grid_piece(GridGeometry *geometry, const GlyphAtlas *atlas, const PieceState *piece, int32_t x, int32_t y, int32_t size, bool outline)
+{
+    const int32_t hiddenRows = Game::BOARD_HEIGHT - Game::BOARD_VISIBLE_HEIGHT;
+    const Tetromino *tetromino = TETROMINOS + piece->tetrominoIndex;
+    for (int32_t row = 0; row < tetromino->side; row++)
+    {
+        for (int32_t col = 0; col < tetromino->side; col++)
+        {
+            uint8_t value = tetromino_get(tetromino, row, col, piece->rotation);
+            int32_t boardRow = row + piece->offsetRow - hiddenRows;
+            if (value == 0 || boardRow < 0)
+            {
+                continue;
+            }
+            int32_t cellX = x + (col + piece->offsetCol) * size;
+            int32_t cellY = y + boardRow * size;
+            if (outline)
+            {
+                push_grid_outline(geometry, atlas, cellX, cellY, size, BASE_COLORS[value]);
+            }
+            else
+            {
+                push_grid_cell(geometry, atlas, cellX, cellY, size, value);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Lays out every board of the wall for one frame. The geometry is cleared first, so
+ * one geometry can be reused for every frame.
+ *
+ * @param snapshots - layout->boardCount snapshots, one per board
+ * @param layout - pointer to the layout from layout_grid()
+ * @param atlas - pointer to the glyph atlas the geometry is drawn with
+ * @param geometry - geometry receiving the frame
+ */
+template <typename Game>
+void build_grid_geometry(const RenderSnapshot<Game> *const *snapshots, const GridLayout *layout, const GlyphAtlas *atlas, GridGeometry *geometry)
+{
+    const int32_t width = Game::BOARD_WIDTH;
+    const int32_t height = Game::BOARD_HEIGHT;
+    const int32_t hiddenRows = Game::BOARD_HEIGHT - Game::BOARD_VISIBLE_HEIGHT;
+    const int32_t size = layout->cellSize;
+    const int32_t scale = layout->textScale;
+    const Color highlightColor = color(0xFF, 0xFF, 0xFF, 0xFF);
+
+    geometry->vertices.clear();
+    geometry->indices.clear();
+    for (int32_t i = 0; i < layout->boardCount; i++)
+    {
+        const RenderSnapshot<Game> *snapshot = snapshots[i];
+        int32_t tileX = layout->originX + i % layout->columns * layout->tileWidth + GRID_VIEW_GAP;
+        int32_t tileY = layout->originY + i / layout->columns * layout->tileHeight + GRID_VIEW_GAP;
+        int32_t boardX = tileX;
+        int32_t boardY = tileY + GRID_VIEW_TEXT_LINES * GRID_TEXT_LINE_HEIGHT * scale;
+
+        // Display the score, level and line count
+        char buffer[GRID_VIEW_TEXT_LENGTH];
+        snprintf(buffer, sizeof(buffer), "SCORE %d", snapshot->score);
+        push_grid_text(geometry, atlas, buffer, tileX, tileY, scale, TEXT_ALIGN_LEFT, highlightColor);
+        snprintf(buffer, sizeof(buffer), "LEVEL %d LINES %d", snapshot->level, snapshot->lineCount);
+        push_grid_text(geometry, atlas, buffer, tileX, tileY + GRID_TEXT_LINE_HEIGHT * scale, scale, TEXT_ALIGN_LEFT, highlightColor);
+
+        // Empty cells all share the background, only filled cells are drawn
+        push_grid_rect(geometry, atlas, boardX, boardY, width * size, Game::BOARD_VISIBLE_HEIGHT * size, BASE_COLORS[0]);
+        for (int32_t row = hiddenRows; row < height; row++)
+        {
+            const uint8_t *cells = snapshot->board + row * width;
+            for (int32_t col = 0; col < width; col++)
+            {
+                if (cells[col])
+                {
+                    push_grid_cell(geometry, atlas, boardX + col * size, boardY + (row - hiddenRows) * size, size, cells[col]);
+                }
+            }
+        }
+
+        if (snapshot->phase == GAME_PHASE_PLAY)
+        {
+            push_grid_piece<Game>(geometry, atlas, &snapshot->piece, boardX, boardY, size, false);
+            push_grid_piece<Game>(geometry, atlas, &snapshot->silhouette, boardX, boardY, size, true);
+        }
+        else if (snapshot->phase == GAME_PHASE_LINE)
+        {
+            // Highlights the filled lines which will be cleared from the screen
+            for (int32_t row = hiddenRows; row < height; row++)
+            {
+                if (snapshot->lines[row])
+                {
+                    push_grid_rect(geometry, atlas, boardX, boardY + (row - hiddenRows) * size, width * size, size, highlightColor);
+                }
+            }
+        }
+        else if (snapshot->phase == GAME_PHASE_GAMEOVER)
+        {
+            push_grid_text(geometry, atlas, "GAME OVER", boardX + width * size / 2, boardY + Game::BOARD_VISIBLE_HEIGHT * size / 2,
+                           scale, TEXT_ALIGN_CENTER, highlightColor);
+        }
+    }
+}
+
+template void layout_grid<GameState>(int32_t boardCount, int32_t width, int32_t height, GridLayout *layout);
+template void layout_grid<GameState10>(int32_t boardCount, int32_t width, int32_t height, GridLayout *layout);
+template void build_grid_geometry<GameState>(const RenderSnapshot<GameState> *const *snapshots, const GridLayout *layout, const GlyphAtlas *atlas, GridGeometry *geometry);
+template void build_grid_geometry<GameState10>(const RenderSnapshot<GameState10> *const *snapshots, const GridLayout *layout, const GlyphAtlas *atlas, GridGeometry *geometry);
@@ -0,0 +1,564 @@
+#include <algorithm>
+#include <string>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../inc/leaderboard.h"
+
+#define LEADERBOARD_REBUILD_CHUNK 4096 // Log entries read at once while rebuilding the index
+
+// Function Prototypes
+inline LeaderboardHeader *get_header(Leaderboard *board);
+inline uint64_t make_key(int32_t score, uint64_t position);
+static bool map_index(Leaderboard *board, uint32_t capacity);
+static bool reserve_nodes(Leaderboard *board, uint32_t count);
+static bool reset_index(Leaderboard *board);
+static bool refresh_mapping(Leaderboard *board);
+static uint64_t get_log_size(Leaderboard *board);
+static void split_child(Leaderboard *board, uint32_t parentIndex, uint32_t slot);
+static int64_t insert_key(Leaderboard *board, uint64_t key);
+static bool index_log(Leaderboard *board, uint64_t logSize);
+
+/**
+ * @brief Returns the header stored in node 0 of the index
+ *
+ * @param board - pointer to Leaderboard holding the mapping
+ * @return LeaderboardHeader* - header of the index
+ */
+inline LeaderboardHeader *get_header(Leaderboard *board)
+{
+    return reinterpret_cast<LeaderboardHeader *>(&board->nodes[0]);
+}
+
+/**
+ * @brief Builds the index key of an entry. The score is inverted so that higher scores
+ * sort first, and the log position breaks ties in favour of the earlier game.
+ *
+ * @param score - score of the entry
+ * @param position - position of the entry in the log
+ * @return uint64_t - index key
+ */
+inline uint64_t make_key(int32_t score, uint64_t position)
+{
+    uint32_t inverted = ~(static_cast<uint32_t>(score) ^ 0x80000000u);
+    return (static_cast<uint64_t>(inverted) << 32) | (position & 0xFFFFFFFFull);
+}
+
+/**
+ * @brief Maps (or remaps) the first capacity nodes of the index file
+ *
+ * @param board - pointer to Leaderboard whose index is mapped
+ * @param capacity - number of nodes to map
+ * @return true - index mapped
+ * @return false - the index could not be mapped
+ */
+static bool map_index(Leaderboard *board, uint32_t capacity)
+{
+    size_t oldSize = static_cast<size_t>(board->capacity) * LEADERBOARD_NODE_SIZE;
+    size_t newSize = static_cast<size_t>(capacity) * LEADERBOARD_NODE_SIZE;
+    int32_t protection = board->readOnly ? PROT_READ : PROT_READ | PROT_WRITE;
+
+    void *mapping = board->nodes ? mremap(board->nodes, oldSize, newSize, MREMAP_MAYMOVE)
+                                 : mmap(NULL, newSize, protection, MAP_SHARED, board->indexFd, 0);
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+
+    board->nodes = static_cast<LeaderboardNode *>(mapping);
+    board->capacity = capacity;
+    return true;
+}
+
+/**
+ * @brief Makes sure count more nodes can be allocated without remapping, so node
+ * pointers stay valid for the whole of an insert
+ *
+ * @param board - pointer to Leaderboard being written
+ * @param count - number of nodes the caller may allocate
+ * @return true - nodes available
+ * @return false - the index file could not be extended or remapped
+ */
+static bool reserve_nodes(Leaderboard *board, uint32_t count)
+{
+    uint32_t needed = get_header(board)->nodeCount + count;
+    if (needed <= board->capacity)
+    {
+        return true;
+    }
+
+    // Another writer of the same files may have grown the index already
+    struct stat status;
+    if (fstat(board->indexFd, &status) < 0)
+    {
+        return false;
+    }
+    uint32_t capacity = static_cast<uint32_t>(status.st_size / LEADERBOARD_NODE_SIZE);
+    if (capacity < needed)
+    {
+        capacity += LEADERBOARD_GROWTH_NODES;
+        if (ftruncate(board->indexFd, static_cast<off_t>(capacity) * LEADERBOARD_NODE_SIZE) < 0)
+        {
+            return false;
+        }
+    }
+    return map_index(board, capacity);
+}
+
+/**
+ * @brief Truncates the index to an empty tree: the header and one empty leaf as the root
+ *
+ * @param board - pointer to Leaderboard opened for writing
+ * @return true - index reset
+ * @return false - the index file could not be resized or mapped
+ */
+static bool reset_index(Leaderboard *board)
+{
+    if (board->nodes)
+    {
+        munmap(board->nodes, static_cast<size_t>(board->capacity) * LEADERBOARD_NODE_SIZE);
+        board->nodes = NULL;
+        board->capacity = 0;
+    }
+    if (ftruncate(board->indexFd, 0) < 0 ||
+        ftruncate(board->indexFd, static_cast<off_t>(LEADERBOARD_GROWTH_NODES) * LEADERBOARD_NODE_SIZE) < 0 ||
+        !map_index(board, LEADERBOARD_GROWTH_NODES))
+    {
+        return false;
+    }
+
+    LeaderboardHeader *header = get_header(board);
+    header->root = 1;
+    header->height = 1;
+    header->nodeCount = 2;
+    header->dirty = 0;
+    header->entryCount = 0;
+    board->nodes[1].isLeaf = 1;
+    board->nodes[1].count = 0;
+    board->nodes[1].next = 0;
+    header->magic = LEADERBOARD_MAGIC;
+    return true;
+}
+
+/**
+ * @brief Extends the mapping of a reader once the writer grew the index past it
+ *
+ * @param board - pointer to Leaderboard being queried
+ * @return true - every node in use is mapped
+ * @return false - the index could not be remapped
+ */
+static bool refresh_mapping(Leaderboard *board)
+{
+    if (get_header(board)->nodeCount <= board->capacity)
+    {
+        return true;
+    }
+
+    struct stat status;
+    if (fstat(board->indexFd, &status) < 0)
+    {
+        return false;
+    }
+    return map_index(board, static_cast<uint32_t>(status.st_size / LEADERBOARD_NODE_SIZE));
+}
+
+/**
+ * @brief Counts the complete entries of the log. A partial entry left by a crash is
+ * ignored and overwritten by the next record_score().
+ *
+ * @param board - pointer to Leaderboard holding the log
+ * @return uint64_t - number of entries in the log
+ */
+static uint64_t get_log_size(Leaderboard *board)
+{
+    struct stat status;
+    if (fstat(board->logFd, &status) < 0)
+    {
+        return 0;
+    }
+    return static_cast<uint64_t>(status.st_size) / sizeof(LeaderboardEntry);
+}
+
+/**
+ * @brief Splits the full child at slot of a branch in two halves and links the right
+ * half into the branch, which must not be full itself
+ *
+ * @param board - pointer to Leaderboard being written
+ * @param parentIndex - branch holding the child
+ * @param slot - slot of the child in the branch
+ */
+static void split_child(Leaderboard *board, uint32_t parentIndex, uint32_t slot)
+{
+    LeaderboardNode *parent = &board->nodes[parentIndex];
+    uint32_t childIndex = parent->branch.children[slot];
+    uint32_t rightIndex = get_header(board)->nodeCount++;
+    LeaderboardNode *child = &board->nodes[childIndex];
+    LeaderboardNode *right = &board->nodes[rightIndex];
+
+    uint64_t separator;
+    uint64_t leftSize = 0;
+    uint64_t rightSize = 0;
+    right->isLeaf = child->isLeaf;
+    right->next = 0;
+    if (child->isLeaf)
+    {
+        uint16_t half = child->count / 2;
+        right->count = static_cast<uint16_t>(child->count - half);
+        memcpy(right->keys, child->keys + half, right->count * sizeof(uint64_t));
+        child->count = half;
+        right->next = child->next;
+        child->next = rightIndex;
+
+        separator = right->keys[0];
+        leftSize = child->count;
+        rightSize = right->count;
+    }
+    else
+    {
+        uint16_t half = child->count / 2;
+        right->count = static_cast<uint16_t>(child->count - half);
+        memcpy(right->branch.children, child->branch.children + half, right->count * sizeof(uint32_t));
+        memcpy(right->branch.sizes, child->branch.sizes + half, right->count * sizeof(uint64_t));
+        memcpy(right->branch.separators, child->branch.separators + half, (right->count - 1) * sizeof(uint64_t));
+        separator = child->branch.separators[half - 1];
+        child->count = half;
+
+        for (uint16_t i = 0; i < child->count; i++)
+        {
+            leftSize += child->branch.sizes[i];
+        }
+        for (uint16_t i = 0; i < right->count; i++)
+        {
+            rightSize += right->branch.sizes[i];
+        }
+    }
+
+    uint32_t moved = parent->count - slot - 1;
+    memmove(parent->branch.children + slot + 2, parent->branch.children + slot + 1, moved * sizeof(uint32_t));
+    memmove(parent->branch.sizes + slot + 2, parent->branch.sizes + slot + 1, moved * sizeof(uint64_t));
+    memmove(parent->branch.separators + slot + 1, parent->branch.separators + slot, moved * sizeof(uint64_t));
+    parent->branch.children[slot + 1] = rightIndex;
+    parent->branch.sizes[slot] = leftSize;
+    parent->branch.sizes[slot + 1] = rightSize;
+    parent->branch.separators[slot] = separator;
+    parent->count++;
+}
+
+/**
+ * @brief Inserts a key into the tree. Full nodes are split on the way down so the insert
+ * never has to walk back up, and the sizes of the children taken are counted up.
+ *
+ * @param board - pointer to Leaderboard being written
+ * @param key - key of the new entry
+ * @return int64_t - rank of the new entry (0 for the best score) or -1 if the index could not grow
+ */
+static int64_t insert_key(Leaderboard *board, uint64_t key)
+{
+    LeaderboardHeader *header = get_header(board);
+    if (!reserve_nodes(board, header->height + 1))
+    {
+        return -1;
+    }
+    header = get_header(board);
+
+    LeaderboardNode *root = &board->nodes[header->root];
+    if (root->count == (root->isLeaf ? LEADERBOARD_LEAF_KEYS : LEADERBOARD_BRANCH_CHILDREN))
+    {
+        uint32_t newRootIndex = header->nodeCount++;
+        LeaderboardNode *newRoot = &board->nodes[newRootIndex];
+        newRoot->isLeaf = 0;
+        newRoot->count = 1;
+        newRoot->next = 0;
+        newRoot->branch.children[0] = header->root;
+        newRoot->branch.sizes[0] = header->entryCount;
+        header->root = newRootIndex;
+        header->height++;
+        split_child(board, newRootIndex, 0);
+    }
+
+    int64_t rank = 0;
+    LeaderboardNode *node = &board->nodes[header->root];
+    while (!node->isLeaf)
+    {
+        uint32_t slot = static_cast<uint32_t>(std::upper_bound(node->branch.separators, node->branch.separators + node->count - 1, key) - node->branch.separators);
+        LeaderboardNode *child = &board->nodes[node->branch.children[slot]];
+        if (child->count == (child->isLeaf ? LEADERBOARD_LEAF_KEYS : LEADERBOARD_BRANCH_CHILDREN))
+        {
+            split_child(board, static_cast<uint32_t>(node - board->nodes), slot);
+            if (key >= node->branch.separators[slot])
+            {
+                slot++;
+            }
+        }
+
+        for (uint32_t i = 0; i < slot; i++)
+        {
+            rank += static_cast<int64_t>(node->branch.sizes[i]);
+        }
+        node->branch.sizes[slot]++;
+        node = &board->nodes[node->branch.children[slot]];
+    }
+
+    uint32_t position = static_cast<uint32_t>(std::lower_bound(node->keys, node->keys + node->count, key) - node->keys);
+    memmove(node->keys + position + 1, node->keys + position, (node->count - position) * sizeof(uint64_t));
+    node->keys[position] = key;
+    node->count++;
+    return rank + position;
+}
+
+/**
+ * @brief Indexes the log entries past the ones already in the index
+ *
+ * @param board - pointer to Leaderboard opened for writing
+ * @param logSize - number of entries in the log
+ * @return true - every entry of the log is indexed
+ * @return false - the log could not be read or the index could not grow
+ */
+static bool index_log(Leaderboard *board, uint64_t logSize)
+{
+    LeaderboardEntry entries[LEADERBOARD_REBUILD_CHUNK];
+    while (get_header(board)->entryCount < logSize)
+    {
+        uint64_t first = get_header(board)->entryCount;
+        uint64_t count = std::min<uint64_t>(logSize - first, LEADERBOARD_REBUILD_CHUNK);
+        ssize_t length = pread(board->logFd, entries, count * sizeof(LeaderboardEntry), static_cast<off_t>(first * sizeof(LeaderboardEntry)));
+        if (length != static_cast<ssize_t>(count * sizeof(LeaderboardEntry)))
+        {
+            return false;
+        }
+
+        for (uint64_t i = 0; i < count; i++)
+        {
+            if (insert_key(board, make_key(entries[i].score, first + i)) < 0)
+            {
+                return false;
+            }
+            get_header(board)->entryCount++;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Opens <path>.log and maps <path>.idx, creating both if needed when opened for
+ * writing. A writer brings the index up to date with the log.
+ *
+ * @param board - pointer to Leaderboard to be opened
+ * @param path - path of the leaderboard without extension
+ * @param readOnly - open for queries only, from any number of processes
+ * @return true - leaderboard opened
+ * @return false - the files could not be opened, or a reader found no valid index
+ */
+bool open_leaderboard(Leaderboard *board, const char *path, bool readOnly)
+{
+    std::string logPath = std::string(path) + ".log";
+    std::string indexPath = std::string(path) + ".idx";
+    int32_t flags = (readOnly ? O_RDONLY : O_RDWR | O_CREAT) | O_CLOEXEC;
+    board->logFd = open(logPath.c_str(), flags, 0644);
+    board->indexFd = open(indexPath.c_str(), flags, 0644);
+    board->nodes = NULL;
+    board->capacity = 0;
+    board->readOnly = readOnly;
+    if (board->logFd < 0 || board->indexFd < 0)
+    {
+        close_leaderboard(board);
+        return false;
+    }
+
+    flock(board->indexFd, readOnly ? LOCK_SH : LOCK_EX);
+    struct stat status;
+    bool valid = fstat(board->indexFd, &status) == 0 && status.st_size >= LEADERBOARD_NODE_SIZE &&
+                 map_index(board, static_cast<uint32_t>(status.st_size / LEADERBOARD_NODE_SIZE));
+
+    uint64_t logSize = get_log_size(board);
+    if (valid)
+    {
+        LeaderboardHeader *header = get_header(board);
+        valid = header->magic == LEADERBOARD_MAGIC && !header->dirty && header->entryCount <= logSize &&
+                header->nodeCount <= board->capacity;
+    }
+
+    bool opened = valid;
+    if (!readOnly)
+    {
+        if (!valid)
+        {
+            opened = reset_index(board);
+        }
+        opened = opened && index_log(board, logSize);
+    }
+    flock(board->indexFd, LOCK_UN);
+
+    if (!opened)
+    {
+        close_leaderboard(board);
+    }
+    return opened;
+}
+
+/**
+ * @brief Unmaps the index and closes both files
+ *
+ * @param board - pointer to Leaderboard to be closed
+ */
+void close_leaderboard(Leaderboard *board)
+{
+    if (board->nodes)
+    {
+        munmap(board->nodes, static_cast<size_t>(board->capacity) * LEADERBOARD_NODE_SIZE);
+    }
+    if (board->logFd >= 0)
+    {
+        close(board->logFd);
+    }
+    if (board->indexFd >= 0)
+    {
+        close(board->indexFd);
+    }
+    board->logFd = -1;
+    board->indexFd = -1;
+    board->nodes = NULL;
+    board->capacity = 0;
+}
+
+/**
+ * @brief Appends a finished game to the log and inserts it into the index
+ *
+ * @param board - pointer to Leaderboard opened for writing
+ * @param entry - pointer to the LeaderboardEntry to be recorded
+ * @return int64_t - rank of the game (0 for the best score) or -1 on error
+ */
+int64_t record_score(Leaderboard *board, const LeaderboardEntry *entry)
+{
+    if (board->readOnly || board->nodes == NULL)
+    {
+        return -1;
+    }
+
+    flock(board->indexFd, LOCK_EX);
+    int64_t rank = -1;
+    uint64_t position = get_header(board)->entryCount;
+    if (refresh_mapping(board) && pwrite(board->logFd, entry, sizeof(*entry), static_cast<off_t>(position * sizeof(*entry))) == sizeof(*entry))
+    {
+        LeaderboardHeader *header = get_header(board);
+        // The log entry is written first, so a crash before the index is updated is repaired on open
+        header->dirty = 1;
+        rank = insert_key(board, make_key(entry->score, position));
+        header = get_header(board);
+        if (rank >= 0)
+        {
+            header->entryCount++;
+        }
+        header->dirty = 0;
+    }
+    flock(board->indexFd, LOCK_UN);
+    return rank;
+}
+
+/**
+ * @brief Returns the number of games on the leaderboard
+ *
+ * @param board - pointer to Leaderboard to be queried
+ * @return uint64_t - number of indexed entries
+ */
+uint64_t get_leaderboard_size(Leaderboard *board)
+{
+    return board->nodes ? get_header(board)->entryCount : 0;
+}
+
+/**
+ * @brief Counts the games that scored higher than score, which is the rank a game with
+ * that score would take (0 for a new best score)
+ *
+ * @param board - pointer to Leaderboard to be queried
+ * @param score - score to be ranked
+ * @return uint64_t - number of entries with a higher score
+ */
+uint64_t get_score_rank(Leaderboard *board, int32_t score)
+{
+    if (board->nodes == NULL)
+    {
+        return 0;
+    }
+
+    flock(board->indexFd, LOCK_SH);
+    uint64_t rank = 0;
+    if (refresh_mapping(board))
+    {
+        uint64_t bound = make_key(score, 0);
+        const LeaderboardNode *node = &board->nodes[get_header(board)->root];
+        while (!node->isLeaf)
+        {
+            uint32_t slot = static_cast<uint32_t>(std::upper_bound(node->branch.separators, node->branch.separators + node->count - 1, bound) - node->branch.separators);
+            for (uint32_t i = 0; i < slot; i++)
+            {
+                rank += node->branch.sizes[i];
+            }
+            node = &board->nodes[node->branch.children[slot]];
+        }
+        rank += static_cast<uint64_t>(std::lower_bound(node->keys, node->keys + node->count, bound) - node->keys);
+    }
+    flock(board->indexFd, LOCK_UN);
+    return rank;
+}
+
+/**
+ * @brief Reads the games ranked firstRank, firstRank + 1, ... from the log, best first.
+ * The leaf holding firstRank is found through the child sizes, then the leaves are walked.
+ *
+ * @param board - pointer to Leaderboard to be queried
+ * @param firstRank - rank of the first game to read, 0 for the best score
+ * @param entries - array receiving the games
+ * @param count - capacity of the array
+ * @return uint32_t - number of games read
+ */
+uint32_t get_top_scores(Leaderboard *board, uint64_t firstRank, LeaderboardEntry *entries, uint32_t count)
+{
+    if (board->nodes == NULL)
+    {
+        return 0;
+    }
+
+    flock(board->indexFd, LOCK_SH);
+    uint32_t found = 0;
+    if (refresh_mapping(board) && firstRank < get_header(board)->entryCount)
+    {
+        uint64_t rank = firstRank;
+        const LeaderboardNode *node = &board->nodes[get_header(board)->root];
+        while (!node->isLeaf)
+        {
+            uint32_t slot = 0;
+            while (slot + 1 < node->count && rank >= node->branch.sizes[slot])
+            {
+                rank -= node->branch.sizes[slot++];
+            }
+            node = &board->nodes[node->branch.children[slot]];
+        }
+
+        uint32_t position = static_cast<uint32_t>(rank);
+        while (found < count)
+        {
+            if (position == node->count)
+            {
+                if (node->next == 0)
+                {
+                    break;
+                }
+                node = &board->nodes[node->next];
+                position = 0;
+                continue;
+            }
+
+            uint64_t logPosition = node->keys[position++] & 0xFFFFFFFFull;
+            if (pread(board->logFd, &entries[found], sizeof(LeaderboardEntry), static_cast<off_t>(logPosition * sizeof(LeaderboardEntry))) != sizeof(LeaderboardEntry))
+            {
+                break;
+            }
+            found++;
+        }
+    }
+    flock(board->indexFd, LOCK_UN);
+    return found;
+}
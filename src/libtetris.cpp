@@ -0,0 +1,138 @@
+#include <new>
+#include "../inc/libtetris.h"
+#include "../inc/protocol.h"
+#include "../inc/replay.h"
+
+static_assert(static_cast<int32_t>(TETRIS_KEY_A) == INPUT_KEY_A && static_cast<int32_t>(TETRIS_KEY_DOWN) == INPUT_KEY_DOWN &&
+                  static_cast<int32_t>(TETRIS_KEY_B) == INPUT_KEY_B,
+              "actions are InputKey bits");
+static_assert(static_cast<int32_t>(TETRIS_PHASE_GAMEOVER) == GAME_PHASE_GAMEOVER, "phases are GamePhase values");
+
+// A game behind an opaque handle, stepped the same way a replay is
+struct TetrisGame
+{
+    ReplayCursor cursor;
+};
+
+/**
+ * @brief Returns the version of the C ABI, bumped on every incompatible change
+ *
+ * @return uint32_t - TETRIS_ABI_VERSION the library was built with
+ */
+uint32_t tetris_abi_version(void)
+{
+    return TETRIS_ABI_VERSION;
+}
+
+/**
+ * @brief Returns the number of columns of the board
+ *
+ * @return int32_t - board width
+ */
+int32_t tetris_board_width(void)
+{
+    return GameState::BOARD_WIDTH;
+}
+
+/**
+ * @brief Returns the number of rows of the board, including the hidden rows at the top
+ *
+ * @return int32_t - board height
+ */
+int32_t tetris_board_height(void)
+{
+    return GameState::BOARD_HEIGHT;
+}
+
+/**
+ * @brief Allocates a game on the start screen
+ *
+ * @param seed - state of the random piece generator
+ * @return TetrisGame* - handle of the game or NULL if out of memory
+ */
+TetrisGame *tetris_create(uint32_t seed)
+{
+    TetrisGame *game = new (std::nothrow) TetrisGame();
+    if (game)
+    {
+        tetris_reset(game, seed);
+    }
+    return game;
+}
+
+/**
+ * @brief Frees a game
+ *
+ * @param game - handle returned by tetris_create(), may be NULL
+ */
+void tetris_destroy(TetrisGame *game)
+{
+    delete game;
+}
+
+/**
+ * @brief Puts a game back on the start screen with a new seed
+ *
+ * @param game - handle of the game
+ * @param seed - state of the random piece generator
+ */
+void tetris_reset(TetrisGame *game, uint32_t seed)
+{
+    init_replay_game(&game->cursor.game, seed);
+    game->cursor.input = {};
+    game->cursor.frame = 0;
+}
+
+/**
+ * @brief Steps every game by one frame with its own keys
+ *
+ * @param games - handles of the games
+ * @param actions - TETRIS_KEY_* bits held by each game during the frame
+ * @param count - number of games
+ */
+void tetris_step_batch(TetrisGame *const *games, const uint8_t *actions, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        ReplayCursor *cursor = &games[i]->cursor;
+        apply_input_keys(&cursor->input, actions[i]);
+        cursor->frame++;
+        cursor->game.frame = cursor->frame;
+        update_game(&cursor->game, &cursor->input);
+    }
+}
+
+/**
+ * @brief Copies the state of every game into caller-provided buffers
+ *
+ * @param games - handles of the games
+ * @param count - number of games
+ * @param states - receives count states, may be NULL
+ * @param boards - receives count boards of width * height cells (0 empty, else the color of the cell), row-major, may be NULL
+ */
+void tetris_export_batch(TetrisGame *const *games, uint32_t count, TetrisState *states, uint8_t *boards)
+{
+    const size_t boardSize = sizeof(GameState::board);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const GameState *game = &games[i]->cursor.game;
+        if (states)
+        {
+            TetrisState *state = &states[i];
+            state->score = game->score;
+            state->level = game->level;
+            state->lineCount = game->lineCount;
+            state->phase = game->phase;
+            state->frame = games[i]->cursor.frame;
+            state->randomState = game->randomState;
+            state->tetrominoIndex = game->piece.tetrominoIndex;
+            state->rotation = static_cast<uint8_t>(game->piece.rotation);
+            state->offsetRow = static_cast<int8_t>(game->piece.offsetRow);
+            state->offsetCol = static_cast<int8_t>(game->piece.offsetCol);
+        }
+        if (boards)
+        {
+            memcpy(boards + i * boardSize, game->board, boardSize);
+        }
+    }
+}
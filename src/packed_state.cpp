@@ -0,0 +1,126 @@
+#include "../inc/packed_state.h"
+
+#define PACKED_DROP_FRAMES_MIN -64
+#define PACKED_DROP_FRAMES_MAX 63
+#define PACKED_HIGHLIGHT_FRAMES_MAX 31
+
+// Function Prototypes
+inline int32_t clamp_frames(int64_t frames, int32_t minFrames, int32_t maxFrames);
+
+/**
+ * @brief Clamps a timer, as frames from the current frame, to what can be stored
+ *
+ * @param frames - frames until the timer fires
+ * @param minFrames - smallest offset that can be stored
+ * @param maxFrames - largest offset that can be stored
+ * @return int32_t - frame offset of the timer, clamped to [minFrames, maxFrames]
+ */
+inline int32_t clamp_frames(int64_t frames, int32_t minFrames, int32_t maxFrames)
+{
+    return static_cast<int32_t>(frames < minFrames ? minFrames : (frames > maxFrames ? maxFrames : frames));
+}
+
+/**
+ * @brief Packs a game into its compact form
+ *
+ * @param game - pointer to GameState to be packed
+ * @param packed - pointer to PackedGameState receiving the packed game
+ */
+void pack_game_state(const GameState *game, PackedGameState *packed)
+{
+    const int32_t width = GameState::BOARD_WIDTH;
+    *packed = {};
+
+    // Rows are written back to back, BOARD_WIDTH bits each
+    for (int32_t row = 0; row < GameState::BOARD_HEIGHT; row++)
+    {
+        uint32_t bit = row * width;
+        uint32_t mask = game->rows[row];
+        for (int32_t col = 0; col < width; col++, bit++)
+        {
+            if (mask & (1u << col))
+            {
+                packed->board[bit >> 3] |= static_cast<uint8_t>(1 << (bit & 7));
+            }
+        }
+    }
+
+    uint32_t frame = game->frame;
+    int32_t dropFrames = clamp_frames(static_cast<int64_t>(game->nextDropFrame) - frame, PACKED_DROP_FRAMES_MIN, PACKED_DROP_FRAMES_MAX);
+    int32_t highlightFrames = 0;
+    if (game->phase == GAME_PHASE_LINE)
+    {
+        highlightFrames = clamp_frames(static_cast<int64_t>(game->highlightEndFrame) - frame, 0, PACKED_HIGHLIGHT_FRAMES_MAX);
+    }
+
+    packed->score = static_cast<uint32_t>(game->score);
+    packed->randomState = game->randomState;
+    packed->frame = frame;
+    packed->lineCount = static_cast<uint16_t>(game->lineCount);
+    packed->level = static_cast<uint8_t>(game->level);
+    packed->startLevel = static_cast<uint8_t>(game->startLevel);
+    packed->offsetRow = static_cast<int8_t>(game->piece.offsetRow);
+    packed->offsetCol = static_cast<int8_t>(game->piece.offsetCol);
+
+    uint32_t bits = (game->piece.tetrominoIndex & 7u) |
+                    ((game->piece.rotation & 3u) << 3) |
+                    ((static_cast<uint32_t>(game->phase) & 3u) << 5) |
+                    ((static_cast<uint32_t>(dropFrames) & 0x7Fu) << 7) |
+                    ((static_cast<uint32_t>(highlightFrames) & 0x1Fu) << 14);
+    packed->bits[0] = static_cast<uint8_t>(bits);
+    packed->bits[1] = static_cast<uint8_t>(bits >> 8);
+    packed->bits[2] = static_cast<uint8_t>(bits >> 16);
+}
+
+/**
+ * @brief Restores a game from its compact form
+ *
+ * @param packed - pointer to PackedGameState to be unpacked
+ * @param game - pointer to GameState receiving the game
+ */
+void unpack_game_state(const PackedGameState *packed, GameState *game)
+{
+    const int32_t width = GameState::BOARD_WIDTH;
+    *game = {};
+
+    for (int32_t row = 0; row < GameState::BOARD_HEIGHT; row++)
+    {
+        uint32_t bit = row * width;
+        for (int32_t col = 0; col < width; col++, bit++)
+        {
+            if ((packed->board[bit >> 3] >> (bit & 7)) & 1)
+            {
+                game->board[row * width + col] = PACKED_CELL_VALUE;
+                game->rows[row] = static_cast<GameState::RowMask>(game->rows[row] | (1u << col));
+            }
+        }
+    }
+
+    uint32_t bits = packed->bits[0] | (packed->bits[1] << 8) | (packed->bits[2] << 16);
+    int32_t dropFrames = static_cast<int32_t>((bits >> 7) & 0x7F);
+    if (dropFrames > PACKED_DROP_FRAMES_MAX)
+    {
+        dropFrames -= 0x80;
+    }
+    int32_t highlightFrames = static_cast<int32_t>((bits >> 14) & 0x1F);
+
+    game->piece.tetrominoIndex = static_cast<uint8_t>(bits & 7);
+    game->piece.rotation = static_cast<int32_t>((bits >> 3) & 3);
+    game->piece.offsetRow = packed->offsetRow;
+    game->piece.offsetCol = packed->offsetCol;
+    game->phase = static_cast<GamePhase>((bits >> 5) & 3);
+
+    game->level = packed->level;
+    game->startLevel = packed->startLevel;
+    game->lineCount = packed->lineCount;
+    game->score = static_cast<int32_t>(packed->score);
+    game->randomState = packed->randomState;
+
+    game->frame = packed->frame;
+    game->nextDropFrame = static_cast<uint32_t>(static_cast<int64_t>(packed->frame) + dropFrames);
+    if (game->phase == GAME_PHASE_LINE)
+    {
+        game->highlightEndFrame = packed->frame + static_cast<uint32_t>(highlightFrames);
+        game->pendingLineCount = find_lines(game);
+    }
+}
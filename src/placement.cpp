@@ -0,0 +1,198 @@
+#include "../inc/placement.h"
+
+/*
+Positions of a piece are numbered ((rotation * (H + 6)) + row + 4) * (W + 5) + col + 4.
+The +4 covers the negative offsets a 4x4 tetromino matrix can take at the edges, and the
+extra rows and column the positions past the floor and the right edge that a move or a
+kick is looked up at before it is validated.
+*/
+template <typename Game>
+struct PlacementSpace
+{
+    static const int32_t ROWS = Game::BOARD_HEIGHT + 6;
+    static const int32_t COLS = Game::BOARD_WIDTH + 5;
+    static const int32_t POSITIONS = 4 * ROWS * COLS;
+
+    static inline int32_t index(const PieceState *piece)
+    {
+        return (piece->rotation * ROWS + piece->offsetRow + 4) * COLS + piece->offsetCol + 4;
+    }
+};
+
+/**
+ * @brief Initializes a piece at the spawn position used by spawn_piece()
+ *
+ * @param piece - receives the spawned piece
+ * @param tetrominoIndex - index of the tetromino in TETROMINOS
+ */
+template <typename Game>
+void init_spawn_piece(PieceState *piece, uint8_t tetrominoIndex)
+{
+    *piece = {};
+    piece->tetrominoIndex = tetrominoIndex;
+    piece->offsetCol = Game::BOARD_WIDTH / 2;
+}
+
+/**
+ * @brief Packs the cells covered by a piece into a key, equal for placements covering the same cells
+ *
+ * @param piece - pointer to the piece
+ * @return uint64_t - row and column of the top left filled cell and the 4x4 shape below it
+ */
+inline uint64_t get_placement_key(const PieceState *piece)
+{
+    const PieceMask *mask = get_piece_mask(piece->tetrominoIndex, piece->rotation);
+    uint64_t key = static_cast<uint64_t>(static_cast<uint16_t>(piece->offsetRow + mask->minRow)) << 32 |
+                   static_cast<uint64_t>(static_cast<uint16_t>(piece->offsetCol + mask->minCol)) << 16;
+    for (int32_t row = mask->minRow; row <= mask->maxRow; row++)
+    {
+        key |= static_cast<uint64_t>((mask->rows[row] >> mask->minCol) & 0xF) << ((row - mask->minRow) * 4);
+    }
+    return key;
+}
+
+/**
+ * @brief Finds every resting position a piece can reach from its spawn position (breadth first)
+ *
+ * @param game - pointer to the game whose board the piece moves on
+ * @param spawn - pointer to the piece at its spawn position
+ * @param placements - cleared and filled with one piece per distinct set of covered cells, empty if the spawn position is blocked
+ */
+template <typename Game>
+void find_placements(const Game *game, const PieceState *spawn, std::vector<PieceState> *placements)
+{
+    typedef PlacementSpace<Game> Space;
+    static_assert(Space::POSITIONS <= 0xFFFF, "positions are queued as 16 bit indices");
+    // Column changes of update_game_play(). A frame that also rotates is a column change
+    // followed by a rotation, so stepping them one at a time reaches the same positions.
+    static const int8_t MOVES[] = {-1, 1};
+
+    placements->clear();
+    if (!check_piece_valid(spawn, game))
+    {
+        return;
+    }
+
+    uint8_t visited[Space::POSITIONS] = {};
+    uint16_t queue[Space::POSITIONS];
+    uint64_t keys[Space::POSITIONS];
+    int32_t head = 0;
+    int32_t tail = 0;
+    int32_t keyCount = 0;
+
+    PieceState start = *spawn;
+    start.rotation &= 3;
+    visited[Space::index(&start)] = 1;
+    queue[tail++] = static_cast<uint16_t>(Space::index(&start));
+
+    while (head < tail)
+    {
+        int32_t index = queue[head++];
+        PieceState piece = *spawn;
+        piece.offsetCol = index % Space::COLS - 4;
+        piece.offsetRow = index / Space::COLS % Space::ROWS - 4;
+        piece.rotation = index / Space::COLS / Space::ROWS;
+
+        for (uint32_t move = 0; move < ARRAY_COUNT(MOVES); move++)
+        {
+            PieceState next = piece;
+            next.offsetCol += MOVES[move];
+            int32_t nextIndex = Space::index(&next);
+            if (!visited[nextIndex] && check_piece_valid(&next, game))
+            {
+                visited[nextIndex] = 1;
+                queue[tail++] = static_cast<uint16_t>(nextIndex);
+            }
+        }
+
+        // Kicks in order like rotate_piece(). Visited positions are valid, so the first
+        // visited kick is where the rotation lands and nothing is left to check.
+        for (int32_t direction = ROTATION_CW; direction <= ROTATION_CCW; direction++)
+        {
+            const RotationKicks *rotation = get_rotation_kicks(piece.tetrominoIndex, piece.rotation, static_cast<RotationDirection>(direction));
+            for (int32_t kick = 0; kick < rotation->kickCount; kick++)
+            {
+                PieceState next = piece;
+                next.offsetRow += rotation->rows[kick];
+                next.offsetCol += rotation->cols[kick];
+                next.rotation = rotation->rotation;
+                int32_t nextIndex = Space::index(&next);
+                if (visited[nextIndex])
+                {
+                    break;
+                }
+                if (check_mask_valid(rotation->mask, next.offsetRow, next.offsetCol, game))
+                {
+                    visited[nextIndex] = 1;
+                    queue[tail++] = static_cast<uint16_t>(nextIndex);
+                    break;
+                }
+            }
+        }
+
+        PieceState dropped = piece;
+        dropped.offsetRow++;
+        if (check_piece_valid(&dropped, game))
+        {
+            int32_t droppedIndex = Space::index(&dropped);
+            if (!visited[droppedIndex])
+            {
+                visited[droppedIndex] = 1;
+                queue[tail++] = static_cast<uint16_t>(droppedIndex);
+            }
+            continue;
+        }
+
+        // A soft drop would lock the piece here
+        uint64_t key = get_placement_key(&piece);
+        int32_t i = 0;
+        while (i < keyCount && keys[i] != key)
+        {
+            i++;
+        }
+        if (i == keyCount)
+        {
+            keys[keyCount++] = key;
+            placements->push_back(piece);
+        }
+    }
+}
+
+/**
+ * @brief Locks a piece into the board and clears the lines it fills. Only the board and its
+ * occupancy masks change, the score, level and line count are left to the caller.
+ *
+ * @param game - pointer to the game
+ * @param piece - pointer to the piece, a placement returned by find_placements()
+ * @return int32_t - number of cleared lines, or -1 if the piece reaches the top row and ends the game
+ */
+template <typename Game>
+int32_t place_piece(Game *game, const PieceState *piece)
+{
+    const typename Game::RowMask emptyRow = {};
+    game->piece = *piece;
+    merge_piece(game);
+
+    // update_game_play() checks the top row before the filled lines are cleared
+    if (memcmp(&game->rows[0], &emptyRow, sizeof(emptyRow)) != 0)
+    {
+        return -1;
+    }
+
+    int32_t lineCount = find_lines(game);
+    if (lineCount > 0)
+    {
+        clear_lines(game);
+    }
+    return lineCount;
+}
+
+#define INSTANTIATE_PLACEMENT(Game)                                                                                  \
+    template void init_spawn_piece<Game>(PieceState *piece, uint8_t tetrominoIndex);                                \
+    template void find_placements<Game>(const Game *game, const PieceState *spawn, std::vector<PieceState> *placements); \
+    template int32_t place_piece<Game>(Game *game, const PieceState *piece);
+
+INSTANTIATE_PLACEMENT(GameState)
+INSTANTIATE_PLACEMENT(GameState10)
+INSTANTIATE_PLACEMENT(GameState40)
+INSTANTIATE_PLACEMENT(GameState80)
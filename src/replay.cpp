@@ -0,0 +1,117 @@
+#include "../inc/replay.h"
+#include "../inc/protocol.h"
+
+/**
+ * @brief Puts a game in the state every session starts from
+ *
+ * @param game - pointer to GameState to be initialised
+ * @param seed - state of the random piece generator
+ */
+void init_replay_game(GameState *game, uint32_t seed)
+{
+    *game = {};
+    game->randomState = seed;
+    spawn_piece(game);
+}
+
+/**
+ * @brief Rewinds a cursor to frame 0 of a replay, the start screen of the recorded game.
+ * The piece shown there is never drawn and is replaced when the game starts, so it is not recorded.
+ *
+ * @param cursor - pointer to ReplayCursor to be rewound
+ * @param replay - pointer to Replay being played
+ */
+void init_replay_cursor(ReplayCursor *cursor, const Replay *replay)
+{
+    cursor->game = {};
+    cursor->game.randomState = replay->randomState;
+    cursor->game.startLevel = replay->startLevel;
+    cursor->input = {};
+    apply_input_keys(&cursor->input, replay->heldKeys);
+    cursor->frame = 0;
+}
+
+/**
+ * @brief Steps the game of a cursor by one frame with the recorded keys of that frame
+ *
+ * @param cursor - pointer to ReplayCursor to be stepped
+ * @param replay - pointer to Replay being played
+ * @return true - frame stepped
+ * @return false - the cursor is at the end of the replay
+ */
+bool step_replay(ReplayCursor *cursor, const Replay *replay)
+{
+    if (cursor->frame >= replay->keys.size())
+    {
+        return false;
+    }
+
+    apply_input_keys(&cursor->input, replay->keys[cursor->frame]);
+    cursor->frame++;
+    cursor->game.frame = cursor->frame;
+    update_game(&cursor->game, &cursor->input);
+    return true;
+}
+
+/**
+ * @brief Writes a replay to a file
+ *
+ * @param path - path of the file to be written
+ * @param replay - pointer to Replay to be written
+ * @return true - replay written
+ * @return false - the file could not be written
+ */
+bool write_replay(const char *path, const Replay *replay)
+{
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    ReplayHeader header = {};
+    header.magic = REPLAY_MAGIC;
+    header.version = REPLAY_VERSION;
+    header.boardWidth = GameState::BOARD_WIDTH;
+    header.randomState = replay->randomState;
+    header.startLevel = replay->startLevel;
+    header.heldKeys = replay->heldKeys;
+    header.gameStartFrame = replay->gameStartFrame;
+    header.frameCount = static_cast<uint32_t>(replay->keys.size());
+
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   fwrite(replay->keys.data(), 1, replay->keys.size(), file) == replay->keys.size();
+    return fclose(file) == 0 && written;
+}
+
+/**
+ * @brief Reads a replay recorded by an engine with the same board width
+ *
+ * @param path - path of the file to be read
+ * @param replay - pointer to Replay receiving the file
+ * @return true - replay read
+ * @return false - the file could not be read or is not a replay of this engine
+ */
+bool read_replay(const char *path, Replay *replay)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    ReplayHeader header;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 && header.magic == REPLAY_MAGIC &&
+                 header.version == REPLAY_VERSION && header.boardWidth == GameState::BOARD_WIDTH;
+    if (valid)
+    {
+        replay->randomState = header.randomState;
+        replay->startLevel = header.startLevel;
+        replay->heldKeys = header.heldKeys;
+        replay->gameStartFrame = header.gameStartFrame;
+        replay->keys.resize(header.frameCount);
+        valid = fread(replay->keys.data(), 1, header.frameCount, file) == header.frameCount;
+    }
+    fclose(file);
+    return valid;
+}
@@ -0,0 +1,408 @@
+#include <cstring>
+#include <ctime>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "../inc/rollback.h"
+
+static_assert((ROLLBACK_WINDOW & (ROLLBACK_WINDOW - 1)) == 0, "frames index the rings with a modulo");
+static_assert(ROLLBACK_PACKET_INPUTS <= 255, "the input count of a packet is one byte");
+
+// Function Prototypes
+inline uint64_t get_rollback_time();
+static void simulate_rollback_frame(RollbackSession *session);
+static void receive_rollback_packets(RollbackSession *session);
+static void update_rollback_checksums(RollbackSession *session);
+static void check_rollback_desync(RollbackSession *session);
+static void send_rollback_packet(RollbackSession *session);
+static void flush_rollback_link(RollbackSession *session);
+
+/**
+ * @brief Gets the monotonic clock in nanoseconds
+ *
+ * @return uint64_t - current monotonic time
+ */
+inline uint64_t get_rollback_time()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ull + static_cast<uint64_t>(now.tv_nsec);
+}
+
+/**
+ * @brief Opens a UDP socket to the remote peer and starts the match. Both peers must use the
+ * same seed and different players.
+ *
+ * @param session - pointer to RollbackSession to be initialised
+ * @param localPort - UDP port to receive on
+ * @param remoteAddress - IPv4 address of the remote peer
+ * @param remotePort - UDP port of the remote peer
+ * @param localPlayer - index of the local player in the match (0 or 1)
+ * @param seed - seed of the match
+ * @return bool - true if the socket was opened
+ */
+bool open_rollback_session(RollbackSession *session, uint16_t localPort, const char *remoteAddress, uint16_t remotePort, int32_t localPlayer, uint32_t seed)
+{
+    RollbackLink link = session->link;
+    *session = {};
+    session->link = link;
+    session->fd = -1;
+    session->localPlayer = localPlayer;
+    session->checksumFrame = ROLLBACK_CHECKSUM_INTERVAL;
+    session->nextSyncFrame = ROLLBACK_SYNC_INTERVAL;
+    session->linkRandomState = seed * 2654435761u + static_cast<uint32_t>(localPlayer) + 1;
+    init_versus(&session->state, seed);
+
+    session->remote.sin_family = AF_INET;
+    session->remote.sin_port = htons(remotePort);
+    if (localPlayer < 0 || localPlayer >= VERSUS_PLAYERS || inet_pton(AF_INET, remoteAddress, &session->remote.sin_addr) != 1)
+    {
+        return false;
+    }
+
+    int32_t fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(localPort);
+    if (bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0)
+    {
+        close(fd);
+        return false;
+    }
+    session->fd = fd;
+    return true;
+}
+
+/**
+ * @brief Sends the packets still held by the artificial link and closes the socket
+ *
+ * @param session - pointer to the session
+ */
+void close_rollback_session(RollbackSession *session)
+{
+    if (session->fd < 0)
+    {
+        return;
+    }
+    for (const DelayedPacket &packet : session->delayed)
+    {
+        sendto(session->fd, packet.bytes.data(), packet.bytes.size(), 0,
+               reinterpret_cast<const sockaddr *>(&session->remote), sizeof(session->remote));
+    }
+    session->delayed.clear();
+    close(session->fd);
+    session->fd = -1;
+}
+
+/**
+ * @brief Simulates the frame the match is at, with the local keys and the remote keys if
+ * they are known or else the last ones received. The match is saved first so the frame can
+ * be simulated again once its remote keys arrive.
+ *
+ * @param session - pointer to the session
+ */
+static void simulate_rollback_frame(RollbackSession *session)
+{
+    uint32_t frame = session->state.frame;
+    session->saved[frame % ROLLBACK_WINDOW] = session->state;
+
+    uint8_t remoteKeys = 0;
+    if (frame < session->remoteFrames)
+    {
+        remoteKeys = session->remoteKeys[frame % ROLLBACK_KEY_RING];
+    }
+    else if (session->remoteFrames > 0)
+    {
+        remoteKeys = session->remoteKeys[(session->remoteFrames - 1) % ROLLBACK_KEY_RING];
+    }
+    session->predictedKeys[frame % ROLLBACK_KEY_RING] = remoteKeys;
+
+    uint8_t keys[VERSUS_PLAYERS];
+    keys[session->localPlayer] = session->localKeys[frame % ROLLBACK_KEY_RING];
+    keys[1 - session->localPlayer] = remoteKeys;
+    step_versus(&session->state, keys);
+}
+
+/**
+ * @brief Reads every packet waiting on the socket, stores the new remote keys and rolls the
+ * match back to the first frame whose prediction they prove wrong
+ *
+ * @param session - pointer to the session
+ */
+static void receive_rollback_packets(RollbackSession *session)
+{
+    uint32_t frame = session->state.frame;
+    uint32_t rollbackFrame = frame;
+    uint8_t buffer[sizeof(VersusInputHeader) + ROLLBACK_PACKET_INPUTS];
+    for (;;)
+    {
+        sockaddr_in source;
+        socklen_t sourceSize = sizeof(source);
+        ssize_t size = recvfrom(session->fd, buffer, sizeof(buffer), 0, reinterpret_cast<sockaddr *>(&source), &sourceSize);
+        if (size < 0)
+        {
+            break;
+        }
+
+        VersusInputHeader header;
+        if (static_cast<size_t>(size) < sizeof(header) || source.sin_addr.s_addr != session->remote.sin_addr.s_addr ||
+            source.sin_port != session->remote.sin_port)
+        {
+            continue;
+        }
+        memcpy(&header, buffer, sizeof(header));
+        if (header.type != MESSAGE_VERSUS_INPUT || static_cast<size_t>(size) != sizeof(header) + header.inputCount)
+        {
+            continue;
+        }
+        session->stats.packetsReceived++;
+
+        if (header.frame > session->remoteFrame)
+        {
+            session->remoteFrame = header.frame;
+            session->remoteAdvantage = header.advantage;
+        }
+        if (header.ackFrame > session->remoteAck)
+        {
+            session->remoteAck = header.ackFrame;
+        }
+        if (header.checksumFrame > session->remoteChecksumFrame)
+        {
+            session->remoteChecksumFrame = header.checksumFrame;
+            session->remoteChecksum = header.checksum;
+        }
+
+        // Only keys that extend the known ones without a gap, and never further ahead than the ring holds
+        uint32_t end = header.firstFrame + header.inputCount;
+        if (end > frame + ROLLBACK_WINDOW)
+        {
+            end = frame + ROLLBACK_WINDOW;
+        }
+        if (header.firstFrame > session->remoteFrames || end <= session->remoteFrames)
+        {
+            continue;
+        }
+        const uint8_t *keys = buffer + sizeof(header);
+        for (uint32_t f = session->remoteFrames; f < end; f++)
+        {
+            uint8_t remoteKeys = keys[f - header.firstFrame];
+            session->remoteKeys[f % ROLLBACK_KEY_RING] = remoteKeys;
+            if (f < frame && f < rollbackFrame && session->predictedKeys[f % ROLLBACK_KEY_RING] != remoteKeys)
+            {
+                rollbackFrame = f;
+            }
+        }
+        session->remoteFrames = end;
+    }
+
+    if (rollbackFrame < frame)
+    {
+        session->state = session->saved[rollbackFrame % ROLLBACK_WINDOW];
+        while (session->state.frame < frame)
+        {
+            simulate_rollback_frame(session);
+        }
+        uint32_t frames = frame - rollbackFrame;
+        session->stats.rollbacks++;
+        session->stats.resimulatedFrames += frames;
+        session->stats.maxRollbackFrames = frames > session->stats.maxRollbackFrames ? frames : session->stats.maxRollbackFrames;
+    }
+    update_rollback_checksums(session);
+}
+
+/**
+ * @brief Hashes every checksum frame that has become confirmed, both simulated and with the
+ * real keys of both players
+ *
+ * @param session - pointer to the session
+ */
+static void update_rollback_checksums(RollbackSession *session)
+{
+    uint32_t confirmed = get_confirmed_frame(session);
+    while (session->checksumFrame <= confirmed)
+    {
+        uint32_t checksumFrame = session->checksumFrame;
+        const VersusState *state = checksumFrame == session->state.frame ? &session->state
+                                                                         : &session->saved[checksumFrame % ROLLBACK_WINDOW];
+        uint32_t slot = (checksumFrame / ROLLBACK_CHECKSUM_INTERVAL) % ROLLBACK_CHECKSUMS;
+        session->checksumFrames[slot] = checksumFrame;
+        session->checksums[slot] = hash_versus_state(state);
+        session->checksumFrame += ROLLBACK_CHECKSUM_INTERVAL;
+    }
+    check_rollback_desync(session);
+}
+
+/**
+ * @brief Compares the newest checksum of the remote with the local one of the same frame
+ *
+ * @param session - pointer to the session
+ */
+static void check_rollback_desync(RollbackSession *session)
+{
+    uint32_t checksumFrame = session->remoteChecksumFrame;
+    uint32_t slot = (checksumFrame / ROLLBACK_CHECKSUM_INTERVAL) % ROLLBACK_CHECKSUMS;
+    if (session->desynced || checksumFrame == 0 || session->checksumFrames[slot] != checksumFrame)
+    {
+        return;
+    }
+    if (session->checksums[slot] != session->remoteChecksum)
+    {
+        session->desynced = true;
+        session->desyncFrame = checksumFrame;
+    }
+}
+
+/**
+ * @brief Sends the local keys the remote has not acknowledged yet, with the frame advantage
+ * and the newest local checksum. Every packet repeats the unacknowledged keys, so a lost
+ * packet costs nothing but a later correction.
+ *
+ * @param session - pointer to the session
+ */
+static void send_rollback_packet(RollbackSession *session)
+{
+    uint32_t frame = session->state.frame;
+    uint32_t first = session->remoteAck;
+    if (frame - first > ROLLBACK_PACKET_INPUTS)
+    {
+        first = frame - ROLLBACK_PACKET_INPUTS;
+    }
+
+    uint8_t buffer[sizeof(VersusInputHeader) + ROLLBACK_PACKET_INPUTS];
+    VersusInputHeader header = {};
+    header.type = MESSAGE_VERSUS_INPUT;
+    header.inputCount = static_cast<uint8_t>(frame - first);
+    header.advantage = static_cast<int16_t>(static_cast<int32_t>(frame - session->remoteFrame));
+    header.frame = frame;
+    header.firstFrame = first;
+    header.ackFrame = session->remoteFrames;
+    uint32_t lastChecksumFrame = session->checksumFrame - ROLLBACK_CHECKSUM_INTERVAL;
+    if (lastChecksumFrame > 0)
+    {
+        header.checksumFrame = lastChecksumFrame;
+        header.checksum = session->checksums[(lastChecksumFrame / ROLLBACK_CHECKSUM_INTERVAL) % ROLLBACK_CHECKSUMS];
+    }
+    memcpy(buffer, &header, sizeof(header));
+    for (uint32_t f = first; f < frame; f++)
+    {
+        buffer[sizeof(header) + f - first] = session->localKeys[f % ROLLBACK_KEY_RING];
+    }
+    size_t size = sizeof(header) + header.inputCount;
+    session->stats.packetsSent++;
+
+    if (session->link.lossPercent > 0)
+    {
+        uint32_t x = session->linkRandomState;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        session->linkRandomState = x;
+        if (x % 100 < session->link.lossPercent)
+        {
+            session->stats.packetsLost++;
+            return;
+        }
+    }
+    if (session->link.latencyMilliseconds > 0)
+    {
+        DelayedPacket packet;
+        packet.sendTime = get_rollback_time() + session->link.latencyMilliseconds * 1000000ull;
+        packet.bytes.assign(buffer, buffer + size);
+        session->delayed.push_back(std::move(packet));
+        return;
+    }
+    sendto(session->fd, buffer, size, 0, reinterpret_cast<const sockaddr *>(&session->remote), sizeof(session->remote));
+}
+
+/**
+ * @brief Sends the packets of the artificial link whose latency has passed
+ *
+ * @param session - pointer to the session
+ */
+static void flush_rollback_link(RollbackSession *session)
+{
+    uint64_t now = get_rollback_time();
+    while (!session->delayed.empty() && session->delayed.front().sendTime <= now)
+    {
+        const DelayedPacket &packet = session->delayed.front();
+        sendto(session->fd, packet.bytes.data(), packet.bytes.size(), 0,
+               reinterpret_cast<const sockaddr *>(&session->remote), sizeof(session->remote));
+        session->delayed.pop_front();
+    }
+}
+
+/**
+ * @brief Runs one tick of the session: applies the remote keys received so far, simulates
+ * the next frame with the local keys unless the session is too far ahead of the remote, and
+ * sends the local keys. Call once per display frame.
+ *
+ * @param session - pointer to the session
+ * @param keys - packed InputKey bits held by the local player
+ * @return bool - true if a frame was simulated
+ */
+bool advance_rollback_session(RollbackSession *session, uint8_t keys)
+{
+    receive_rollback_packets(session);
+
+    bool simulated = false;
+    uint32_t frame = session->state.frame;
+    if (session->waitTicks > 0)
+    {
+        session->waitTicks--;
+        session->stats.syncTicks++;
+    }
+    else if (frame - session->remoteFrames >= ROLLBACK_WINDOW)
+    {
+        session->stats.stalledTicks++;
+    }
+    else
+    {
+        session->localKeys[frame % ROLLBACK_KEY_RING] = keys;
+        simulate_rollback_frame(session);
+        update_rollback_checksums(session);
+        simulated = true;
+
+        // Wait out half the difference between the advantages, so both peers end up the same distance ahead
+        if (session->state.frame >= session->nextSyncFrame)
+        {
+            int32_t advantage = static_cast<int32_t>(session->state.frame - session->remoteFrame);
+            int32_t wait = (advantage - session->remoteAdvantage) / 2;
+            session->waitTicks = wait > ROLLBACK_MAX_WAIT_TICKS ? ROLLBACK_MAX_WAIT_TICKS : (wait > 0 ? wait : 0);
+            session->nextSyncFrame = session->state.frame + ROLLBACK_SYNC_INTERVAL;
+        }
+    }
+
+    send_rollback_packet(session);
+    flush_rollback_link(session);
+    return simulated;
+}
+
+/**
+ * @brief Receives and sends like advance_rollback_session() without simulating a frame, to
+ * keep acknowledging the remote once the local peer has stopped
+ *
+ * @param session - pointer to the session
+ */
+void poll_rollback_session(RollbackSession *session)
+{
+    receive_rollback_packets(session);
+    send_rollback_packet(session);
+    flush_rollback_link(session);
+}
+
+/**
+ * @brief Gets the newest frame the match is known to reach with the real keys of both
+ * players. The match state at the start of it will never be rolled back.
+ *
+ * @param session - pointer to the session
+ * @return uint32_t - confirmed frame
+ */
+uint32_t get_confirmed_frame(const RollbackSession *session)
+{
+    return session->remoteFrames < session->state.frame ? session->remoteFrames : session->state.frame;
+}
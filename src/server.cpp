@@ -0,0 +1,1166 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "../inc/server.h"
+
+#define EPOLL_BATCH_SIZE 256
+#define READ_CHUNK_SIZE 4096
+#define SPECTATOR_IOV_COUNT 64 // Packets handed to one sendmsg()
+
+static_assert(SERVER_MAX_WORKERS <= (1 << (32 - SESSION_ID_WORKER_SHIFT)), "the worker index fits in a session id");
+
+/*
+A worker owns one epoll instance, one SO_REUSEPORT listening socket per port and the
+shard of sessions accepted on it. All sessions of a worker are stepped together once per
+frame and their output is flushed with one send() per session per frame. Spectators that
+subscribe to a session of another worker are handed to that worker through its mailbox.
+*/
+struct Worker
+{
+    int32_t index = 0;
+    int32_t epollFd = -1;
+    Connection playerListener = {CONNECTION_PLAYER_LISTENER, -1};
+    Connection spectatorListener = {CONNECTION_SPECTATOR_LISTENER, -1};
+    Connection mailbox = {CONNECTION_MAILBOX, -1}; // eventfd signalled when spectators are handed over
+    const ServerConfig *config = NULL;
+
+    ColdStore coldStore = {-1, NULL, 0, 0, std::vector<uint32_t>()}; // Idle games of the shard, fd -1 when disabled
+
+    uint32_t nextSessionId = 0;
+    std::unordered_map<uint32_t, Session *> sessions; // Sessions of the shard by id
+    std::unordered_set<Spectator *> spectators;       // Spectators registered with this worker
+    std::vector<Session *> writable;                  // Sessions with output produced this frame
+    std::vector<Spectator *> spectatorsWritable;      // Spectators with packets queued this frame
+
+    std::mutex mailboxMutex;
+    std::vector<Spectator *> mailboxSpectators; // Handed over by other workers, guarded by mailboxMutex
+
+    uint64_t nextFrameTime = 0; // Monotonic time of the next frame in nanoseconds
+    std::thread thread;
+};
+
+// Result of reading a spectator connection
+enum SpectatorRead
+{
+    SPECTATOR_READ_OPEN,
+    SPECTATOR_READ_CLOSED,
+    SPECTATOR_READ_HANDED_OVER // Now owned by another worker, must not be touched any more
+};
+
+static std::atomic<bool> serverRunning(false);
+static Worker *serverWorkers = NULL;
+static int32_t serverWorkerCount = 0;
+
+// Shared by every worker, games go over rarely enough for one lock
+static std::mutex leaderboardMutex;
+static Leaderboard serverLeaderboard = {-1, -1, NULL, 0, false};
+
+// Replays of finished games, written by a background thread so that no worker waits on the disk
+struct ReplayWriter
+{
+    std::mutex mutex;
+    std::condition_variable queued;
+    std::thread thread;
+    std::vector<std::pair<std::string, Replay *>> pending; // Path and replay of each game to be written
+    bool running;
+};
+
+static ReplayWriter replayWriter;
+
+// Function Prototypes
+inline uint64_t get_monotonic_time();
+static void run_replay_writer(ReplayWriter *writer);
+static void queue_replay(const std::string &path, Replay *replay);
+static int32_t open_listen_socket(uint16_t port);
+static void update_epoll_events(Worker *worker, Connection *connection, bool waitingWritable);
+static Session *create_session(Worker *worker, int32_t fd);
+static void destroy_session(Worker *worker, Session *session);
+static bool page_out_session(Worker *worker, Session *session);
+static bool page_in_session(Worker *worker, Session *session);
+static void destroy_spectator(Worker *worker, Spectator *spectator);
+static void close_connections(Worker *worker, std::vector<Connection *> *closed);
+static void accept_connections(Worker *worker, Connection *listener);
+static bool attach_spectator(Worker *worker, Spectator *spectator);
+static void drain_mailbox(Worker *worker);
+static bool read_session(Worker *worker, Session *session);
+static SpectatorRead read_spectator(Worker *worker, Spectator *spectator);
+static bool flush_session(Worker *worker, Session *session);
+static bool flush_spectator(Worker *worker, Spectator *spectator);
+static void publish_session(Worker *worker, Session *session);
+static void step_session(Worker *worker, Session *session);
+static void run_worker(Worker *worker, const ServerConfig *config);
+
+const uint64_t NANOSECONDS_PER_FRAME = static_cast<uint64_t>(TARGET_SECONDS_PER_FRAME * 1e9);
+
+/**
+ * @brief Gets the monotonic clock in nanoseconds
+ *
+ * @return uint64_t - current monotonic time
+ */
+inline uint64_t get_monotonic_time()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ull + static_cast<uint64_t>(now.tv_nsec);
+}
+
+/**
+ * @brief Fills the server configuration with its defaults
+ *
+ * @param config - pointer to ServerConfig to be filled
+ */
+void init_server_config(ServerConfig *config)
+{
+    config->port = DEFAULT_SERVER_PORT;
+    config->spectatorPort = DEFAULT_SPECTATOR_PORT;
+    config->workerCount = 4;
+    config->maxCatchUpFrames = 4;
+    config->coldStorePath = NULL;
+    config->idleFrames = 600;
+    config->pauseIdleGames = false;
+    config->leaderboardPath = NULL;
+    config->replayPath = NULL;
+    config->telemetryPath = NULL;
+}
+
+/**
+ * @brief Opens a non-blocking TCP socket listening on the port. SO_REUSEPORT lets every
+ * worker listen on the same port and the kernel spreads new connections across them.
+ *
+ * @param port - port to listen on
+ * @return int32_t - listening socket or -1 on error
+ */
+static int32_t open_listen_socket(uint16_t port)
+{
+    int32_t fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    int32_t enable = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+
+    if (bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || listen(fd, SOMAXCONN) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Arms or disarms EPOLLOUT for a client connection
+ *
+ * @param worker - worker owning the connection
+ * @param connection - connection to be updated
+ * @param waitingWritable - true to wait until the socket is writable again
+ */
+static void update_epoll_events(Worker *worker, Connection *connection, bool waitingWritable)
+{
+    epoll_event event = {};
+    event.events = EPOLLIN | EPOLLRDHUP | (waitingWritable ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+    event.data.ptr = connection;
+    epoll_ctl(worker->epollFd, EPOLL_CTL_MOD, connection->fd, &event);
+}
+
+/**
+ * @brief Creates a session for an accepted client and queues its WelcomeMessage. The game
+ * waits in GAME_PHASE_START until the client presses A, like the SDL window does.
+ *
+ * @param worker - worker owning the session
+ * @param fd - socket of the client
+ * @return Session* - the new session
+ */
+static Session *create_session(Worker *worker, int32_t fd)
+{
+    Session *session = new Session();
+    session->connection.kind = CONNECTION_PLAYER;
+    session->connection.fd = fd;
+    // The counter wraps after 2^24 sessions of the worker, skip the ids of the sessions still connected
+    const uint32_t counterMask = (1u << SESSION_ID_WORKER_SHIFT) - 1;
+    do
+    {
+        session->id = (static_cast<uint32_t>(worker->index) << SESSION_ID_WORKER_SHIFT) | (++worker->nextSessionId & counterMask);
+    } while ((session->id & counterMask) == 0 || worker->sessions.count(session->id) > 0);
+    session->hot = new HotGame();
+    uint32_t seed = static_cast<uint32_t>(get_monotonic_time()) ^ session->id;
+    init_replay_game(&session->hot->game, seed);
+    session->writeBuffer = new uint8_t[SESSION_MAX_PENDING_OUTPUT];
+    if (worker->config->replayPath)
+    {
+        session->replay = new Replay();
+        session->replay->randomState = session->hot->game.randomState;
+        session->replay->startLevel = session->hot->game.startLevel;
+        session->replay->heldKeys = 0;
+        session->replay->gameStartFrame = 0;
+    }
+
+    WelcomeMessage welcome = {};
+    welcome.type = MESSAGE_WELCOME;
+    welcome.sessionId = session->id;
+    memcpy(session->writeBuffer, &welcome, sizeof(welcome));
+    session->writeLength = sizeof(welcome);
+    return session;
+}
+
+/**
+ * @brief Closes the client socket and the spectators of the session and frees the session
+ *
+ * @param worker - worker owning the session
+ * @param session - session to be destroyed
+ */
+static void destroy_session(Worker *worker, Session *session)
+{
+    while (!session->spectators.empty())
+    {
+        destroy_spectator(worker, session->spectators.back());
+    }
+    if (session->hot == NULL)
+    {
+        free_cold_slot(&worker->coldStore, session->coldSlot, session->id);
+    }
+    epoll_ctl(worker->epollFd, EPOLL_CTL_DEL, session->connection.fd, NULL);
+    close(session->connection.fd);
+    worker->sessions.erase(session->id);
+    delete session->hot;
+    delete[] session->writeBuffer;
+    delete session->replay;
+    delete session;
+}
+
+/**
+ * @brief Moves the game of an idle session into the worker's ColdStore and frees its
+ * resident state. A paged out game is not simulated, so only games waiting for input
+ * (start and game over screens) are paged out unless pauseIdleGames is set.
+ *
+ * @param worker - worker owning the session
+ * @param session - session to be paged out
+ * @return true - game paged out
+ * @return false - game stays resident
+ */
+static bool page_out_session(Worker *worker, Session *session)
+{
+    GamePhase phase = session->hot->game.phase;
+    bool waiting = phase == GAME_PHASE_START || phase == GAME_PHASE_GAMEOVER;
+    if (worker->coldStore.fd < 0 || (!waiting && !worker->config->pauseIdleGames) ||
+        !session->spectators.empty() || session->writeLength > 0)
+    {
+        return false;
+    }
+
+    int64_t slot = page_out_game(&worker->coldStore, session->id, &session->hot->game);
+    if (slot < 0)
+    {
+        return false;
+    }
+    session->coldSlot = static_cast<uint32_t>(slot);
+    delete session->hot;
+    session->hot = NULL;
+    delete[] session->writeBuffer;
+    session->writeBuffer = NULL;
+    return true;
+}
+
+/**
+ * @brief Restores the game of a paged out session. The client gets the whole board again
+ * with the next frame.
+ *
+ * @param worker - worker owning the session
+ * @param session - session to be paged in
+ * @return true - game restored
+ * @return false - the cold slot was lost
+ */
+static bool page_in_session(Worker *worker, Session *session)
+{
+    HotGame *hot = new HotGame();
+    if (!page_in_game(&worker->coldStore, session->coldSlot, session->id, &hot->game))
+    {
+        delete hot;
+        return false;
+    }
+    session->hot = hot;
+    session->idleFrames = 0;
+    session->writeBuffer = new uint8_t[SESSION_MAX_PENDING_OUTPUT];
+    return true;
+}
+
+/**
+ * @brief Closes the spectator socket and detaches it from its session. The delta history of
+ * the session is freed along with its last spectator.
+ *
+ * @param worker - worker owning the spectator
+ * @param spectator - spectator to be destroyed
+ */
+static void destroy_spectator(Worker *worker, Spectator *spectator)
+{
+    Session *session = spectator->session;
+    if (session)
+    {
+        std::vector<Spectator *> *spectators = &session->spectators;
+        spectators->erase(std::find(spectators->begin(), spectators->end(), spectator));
+        if (spectators->empty())
+        {
+            delete session->history;
+            session->history = NULL;
+        }
+    }
+    epoll_ctl(worker->epollFd, EPOLL_CTL_DEL, spectator->connection.fd, NULL);
+    close(spectator->connection.fd);
+    worker->spectators.erase(spectator);
+    delete spectator;
+}
+
+/**
+ * @brief Destroys the connections that failed during a batch of events or a flush.
+ * A connection can fail more than once per batch and destroying a session also destroys its
+ * spectators, so duplicates are removed and spectators are destroyed first.
+ *
+ * @param worker - worker owning the connections
+ * @param closed - connections to be destroyed, cleared afterwards
+ */
+static void close_connections(Worker *worker, std::vector<Connection *> *closed)
+{
+    std::sort(closed->begin(), closed->end());
+    closed->erase(std::unique(closed->begin(), closed->end()), closed->end());
+    for (size_t i = 0; i < closed->size(); i++)
+    {
+        if ((*closed)[i]->kind == CONNECTION_SPECTATOR)
+        {
+            destroy_spectator(worker, reinterpret_cast<Spectator *>((*closed)[i]));
+        }
+    }
+    for (size_t i = 0; i < closed->size(); i++)
+    {
+        if ((*closed)[i]->kind == CONNECTION_PLAYER)
+        {
+            destroy_session(worker, reinterpret_cast<Session *>((*closed)[i]));
+        }
+    }
+    closed->clear();
+}
+
+/**
+ * @brief Accepts every pending connection on one of the worker's listening sockets
+ *
+ * @param worker - worker accepting the connections
+ * @param listener - player or spectator listener
+ */
+static void accept_connections(Worker *worker, Connection *listener)
+{
+    while (true)
+    {
+        int32_t fd = accept4(listener->fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            return;
+        }
+
+        int32_t enable = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+        Connection *connection;
+        if (listener->kind == CONNECTION_PLAYER_LISTENER)
+        {
+            Session *session = create_session(worker, fd);
+            worker->sessions[session->id] = session;
+            connection = &session->connection;
+        }
+        else
+        {
+            Spectator *spectator = new Spectator();
+            spectator->connection.kind = CONNECTION_SPECTATOR;
+            spectator->connection.fd = fd;
+            worker->spectators.insert(spectator);
+            connection = &spectator->connection;
+        }
+
+        epoll_event event = {};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.ptr = connection;
+        epoll_ctl(worker->epollFd, EPOLL_CTL_ADD, fd, &event);
+    }
+}
+
+/**
+ * @brief Attaches a spectator to the session it subscribed to. The session must belong to this worker.
+ *
+ * @param worker - worker owning the session
+ * @param spectator - spectator to be attached
+ * @return true - spectator attached
+ * @return false - the session does not exist (any more)
+ */
+static bool attach_spectator(Worker *worker, Spectator *spectator)
+{
+    std::unordered_map<uint32_t, Session *>::iterator it = worker->sessions.find(spectator->sessionId);
+    if (it == worker->sessions.end())
+    {
+        return false;
+    }
+
+    Session *session = it->second;
+    if (session->hot == NULL && !page_in_session(worker, session))
+    {
+        return false;
+    }
+    if (session->history == NULL)
+    {
+        session->history = new SpectatorHistory();
+    }
+    session->spectators.push_back(spectator);
+    spectator->session = session;
+    return true;
+}
+
+/**
+ * @brief Registers the spectators other workers handed over to this worker
+ *
+ * @param worker - worker whose mailbox is drained
+ */
+static void drain_mailbox(Worker *worker)
+{
+    uint64_t signals;
+    while (read(worker->mailbox.fd, &signals, sizeof(signals)) > 0)
+    {
+    }
+
+    std::vector<Spectator *> arrived;
+    {
+        std::lock_guard<std::mutex> lock(worker->mailboxMutex);
+        arrived.swap(worker->mailboxSpectators);
+    }
+
+    for (size_t i = 0; i < arrived.size(); i++)
+    {
+        Spectator *spectator = arrived[i];
+        epoll_event event = {};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.ptr = &spectator->connection;
+        epoll_ctl(worker->epollFd, EPOLL_CTL_ADD, spectator->connection.fd, &event);
+        worker->spectators.insert(spectator);
+        if (!attach_spectator(worker, spectator))
+        {
+            destroy_spectator(worker, spectator);
+        }
+    }
+}
+
+/**
+ * @brief Reads every pending InputMessage of a session into its input queue. When the
+ * queue is full the oldest client frame is dropped. Input for a paged out game pages it in.
+ *
+ * @param worker - worker owning the session
+ * @param session - session to read from
+ * @return true - connection is still open
+ * @return false - connection was closed or a protocol error occurred
+ */
+static bool read_session(Worker *worker, Session *session)
+{
+    uint8_t buffer[READ_CHUNK_SIZE];
+    while (true)
+    {
+        // A message split across two reads is completed from the byte kept in the session
+        ssize_t partial = session->readLength;
+        memcpy(buffer, session->readBuffer, partial);
+
+        ssize_t length = recv(session->connection.fd, buffer + partial, sizeof(buffer) - partial, 0);
+        if (length == 0)
+        {
+            return false;
+        }
+        if (length < 0)
+        {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        length += partial;
+
+        session->readLength = static_cast<uint32_t>(length % sizeof(InputMessage));
+        length -= session->readLength;
+        memcpy(session->readBuffer, buffer + length, session->readLength);
+
+        for (ssize_t offset = 0; offset < length; offset += sizeof(InputMessage))
+        {
+            const InputMessage *message = reinterpret_cast<const InputMessage *>(buffer + offset);
+            if (message->type != MESSAGE_INPUT)
+            {
+                return false;
+            }
+            if (session->inputTail - session->inputHead == SESSION_INPUT_QUEUE_SIZE)
+            {
+                session->inputHead++;
+            }
+            session->inputQueue[session->inputTail++ % SESSION_INPUT_QUEUE_SIZE] = message->keys;
+        }
+
+        if (session->hot == NULL && length > 0 && !page_in_session(worker, session))
+        {
+            return false;
+        }
+    }
+}
+
+/**
+ * @brief Reads the SubscribeMessage and AckMessages of a spectator. A subscription to a
+ * session of another worker hands the spectator over to that worker.
+ *
+ * @param worker - worker the spectator is registered with
+ * @param spectator - spectator to read from
+ * @return SpectatorRead - whether the spectator is still open, closed or handed over
+ */
+static SpectatorRead read_spectator(Worker *worker, Spectator *spectator)
+{
+    static_assert(sizeof(SubscribeMessage) == sizeof(AckMessage), "spectator messages share one size");
+    uint8_t buffer[READ_CHUNK_SIZE];
+    bool subscribed = false;
+
+    // The socket is left alone once a subscription arrived since it may change owner
+    while (!subscribed)
+    {
+        ssize_t partial = spectator->readLength;
+        memcpy(buffer, spectator->readBuffer, partial);
+
+        ssize_t length = recv(spectator->connection.fd, buffer + partial, sizeof(buffer) - partial, 0);
+        if (length == 0)
+        {
+            return SPECTATOR_READ_CLOSED;
+        }
+        if (length < 0)
+        {
+            return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? SPECTATOR_READ_OPEN : SPECTATOR_READ_CLOSED;
+        }
+        length += partial;
+
+        spectator->readLength = static_cast<uint32_t>(length % sizeof(AckMessage));
+        length -= spectator->readLength;
+        memcpy(spectator->readBuffer, buffer + length, spectator->readLength);
+
+        for (ssize_t offset = 0; offset < length; offset += sizeof(AckMessage))
+        {
+            uint32_t value;
+            memcpy(&value, buffer + offset + 1, sizeof(value));
+            if (buffer[offset] == MESSAGE_ACK)
+            {
+                // Acks only move forward, a stale ack would just force a larger delta
+                if (value > spectator->ackedFrame)
+                {
+                    spectator->ackedFrame = value;
+                }
+            }
+            else if (buffer[offset] == MESSAGE_SUBSCRIBE && spectator->session == NULL && !subscribed)
+            {
+                spectator->sessionId = value;
+                subscribed = true;
+            }
+            else
+            {
+                return SPECTATOR_READ_CLOSED;
+            }
+        }
+    }
+
+    int32_t owner = static_cast<int32_t>(spectator->sessionId >> SESSION_ID_WORKER_SHIFT);
+    if (owner == worker->index)
+    {
+        return attach_spectator(worker, spectator) ? SPECTATOR_READ_OPEN : SPECTATOR_READ_CLOSED;
+    }
+    if (owner >= serverWorkerCount)
+    {
+        return SPECTATOR_READ_CLOSED;
+    }
+
+    epoll_ctl(worker->epollFd, EPOLL_CTL_DEL, spectator->connection.fd, NULL);
+    worker->spectators.erase(spectator);
+
+    Worker *target = &serverWorkers[owner];
+    {
+        std::lock_guard<std::mutex> lock(target->mailboxMutex);
+        target->mailboxSpectators.push_back(spectator);
+    }
+    uint64_t signal = 1;
+    ssize_t written = write(target->mailbox.fd, &signal, sizeof(signal));
+    (void)written;
+    return SPECTATOR_READ_HANDED_OVER;
+}
+
+/**
+ * @brief Sends the output batched for a session. Whatever the socket does not accept
+ * stays buffered and EPOLLOUT is armed until it drains.
+ *
+ * @param worker - worker owning the session
+ * @param session - session to be flushed
+ * @return true - connection is still open
+ * @return false - connection failed
+ */
+static bool flush_session(Worker *worker, Session *session)
+{
+    while (session->writeOffset < session->writeLength)
+    {
+        ssize_t sent = send(session->connection.fd, session->writeBuffer + session->writeOffset,
+                            session->writeLength - session->writeOffset, MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                return false;
+            }
+            break;
+        }
+        session->writeOffset += static_cast<uint32_t>(sent);
+    }
+
+    bool pending = session->writeOffset < session->writeLength;
+    if (!pending)
+    {
+        session->writeOffset = session->writeLength = 0;
+    }
+    if (pending != session->waitingWritable)
+    {
+        update_epoll_events(worker, &session->connection, pending);
+        session->waitingWritable = pending;
+    }
+    return true;
+}
+
+/**
+ * @brief Sends the queued packets of a spectator straight from the shared packet buffers
+ * with one sendmsg() per batch, without copying them into a per-connection buffer
+ *
+ * @param worker - worker owning the spectator
+ * @param spectator - spectator to be flushed
+ * @return true - connection is still open
+ * @return false - connection failed
+ */
+static bool flush_spectator(Worker *worker, Spectator *spectator)
+{
+    while (!spectator->queue.empty())
+    {
+        iovec vectors[SPECTATOR_IOV_COUNT];
+        int32_t count = 0;
+        for (std::deque<SpectatorPacketRef>::iterator it = spectator->queue.begin(); it != spectator->queue.end() && count < SPECTATOR_IOV_COUNT; ++it)
+        {
+            uint32_t offset = count == 0 ? spectator->queueOffset : 0;
+            vectors[count].iov_base = const_cast<uint8_t *>((*it)->bytes.data()) + offset;
+            vectors[count].iov_len = (*it)->bytes.size() - offset;
+            count++;
+        }
+
+        msghdr message = {};
+        message.msg_iov = vectors;
+        message.msg_iovlen = count;
+        ssize_t sent = sendmsg(spectator->connection.fd, &message, MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                return false;
+            }
+            break;
+        }
+
+        // Release the packets that went out completely
+        size_t remaining = static_cast<size_t>(sent);
+        while (remaining > 0)
+        {
+            size_t left = spectator->queue.front()->bytes.size() - spectator->queueOffset;
+            if (remaining < left)
+            {
+                spectator->queueOffset += static_cast<uint32_t>(remaining);
+                break;
+            }
+            remaining -= left;
+            spectator->queue.pop_front();
+            spectator->queueOffset = 0;
+        }
+    }
+
+    bool pending = !spectator->queue.empty();
+    if (pending != spectator->waitingWritable)
+    {
+        update_epoll_events(worker, &spectator->connection, pending);
+        spectator->waitingWritable = pending;
+    }
+    return true;
+}
+
+/**
+ * @brief Encodes the current frame of a session for its spectators. Spectators that
+ * acknowledged the same base frame share one encoded packet.
+ *
+ * @param worker - worker owning the session
+ * @param session - session to be published
+ */
+static void publish_session(Worker *worker, Session *session)
+{
+    record_history_board(session->history, session->frame, session->hot->game.board);
+
+    // There are only a few distinct base frames per game, a linear search beats a map
+    std::vector<std::pair<uint32_t, SpectatorPacketRef> > encoded;
+    for (size_t i = 0; i < session->spectators.size(); i++)
+    {
+        Spectator *spectator = session->spectators[i];
+
+        // A packet only depends on the acknowledged frame, so skipping frames is harmless
+        if (spectator->queue.size() >= SPECTATOR_MAX_QUEUED_PACKETS)
+        {
+            continue;
+        }
+
+        SpectatorPacketRef packet;
+        for (size_t j = 0; j < encoded.size() && !packet; j++)
+        {
+            if (encoded[j].first == spectator->ackedFrame)
+            {
+                packet = encoded[j].second;
+            }
+        }
+        if (!packet)
+        {
+            packet = encode_spectator_packet(session->history, session->id, session->frame, spectator->ackedFrame, &session->hot->game);
+            encoded.push_back(std::make_pair(spectator->ackedFrame, packet));
+        }
+
+        if (spectator->queue.empty())
+        {
+            worker->spectatorsWritable.push_back(spectator);
+        }
+        spectator->queue.push_back(packet);
+    }
+}
+
+/**
+ * @brief Simulates one frame of a session with the next queued client input and appends
+ * the resulting StateMessage to its output. The board is only sent when it changed.
+ * Paged out games are skipped and games idle for too long are paged out.
+ *
+ * @param worker - worker owning the session
+ * @param session - session to be stepped
+ */
+static void step_session(Worker *worker, Session *session)
+{
+    if (session->hot == NULL)
+    {
+        return;
+    }
+
+    // Without new client input the held keys stay the same and the deltas become zero
+    uint8_t keys = pack_input_keys(&session->input);
+    if (session->inputHead != session->inputTail)
+    {
+        keys = session->inputQueue[session->inputHead++ % SESSION_INPUT_QUEUE_SIZE];
+        session->idleFrames = 0;
+    }
+    else if (++session->idleFrames >= worker->config->idleFrames && page_out_session(worker, session))
+    {
+        return;
+    }
+    apply_input_keys(&session->input, keys);
+    if (session->replay)
+    {
+        session->replay->keys.push_back(keys);
+    }
+
+    HotGame *hot = session->hot;
+    GamePhase prevPhase = hot->game.phase;
+    session->frame++;
+    hot->game.frame = session->frame;
+    update_game(&hot->game, &session->input);
+
+    if (hot->game.phase == GAME_PHASE_GAMEOVER && prevPhase != GAME_PHASE_GAMEOVER && serverLeaderboard.nodes)
+    {
+        LeaderboardEntry entry = make_leaderboard_entry(&hot->game, session->id);
+        std::lock_guard<std::mutex> lock(leaderboardMutex);
+        record_score(&serverLeaderboard, &entry);
+    }
+
+    // Each replay holds one game, from its start screen to its game over
+    if (session->replay && prevPhase == GAME_PHASE_START && hot->game.phase == GAME_PHASE_PLAY)
+    {
+        session->replay->gameStartFrame = static_cast<uint32_t>(session->replay->keys.size());
+    }
+    else if (session->replay && prevPhase != GAME_PHASE_GAMEOVER && hot->game.phase == GAME_PHASE_GAMEOVER)
+    {
+        std::string path = std::string(worker->config->replayPath) + "/" + to_string(session->id) + "-" + to_string(session->frame) + ".replay";
+        queue_replay(path, session->replay);
+    }
+    else if (session->replay && prevPhase == GAME_PHASE_GAMEOVER && hot->game.phase == GAME_PHASE_START)
+    {
+        session->replay->randomState = hot->game.randomState;
+        session->replay->startLevel = hot->game.startLevel;
+        session->replay->heldKeys = keys;
+        session->replay->gameStartFrame = 0;
+        session->replay->keys.clear();
+    }
+
+    if (!session->spectators.empty())
+    {
+        publish_session(worker, session);
+    }
+
+    const GameState *game = &hot->game;
+    bool boardChanged = !hot->boardSent || memcmp(hot->sentBoard, game->board, sizeof(game->board)) != 0;
+    uint32_t length = sizeof(StateMessage) + (boardChanged ? sizeof(game->board) : 0);
+
+    // Slow client whose socket buffer stays full: skip its state messages until it catches up
+    if (session->writeLength + length > SESSION_MAX_PENDING_OUTPUT)
+    {
+        return;
+    }
+
+    StateMessage message = {};
+    message.type = MESSAGE_STATE;
+    message.phase = static_cast<uint8_t>(game->phase);
+    message.tetrominoIndex = game->piece.tetrominoIndex;
+    message.rotation = static_cast<uint8_t>(game->piece.rotation);
+    message.offsetRow = static_cast<int8_t>(game->piece.offsetRow);
+    message.offsetCol = static_cast<int8_t>(game->piece.offsetCol);
+    message.boardIncluded = boardChanged;
+    message.frame = session->frame;
+    message.level = game->level;
+    message.lineCount = game->lineCount;
+    message.score = game->score;
+
+    // The welcome message of a new session is already waiting in the buffer
+    if (session->writeLength == 0 || session->frame == 1)
+    {
+        worker->writable.push_back(session);
+    }
+    memcpy(session->writeBuffer + session->writeLength, &message, sizeof(message));
+    session->writeLength += sizeof(message);
+    if (boardChanged)
+    {
+        memcpy(session->writeBuffer + session->writeLength, game->board, sizeof(game->board));
+        session->writeLength += sizeof(game->board);
+        memcpy(hot->sentBoard, game->board, sizeof(game->board));
+        hot->boardSent = true;
+    }
+}
+
+/**
+ * @brief Event loop of a worker. Waits for socket events until the next frame is due,
+ * then steps every session of the shard and flushes the batched output.
+ *
+ * @param worker - worker to run
+ * @param config - pointer to ServerConfig of the server
+ */
+static void run_worker(Worker *worker, const ServerConfig *config)
+{
+    epoll_event events[EPOLL_BATCH_SIZE];
+    std::vector<Connection *> closed;
+    worker->nextFrameTime = get_monotonic_time() + NANOSECONDS_PER_FRAME;
+
+    while (serverRunning.load(std::memory_order_relaxed))
+    {
+        uint64_t now = get_monotonic_time();
+        // Rounded up, a timeout of 0 in the last millisecond before the frame would spin until it is due
+        int32_t timeout = now >= worker->nextFrameTime ? 0 : static_cast<int32_t>((worker->nextFrameTime - now + 999999) / 1000000);
+        int32_t count = epoll_wait(worker->epollFd, events, EPOLL_BATCH_SIZE, timeout);
+
+        for (int32_t i = 0; i < count; i++)
+        {
+            Connection *connection = static_cast<Connection *>(events[i].data.ptr);
+            bool open = !(events[i].events & (EPOLLERR | EPOLLHUP));
+            switch (connection->kind)
+            {
+            case CONNECTION_PLAYER_LISTENER:
+            case CONNECTION_SPECTATOR_LISTENER:
+                accept_connections(worker, connection);
+                continue;
+            case CONNECTION_MAILBOX:
+                drain_mailbox(worker);
+                continue;
+            case CONNECTION_PLAYER:
+            {
+                Session *session = reinterpret_cast<Session *>(connection);
+                if (open && (events[i].events & EPOLLIN))
+                {
+                    open = read_session(worker, session);
+                }
+                if (open && (events[i].events & EPOLLOUT))
+                {
+                    open = flush_session(worker, session);
+                }
+                break;
+            }
+            case CONNECTION_SPECTATOR:
+            {
+                Spectator *spectator = reinterpret_cast<Spectator *>(connection);
+                if (open && (events[i].events & EPOLLIN))
+                {
+                    SpectatorRead result = read_spectator(worker, spectator);
+                    if (result == SPECTATOR_READ_HANDED_OVER)
+                    {
+                        continue;
+                    }
+                    open = result == SPECTATOR_READ_OPEN;
+                }
+                if (open && (events[i].events & EPOLLOUT))
+                {
+                    open = flush_spectator(worker, spectator);
+                }
+                break;
+            }
+            }
+            if (!open)
+            {
+                closed.push_back(connection);
+            }
+        }
+        close_connections(worker, &closed);
+
+        now = get_monotonic_time();
+        if (now < worker->nextFrameTime)
+        {
+            continue;
+        }
+
+        // Simulate the frames that are due, skipping ahead when the worker fell too far behind
+        int32_t frames = 0;
+        while (now >= worker->nextFrameTime && frames < config->maxCatchUpFrames)
+        {
+            for (std::unordered_map<uint32_t, Session *>::iterator it = worker->sessions.begin(); it != worker->sessions.end(); ++it)
+            {
+                step_session(worker, it->second);
+            }
+            worker->nextFrameTime += NANOSECONDS_PER_FRAME;
+            frames++;
+        }
+        if (now >= worker->nextFrameTime)
+        {
+            worker->nextFrameTime = now + NANOSECONDS_PER_FRAME;
+        }
+
+        for (size_t i = 0; i < worker->writable.size(); i++)
+        {
+            if (!flush_session(worker, worker->writable[i]))
+            {
+                closed.push_back(&worker->writable[i]->connection);
+            }
+        }
+        worker->writable.clear();
+
+        for (size_t i = 0; i < worker->spectatorsWritable.size(); i++)
+        {
+            if (!flush_spectator(worker, worker->spectatorsWritable[i]))
+            {
+                closed.push_back(&worker->spectatorsWritable[i]->connection);
+            }
+        }
+        worker->spectatorsWritable.clear();
+        close_connections(worker, &closed);
+    }
+}
+
+/**
+ * @brief Replay writer thread. Writes the queued replays until stopped with an empty queue.
+ *
+ * @param writer - pointer to the writer
+ */
+static void run_replay_writer(ReplayWriter *writer)
+{
+    std::unique_lock<std::mutex> lock(writer->mutex);
+    while (writer->running || !writer->pending.empty())
+    {
+        if (writer->pending.empty())
+        {
+            writer->queued.wait(lock);
+            continue;
+        }
+        std::vector<std::pair<std::string, Replay *>> batch;
+        batch.swap(writer->pending);
+        lock.unlock();
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            write_replay(batch[i].first.c_str(), batch[i].second);
+            delete batch[i].second;
+        }
+        lock.lock();
+    }
+}
+
+/**
+ * @brief Hands the replay of a finished game to the replay writer
+ *
+ * @param path - path of the file to be written
+ * @param replay - pointer to the replay, still owned by the caller, its keys are moved out
+ */
+static void queue_replay(const std::string &path, Replay *replay)
+{
+    Replay *copy = new Replay();
+    copy->randomState = replay->randomState;
+    copy->startLevel = replay->startLevel;
+    copy->heldKeys = replay->heldKeys;
+    copy->gameStartFrame = replay->gameStartFrame;
+    copy->keys.swap(replay->keys);
+    {
+        std::lock_guard<std::mutex> lock(replayWriter.mutex);
+        replayWriter.pending.push_back(std::make_pair(path, copy));
+    }
+    replayWriter.queued.notify_one();
+}
+
+/**
+ * @brief Runs the server until stop_server() is called
+ *
+ * @param config - pointer to ServerConfig of the server
+ * @return int32_t - 0 on a clean shutdown, 1 if the workers could not be set up
+ */
+int32_t run_server(const ServerConfig *config)
+{
+    int32_t workerCount = config->workerCount;
+    if (workerCount < 1 || workerCount > SERVER_MAX_WORKERS)
+    {
+        return 1;
+    }
+
+    if (config->leaderboardPath && !open_leaderboard(&serverLeaderboard, config->leaderboardPath, false))
+    {
+        return 1;
+    }
+    if (config->telemetryPath && !start_telemetry_export(config->telemetryPath, TELEMETRY_EXPORT_SECONDS))
+    {
+        close_leaderboard(&serverLeaderboard);
+        return 1;
+    }
+
+    if (config->replayPath)
+    {
+        replayWriter.running = true;
+        replayWriter.thread = std::thread(run_replay_writer, &replayWriter);
+    }
+
+    Worker *workers = new Worker[workerCount];
+    int32_t ready = 0;
+    for (; ready < workerCount; ready++)
+    {
+        Worker *worker = &workers[ready];
+        worker->index = ready;
+        worker->config = config;
+        worker->playerListener.fd = open_listen_socket(config->port);
+        worker->spectatorListener.fd = open_listen_socket(config->spectatorPort);
+        worker->mailbox.fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        worker->epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (worker->playerListener.fd < 0 || worker->spectatorListener.fd < 0 || worker->mailbox.fd < 0 || worker->epollFd < 0)
+        {
+            break;
+        }
+        if (config->coldStorePath)
+        {
+            std::string path = std::string(config->coldStorePath) + "." + to_string(ready);
+            if (!open_cold_store(&worker->coldStore, path.c_str()))
+            {
+                break;
+            }
+        }
+
+        Connection *registered[] = {&worker->playerListener, &worker->spectatorListener, &worker->mailbox};
+        for (uint32_t i = 0; i < ARRAY_COUNT(registered); i++)
+        {
+            epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.ptr = registered[i];
+            epoll_ctl(worker->epollFd, EPOLL_CTL_ADD, registered[i]->fd, &event);
+        }
+    }
+
+    int32_t result = 0;
+    if (ready == workerCount)
+    {
+        serverWorkers = workers;
+        serverWorkerCount = workerCount;
+        serverRunning.store(true);
+        for (int32_t i = 0; i < workerCount; i++)
+        {
+            workers[i].thread = std::thread(run_worker, &workers[i], config);
+        }
+        for (int32_t i = 0; i < workerCount; i++)
+        {
+            workers[i].thread.join();
+        }
+    }
+    else
+    {
+        result = 1;
+    }
+
+    for (int32_t i = 0; i < workerCount; i++)
+    {
+        Worker *worker = &workers[i];
+        if (worker->mailbox.fd >= 0)
+        {
+            drain_mailbox(worker);
+        }
+        while (!worker->sessions.empty())
+        {
+            destroy_session(worker, worker->sessions.begin()->second);
+        }
+        while (!worker->spectators.empty())
+        {
+            destroy_spectator(worker, *worker->spectators.begin());
+        }
+
+        close_cold_store(&worker->coldStore);
+
+        int32_t fds[] = {worker->playerListener.fd, worker->spectatorListener.fd, worker->mailbox.fd, worker->epollFd};
+        for (uint32_t j = 0; j < ARRAY_COUNT(fds); j++)
+        {
+            if (fds[j] >= 0)
+            {
+                close(fds[j]);
+            }
+        }
+    }
+    serverWorkers = NULL;
+    serverWorkerCount = 0;
+    delete[] workers;
+    close_leaderboard(&serverLeaderboard);
+    stop_telemetry_export();
+    if (config->replayPath)
+    {
+        // Games that went over before the shutdown are still written
+        {
+            std::lock_guard<std::mutex> lock(replayWriter.mutex);
+            replayWriter.running = false;
+        }
+        replayWriter.queued.notify_one();
+        replayWriter.thread.join();
+    }
+    return result;
+}
+
+/**
+ * @brief Asks the workers to stop. Safe to call from a signal handler.
+ */
+void stop_server()
+{
+    serverRunning.store(false);
+}
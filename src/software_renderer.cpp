@@ -0,0 +1,147 @@
+#include "../inc/software_renderer.h"
+
+const int32_t FONT_ADVANCE = (FONT_GLYPH_WIDTH + 1) * FONT_SCALE;
+
+// Function Prototypes
+static void fill_pixels(Framebuffer *framebuffer, int32_t x, int32_t y, int32_t width, int32_t height, Color color);
+static void draw_text(Framebuffer *framebuffer, const DrawCommand *command);
+
+/**
+ * @brief Allocates a framebuffer
+ *
+ * @param framebuffer - pointer to Framebuffer to be allocated
+ * @param width - width in pixels
+ * @param height - height in pixels
+ */
+void init_framebuffer(Framebuffer *framebuffer, int32_t width, int32_t height)
+{
+    framebuffer->width = width;
+    framebuffer->height = height;
+    framebuffer->pixels.assign(static_cast<size_t>(width) * height * 3, 0);
+}
+
+/**
+ * @brief Fills a rectangle clipped to the framebuffer. Like the SDL renderer without
+ * blending, the alpha of the color is ignored.
+ *
+ * @param framebuffer - pointer to Framebuffer to draw into
+ * @param x - x coordinate of the rectangle
+ * @param y - y coordinate of the rectangle
+ * @param width - width of the rectangle
+ * @param height - height of the rectangle
+ * @param color - fill color
+ */
+static void fill_pixels(Framebuffer *framebuffer, int32_t x, int32_t y, int32_t width, int32_t height, Color color)
+{
+    int32_t left = x < 0 ? 0 : x;
+    int32_t top = y < 0 ? 0 : y;
+    int32_t right = x + width > framebuffer->width ? framebuffer->width : x + width;
+    int32_t bottom = y + height > framebuffer->height ? framebuffer->height : y + height;
+    if (left >= right || top >= bottom)
+    {
+        return;
+    }
+
+    // Fill the first row, then copy it to the others
+    uint8_t *first = &framebuffer->pixels[(static_cast<size_t>(top) * framebuffer->width + left) * 3];
+    for (int32_t col = 0; col < right - left; col++)
+    {
+        first[col * 3 + 0] = color.r;
+        first[col * 3 + 1] = color.g;
+        first[col * 3 + 2] = color.b;
+    }
+    size_t rowBytes = static_cast<size_t>(right - left) * 3;
+    size_t stride = static_cast<size_t>(framebuffer->width) * 3;
+    for (int32_t row = 1; row < bottom - top; row++)
+    {
+        memcpy(first + row * stride, first, rowBytes);
+    }
+}
+
+/**
+ * @brief Draws a text command with the built-in font
+ *
+ * @param framebuffer - pointer to Framebuffer to draw into
+ * @param command - DRAW_TEXT command
+ */
+static void draw_text(Framebuffer *framebuffer, const DrawCommand *command)
+{
+    int32_t length = static_cast<int32_t>(strlen(command->text));
+    int32_t width = length * FONT_ADVANCE - FONT_SCALE;
+    int32_t x = command->x;
+    if (command->alignment == TEXT_ALIGN_CENTER)
+    {
+        x -= width / 2;
+    }
+    else if (command->alignment == TEXT_ALIGN_RIGHT)
+    {
+        x -= width;
+    }
+
+    for (int32_t i = 0; i < length; i++, x += FONT_ADVANCE)
+    {
+        const Glyph *glyph = find_glyph(command->text[i]);
+        if (glyph == NULL)
+        {
+            continue;
+        }
+        for (int32_t row = 0; row < FONT_GLYPH_HEIGHT; row++)
+        {
+            for (int32_t col = 0; col < FONT_GLYPH_WIDTH; col++)
+            {
+                if (glyph->rows[row] & (0x10 >> col))
+                {
+                    fill_pixels(framebuffer, x + col * FONT_SCALE, command->y + row * FONT_SCALE, FONT_SCALE, FONT_SCALE, command->color);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Clears the framebuffer to black and executes a draw list on it
+ *
+ * @param framebuffer - pointer to Framebuffer to draw into
+ * @param commands - draw list built by build_draw_list()
+ */
+void rasterize_draw_list(Framebuffer *framebuffer, const std::vector<DrawCommand> *commands)
+{
+    memset(framebuffer->pixels.data(), 0, framebuffer->pixels.size());
+    for (size_t i = 0; i < commands->size(); i++)
+    {
+        const DrawCommand *command = &(*commands)[i];
+        switch (command->kind)
+        {
+        case DRAW_FILL_RECT:
+            fill_pixels(framebuffer, command->x, command->y, command->width, command->height, command->color);
+            break;
+        case DRAW_OUTLINE_RECT:
+            fill_pixels(framebuffer, command->x, command->y, command->width, 1, command->color);
+            fill_pixels(framebuffer, command->x, command->y + command->height - 1, command->width, 1, command->color);
+            fill_pixels(framebuffer, command->x, command->y, 1, command->height, command->color);
+            fill_pixels(framebuffer, command->x + command->width - 1, command->y, 1, command->height, command->color);
+            break;
+        case DRAW_TEXT:
+            draw_text(framebuffer, command);
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Writes the pixels of a framebuffer, as a binary PPM image or as one raw RGB24 video frame
+ *
+ * @param file - file or pipe to write to
+ * @param framebuffer - pointer to Framebuffer to be written
+ * @param ppmHeader - true to write a PPM header before the pixels
+ * @return true - frame written
+ * @return false - the write failed
+ */
+bool write_framebuffer(FILE *file, const Framebuffer *framebuffer, bool ppmHeader)
+{
+    if (ppmHeader && fprintf(file, "P6\n%d %d\n255\n", framebuffer->width, framebuffer->height) < 0)
+    {
+        return false;
+    }
+    return fwrite(framebuffer->pixels.data(), 1, framebuffer->pixels.size(), file) == framebuffer->pixels.size();
+}
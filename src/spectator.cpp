@@ -0,0 +1,173 @@
+#include "../inc/spectator.h"
+
+/**
+ * @brief Gets the board of a frame from the history
+ *
+ * @param history - pointer to SpectatorHistory holding the recent boards
+ * @param frame - frame to look up
+ * @return const uint8_t* - board of the frame or NULL if the frame is no longer (or never was) in the history
+ */
+const uint8_t *get_history_board(const SpectatorHistory *history, uint32_t frame)
+{
+    uint32_t slot = frame % SPECTATOR_HISTORY_SIZE;
+    if (frame == 0 || history->frames[slot] != frame)
+    {
+        return NULL;
+    }
+    return history->boards[slot];
+}
+
+/**
+ * @brief Stores the board of a frame in the history, replacing the frame SPECTATOR_HISTORY_SIZE frames older
+ *
+ * @param history - pointer to SpectatorHistory holding the recent boards
+ * @param frame - frame of the board
+ * @param board - board to be stored
+ */
+void record_history_board(SpectatorHistory *history, uint32_t frame, const uint8_t *board)
+{
+    uint32_t slot = frame % SPECTATOR_HISTORY_SIZE;
+    history->frames[slot] = frame;
+    memcpy(history->boards[slot], board, SPECTATOR_BOARD_SIZE);
+}
+
+/**
+ * @brief Encodes the state of a game as a delta against a base frame. Only the board rows
+ * that differ from the base are included. When the base is not in the history (or is 0)
+ * a keyframe with every row is encoded instead.
+ *
+ * @param history - pointer to SpectatorHistory holding the boards of the recent frames
+ * @param sessionId - id of the session the game belongs to
+ * @param frame - frame of the game state
+ * @param baseFrame - frame the spectator acknowledged last
+ * @param game - pointer to GameState to be encoded
+ * @return SpectatorPacketRef - encoded packet
+ */
+SpectatorPacketRef encode_spectator_packet(const SpectatorHistory *history, uint32_t sessionId, uint32_t frame, uint32_t baseFrame, const GameState *game)
+{
+    const int32_t width = GameState::BOARD_WIDTH;
+    const uint8_t *base = get_history_board(history, baseFrame);
+    if (base == NULL)
+    {
+        baseFrame = 0;
+    }
+
+    uint32_t changedRows = 0;
+    int32_t changedCount = 0;
+    for (int32_t row = 0; row < GameState::BOARD_HEIGHT; row++)
+    {
+        if (base == NULL || memcmp(base + row * width, game->board + row * width, width) != 0)
+        {
+            changedRows |= 1u << row;
+            changedCount++;
+        }
+    }
+
+    SpectateHeader header = {};
+    header.type = MESSAGE_SPECTATE;
+    header.phase = static_cast<uint8_t>(game->phase);
+    header.tetrominoIndex = game->piece.tetrominoIndex;
+    header.rotation = static_cast<uint8_t>(game->piece.rotation);
+    header.offsetRow = static_cast<int8_t>(game->piece.offsetRow);
+    header.offsetCol = static_cast<int8_t>(game->piece.offsetCol);
+    header.length = static_cast<uint16_t>(sizeof(header) + changedCount * width);
+    header.sessionId = sessionId;
+    header.frame = frame;
+    header.baseFrame = baseFrame;
+    header.changedRows = changedRows;
+    header.level = game->level;
+    header.lineCount = game->lineCount;
+    header.score = game->score;
+
+    SpectatorPacket *packet = new SpectatorPacket();
+    packet->bytes.resize(header.length);
+    uint8_t *out = packet->bytes.data();
+    memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    for (int32_t row = 0; row < GameState::BOARD_HEIGHT; row++)
+    {
+        if (changedRows & (1u << row))
+        {
+            memcpy(out, game->board + row * width, width);
+            out += width;
+        }
+    }
+    return SpectatorPacketRef(packet);
+}
+
+/**
+ * @brief Decodes one packet into the spectator's view of the game. The view keeps the
+ * decoded boards in its history so that later deltas can be applied to their base.
+ *
+ * @param view - pointer to SpectatorView holding the reconstructed game
+ * @param bytes - received bytes starting at a SpectateHeader
+ * @param length - number of received bytes
+ * @return int32_t - bytes consumed, 0 if the packet is incomplete, -1 if the packet is malformed or its base frame is unknown
+ */
+int32_t decode_spectator_packet(SpectatorView *view, const uint8_t *bytes, uint32_t length)
+{
+    const int32_t width = GameState::BOARD_WIDTH;
+    if (length < sizeof(SpectateHeader))
+    {
+        return 0;
+    }
+
+    SpectateHeader header;
+    memcpy(&header, bytes, sizeof(header));
+    if (header.type != MESSAGE_SPECTATE || header.length < sizeof(header))
+    {
+        return -1;
+    }
+    if (length < header.length)
+    {
+        return 0;
+    }
+
+    uint8_t board[SPECTATOR_BOARD_SIZE];
+    if (header.baseFrame)
+    {
+        const uint8_t *base = get_history_board(&view->history, header.baseFrame);
+        if (base == NULL)
+        {
+            return -1;
+        }
+        memcpy(board, base, sizeof(board));
+    }
+    else
+    {
+        memset(board, 0, sizeof(board));
+    }
+
+    const uint8_t *rows = bytes + sizeof(header);
+    const uint8_t *end = bytes + header.length;
+    for (int32_t row = 0; row < GameState::BOARD_HEIGHT; row++)
+    {
+        if (header.changedRows & (1u << row))
+        {
+            if (rows + width > end)
+            {
+                return -1;
+            }
+            memcpy(board + row * width, rows, width);
+            rows += width;
+        }
+    }
+
+    // Packets of frames older than the view (reordered after a keyframe) only update the history
+    record_history_board(&view->history, header.frame, board);
+    if (header.frame >= view->frame)
+    {
+        view->sessionId = header.sessionId;
+        view->frame = header.frame;
+        memcpy(view->board, board, sizeof(board));
+        view->piece.tetrominoIndex = header.tetrominoIndex;
+        view->piece.rotation = header.rotation;
+        view->piece.offsetRow = header.offsetRow;
+        view->piece.offsetCol = header.offsetCol;
+        view->phase = static_cast<GamePhase>(header.phase);
+        view->level = header.level;
+        view->lineCount = header.lineCount;
+        view->score = header.score;
+    }
+    return header.length;
+}
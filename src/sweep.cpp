@@ -0,0 +1,648 @@
+#include <chrono>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include "../inc/sweep.h"
+#include "../inc/bot.h"
+#include "../inc/replay.h"
+
+static_assert(sizeof(SweepHeader) % 8 == 0, "lanes follow the header at an aligned offset");
+static_assert(std::is_trivially_copyable<SweepLane>::value, "lanes are checkpointed as raw bytes");
+
+// Function Prototypes
+inline uint64_t mix_bits(uint64_t x);
+static void step_lane_frame(SweepLane *lane, const InputState *input);
+static void start_lane_game(const Sweep *sweep, SweepLane *lane);
+static void finish_lane_game(SweepLane *lane);
+static bool choose_lane_placement(const Sweep *sweep, const GameState *game, PieceState *best, SweepWorker *worker);
+static void run_sweep_thread(Sweep *sweep, uint32_t firstLane, uint32_t laneStride);
+static bool is_sweep_sample_played(const Sweep *sweep, uint64_t game, uint16_t piece);
+static bool write_all(int32_t fd, const void *data, size_t size);
+
+/**
+ * @brief Finalizer of splitmix64, spreads every input bit over the output
+ *
+ * @param x - value to be mixed
+ * @return uint64_t - mixed value
+ */
+inline uint64_t mix_bits(uint64_t x)
+{
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+/**
+ * @brief Steps the game of a lane by one frame
+ *
+ * @param lane - pointer to the lane
+ * @param input - pointer to the input of the frame
+ */
+static void step_lane_frame(SweepLane *lane, const InputState *input)
+{
+    lane->frame++;
+    lane->game.frame = lane->frame;
+    update_game(&lane->game, input);
+}
+
+/**
+ * @brief Starts game gameIndex of the run on a lane, seeded from the run and the index
+ *
+ * @param sweep - pointer to the sweep
+ * @param lane - pointer to the lane
+ */
+static void start_lane_game(const Sweep *sweep, SweepLane *lane)
+{
+    uint32_t seed = static_cast<uint32_t>(mix_bits(sweep->seed ^ mix_bits(lane->gameIndex)));
+    init_replay_game(&lane->game, seed ? seed : 1);
+    lane->frame = 0;
+    lane->pieces = 0;
+
+    // Leave the start screen
+    InputState input = {};
+    input.a = 1;
+    input.deltaA = 1;
+    step_lane_frame(lane, &input);
+}
+
+/**
+ * @brief Adds the current game of a lane to the results of the lane
+ *
+ * @param lane - pointer to the lane
+ */
+static void finish_lane_game(SweepLane *lane)
+{
+    const GameState *game = &lane->game;
+    SweepResults *results = &lane->results;
+    results->games++;
+    results->cappedGames += game->phase != GAME_PHASE_GAMEOVER;
+    results->pieces += lane->pieces;
+    results->lines += static_cast<uint64_t>(game->lineCount);
+    results->score += static_cast<uint64_t>(game->score);
+    results->bestScore = game->score > results->bestScore ? game->score : results->bestScore;
+    results->bestLevel = game->level > results->bestLevel ? game->level : results->bestLevel;
+    results->checksum = mix_bits(results->checksum ^ static_cast<uint64_t>(static_cast<uint32_t>(game->score)) ^
+                                 static_cast<uint64_t>(game->lineCount) << 32 ^ static_cast<uint64_t>(lane->pieces) << 48);
+}
+
+/**
+ * @brief Chooses the placement of the current piece, from the evaluation cache when it holds the board
+ *
+ * @param sweep - pointer to the sweep
+ * @param game - pointer to the game
+ * @param best - receives the chosen placement
+ * @param worker - state of the calling thread
+ * @return true - a placement was chosen
+ * @return false - the piece cannot move from where it is
+ */
+static bool choose_lane_placement(const Sweep *sweep, const GameState *game, PieceState *best, SweepWorker *worker)
+{
+    int32_t score = 0;
+    bool found = false;
+    if (!sweep->cache)
+    {
+        return choose_placement(game, best, &score);
+    }
+    if (find_eval_cache(sweep->cache, game, best, &score, &found))
+    {
+        worker->cacheHits++;
+        return found;
+    }
+    worker->cacheMisses++;
+    found = choose_placement(game, best, &score);
+    insert_eval_cache(sweep->cache, game, best, score, found);
+    return found;
+}
+
+/**
+ * @brief Deals the games of a run to its lanes and starts the first game of every lane
+ *
+ * @param sweep - pointer to the sweep to be initialised
+ * @param seed - seed of the run
+ * @param gameCount - number of games to play
+ * @param laneCount - number of lanes, the most threads the run can use
+ * @param maxPieces - pieces after which a game is stopped
+ */
+void init_sweep(Sweep *sweep, uint64_t seed, uint64_t gameCount, uint32_t laneCount, uint32_t maxPieces)
+{
+    sweep->seed = seed;
+    sweep->gameCount = gameCount;
+    sweep->maxPieces = maxPieces;
+    sweep->lanes.assign(laneCount, SweepLane());
+    for (uint32_t i = 0; i < laneCount; i++)
+    {
+        SweepLane *lane = &sweep->lanes[i];
+        lane->gameIndex = i;
+        if (lane->gameIndex < gameCount)
+        {
+            start_lane_game(sweep, lane);
+        }
+    }
+    sweep->cache = NULL;
+    sweep->dataset = NULL;
+    sweep->cacheHits.store(0);
+    sweep->cacheMisses.store(0);
+    sweep->generation.store(0);
+    sweep->stopping.store(false);
+}
+
+/**
+ * @brief Plays pieces on a lane, starting its next games as its games end
+ *
+ * @param sweep - pointer to the sweep owning the lane
+ * @param lane - pointer to the lane
+ * @param pieceCount - number of pieces to place
+ * @param worker - state of the calling thread
+ * @return true - the lane has games left
+ * @return false - the lane has played every game dealt to it
+ */
+bool step_sweep_lane(const Sweep *sweep, SweepLane *lane, uint32_t pieceCount, SweepWorker *worker)
+{
+    InputState hardDrop = {};
+    hardDrop.a = 1;
+    hardDrop.deltaA = 1;
+    const InputState released = {};
+
+    for (uint32_t i = 0; i < pieceCount && lane->gameIndex < sweep->gameCount; i++)
+    {
+        // The placement is reachable from the piece, so moving it there and hard dropping
+        // stands for the frames of moves a player would take
+        PieceState best;
+        DatasetSample sample;
+        if (sweep->dataset)
+        {
+            pack_dataset_board(&lane->game, sample.board);
+        }
+        if (choose_lane_placement(sweep, &lane->game, &best, worker))
+        {
+            lane->game.piece = best;
+        }
+        int32_t score = lane->game.score;
+        int32_t lineCount = lane->game.lineCount;
+        sample.tetrominoIndex = lane->game.piece.tetrominoIndex;
+        sample.rotation = static_cast<uint8_t>(lane->game.piece.rotation & 3);
+        sample.column = static_cast<int8_t>(lane->game.piece.offsetCol);
+        step_lane_frame(lane, &hardDrop);
+        lane->pieces++;
+        while (lane->game.phase == GAME_PHASE_LINE)
+        {
+            step_lane_frame(lane, &released);
+        }
+        if (sweep->dataset)
+        {
+            sample.lineCount = static_cast<uint8_t>(lane->game.lineCount - lineCount);
+            sample.scoreDelta = lane->game.score - score;
+            sample.game = lane->gameIndex;
+            sample.piece = static_cast<uint16_t>(lane->pieces - 1);
+            add_dataset_sample(sweep->dataset, &worker->samples, &sample);
+        }
+
+        if (lane->game.phase == GAME_PHASE_GAMEOVER || lane->pieces >= sweep->maxPieces)
+        {
+            finish_lane_game(lane);
+            lane->gameIndex += sweep->lanes.size();
+            if (lane->gameIndex < sweep->gameCount)
+            {
+                start_lane_game(sweep, lane);
+            }
+        }
+    }
+    return lane->gameIndex < sweep->gameCount;
+}
+
+/**
+ * @brief Sums the results of lanes, in lane order so the checksum is the same for every run of the same sweep
+ *
+ * @param lanes - lanes of the sweep
+ * @param results - receives the totals
+ */
+void get_sweep_results(const std::vector<SweepLane> &lanes, SweepResults *results)
+{
+    *results = {};
+    for (size_t i = 0; i < lanes.size(); i++)
+    {
+        const SweepResults *lane = &lanes[i].results;
+        results->games += lane->games;
+        results->cappedGames += lane->cappedGames;
+        results->pieces += lane->pieces;
+        results->lines += lane->lines;
+        results->score += lane->score;
+        results->bestScore = lane->bestScore > results->bestScore ? lane->bestScore : results->bestScore;
+        results->bestLevel = lane->bestLevel > results->bestLevel ? lane->bestLevel : results->bestLevel;
+        results->checksum = mix_bits(results->checksum ^ lane->checksum);
+    }
+}
+
+/**
+ * @brief Sweep thread. Steps the lanes firstLane, firstLane + laneStride, ... an epoch at a
+ * time and copies them into the snapshot whenever a checkpoint is requested.
+ *
+ * @param sweep - pointer to the sweep
+ * @param firstLane - first lane of the thread
+ * @param laneStride - number of threads
+ */
+static void run_sweep_thread(Sweep *sweep, uint32_t firstLane, uint32_t laneStride)
+{
+    uint32_t laneCount = static_cast<uint32_t>(sweep->lanes.size());
+    uint32_t copiedGeneration = sweep->generation.load(std::memory_order_acquire);
+    bool active = true;
+    SweepWorker *worker = new SweepWorker();
+    if (sweep->dataset)
+    {
+        init_dataset_block(&worker->samples);
+    }
+
+    while (true)
+    {
+        if (active)
+        {
+            active = false;
+            for (uint32_t i = firstLane; i < laneCount; i += laneStride)
+            {
+                active = step_sweep_lane(sweep, &sweep->lanes[i], SWEEP_EPOCH_PLACEMENTS, worker) || active;
+            }
+            if (!active)
+            {
+                std::lock_guard<std::mutex> lock(sweep->mutex);
+                sweep->finishedThreads++;
+                sweep->changed.notify_all();
+            }
+        }
+
+        uint32_t generation = sweep->generation.load(std::memory_order_acquire);
+        if (generation != copiedGeneration)
+        {
+            for (uint32_t i = firstLane; i < laneCount; i += laneStride)
+            {
+                sweep->snapshot[i] = sweep->lanes[i];
+            }
+            if (sweep->dataset)
+            {
+                // Every sample up to the copy is in the file before the checkpoint is
+                flush_dataset_block(sweep->dataset, &worker->samples);
+            }
+            copiedGeneration = generation;
+            std::lock_guard<std::mutex> lock(sweep->mutex);
+            sweep->copiedThreads++;
+            sweep->changed.notify_all();
+        }
+
+        if (sweep->stopping.load(std::memory_order_acquire))
+        {
+            break;
+        }
+        if (!active)
+        {
+            // Only woken up to copy the (final) lanes for a checkpoint, or to exit
+            std::unique_lock<std::mutex> lock(sweep->mutex);
+            sweep->changed.wait(lock, [&] {
+                return sweep->stopping.load() || sweep->generation.load() != copiedGeneration;
+            });
+        }
+    }
+
+    {
+        // A checkpoint requested after the stop no longer waits for this thread's copy
+        std::lock_guard<std::mutex> lock(sweep->mutex);
+        sweep->exitedThreads++;
+        sweep->changed.notify_all();
+    }
+
+    if (sweep->dataset)
+    {
+        flush_dataset_block(sweep->dataset, &worker->samples);
+    }
+    sweep->cacheHits.fetch_add(worker->cacheHits, std::memory_order_relaxed);
+    sweep->cacheMisses.fetch_add(worker->cacheMisses, std::memory_order_relaxed);
+    delete worker;
+}
+
+/**
+ * @brief Plays the sweep until every game has been played or the sweep is stopped,
+ * checkpointing it periodically and at the end
+ *
+ * @param sweep - pointer to the sweep, stop_sweep() may be called from another thread or a signal handler
+ * @param threadCount - number of threads, at most one per lane
+ * @param checkpointPath - path of the checkpoint file, NULL to run without checkpoints
+ * @param checkpointSeconds - seconds between two checkpoints
+ * @return true - every checkpoint was written
+ * @return false - a checkpoint could not be written
+ */
+bool run_sweep(Sweep *sweep, uint32_t threadCount, const char *checkpointPath, uint32_t checkpointSeconds)
+{
+    uint32_t laneCount = static_cast<uint32_t>(sweep->lanes.size());
+    threadCount = threadCount < 1 ? 1 : (threadCount > laneCount ? laneCount : threadCount);
+    sweep->snapshot.assign(laneCount, SweepLane());
+    sweep->copiedThreads = 0;
+    sweep->finishedThreads = 0;
+    sweep->exitedThreads = 0;
+
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+        threads.push_back(std::thread(run_sweep_thread, sweep, i, threadCount));
+    }
+
+    bool written = true;
+    std::chrono::steady_clock::time_point nextCheckpoint =
+        std::chrono::steady_clock::now() + std::chrono::seconds(checkpointSeconds);
+    while (!sweep->stopping.load())
+    {
+        {
+            // Polled, so that a stop from a signal handler is noticed
+            std::unique_lock<std::mutex> lock(sweep->mutex);
+            if (sweep->changed.wait_for(lock, std::chrono::milliseconds(100),
+                                        [&] { return sweep->finishedThreads == threadCount; }))
+            {
+                break;
+            }
+        }
+        if (!checkpointPath || std::chrono::steady_clock::now() < nextCheckpoint)
+        {
+            continue;
+        }
+
+        // Every thread copies its lanes at the end of its epoch, then the copy is written while they run on.
+        // Threads stopping at the end of their epoch exit without copying, the final checkpoint covers them.
+        bool copied;
+        {
+            std::unique_lock<std::mutex> lock(sweep->mutex);
+            if (sweep->stopping.load())
+            {
+                break;
+            }
+            sweep->copiedThreads = 0;
+            sweep->generation.fetch_add(1, std::memory_order_release);
+            sweep->changed.notify_all();
+            sweep->changed.wait(lock, [&] { return sweep->copiedThreads + sweep->exitedThreads >= threadCount; });
+            copied = sweep->copiedThreads == threadCount;
+        }
+        if (!copied)
+        {
+            break;
+        }
+        if (sweep->dataset && !sync_dataset_writer(sweep->dataset))
+        {
+            // A checkpoint past samples that are not on disk could not be resumed with them
+            written = false;
+            break;
+        }
+        written = write_sweep_checkpoint(checkpointPath, sweep, sweep->snapshot) && written;
+        nextCheckpoint = std::chrono::steady_clock::now() + std::chrono::seconds(checkpointSeconds);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sweep->mutex);
+        sweep->stopping.store(true);
+        sweep->changed.notify_all();
+    }
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+        threads[i].join();
+    }
+
+    // The threads are done, the lanes themselves are the final checkpoint
+    if (checkpointPath && (!sweep->dataset || sync_dataset_writer(sweep->dataset)))
+    {
+        written = write_sweep_checkpoint(checkpointPath, sweep, sweep->lanes) && written;
+    }
+    else if (checkpointPath)
+    {
+        written = false;
+    }
+    return written;
+}
+
+/**
+ * @brief Tells whether a sample of the dataset was played before the position of the lanes
+ *
+ * @param sweep - pointer to the sweep
+ * @param game - index of the game of the sample in the run
+ * @param piece - index of the piece of the sample in the game
+ * @return true - the lanes are past the sample, a resumed run does not record it again
+ * @return false - the sample was recorded after the checkpoint
+ */
+static bool is_sweep_sample_played(const Sweep *sweep, uint64_t game, uint16_t piece)
+{
+    const SweepLane *lane = &sweep->lanes[game % sweep->lanes.size()];
+    return game < lane->gameIndex || (game == lane->gameIndex && piece < lane->pieces);
+}
+
+/**
+ * @brief Reopens the dataset of a resumed sweep. The samples recorded up to its checkpoint
+ * are kept, the ones recorded after it are dropped as the resumed run records them again,
+ * and new samples are appended. The kept samples are copied to <path>.tmp, which then
+ * replaces <path>, so a failure leaves the dataset as it was.
+ *
+ * @param sweep - pointer to the sweep restored from its checkpoint
+ * @param writer - pointer to the writer to be opened
+ * @param path - path of the dataset
+ * @return true - the writer is open at the end of the kept samples
+ * @return false - the dataset is unreadable or could not be rewritten
+ */
+bool resume_sweep_dataset(const Sweep *sweep, DatasetWriter *writer, const char *path)
+{
+    DatasetReader *reader = new DatasetReader();
+    if (!open_dataset(reader, path))
+    {
+        delete reader;
+        return false;
+    }
+    std::string temporaryPath = std::string(path) + ".tmp";
+    if (!open_dataset_writer(writer, temporaryPath.c_str()))
+    {
+        close_dataset(reader);
+        delete reader;
+        return false;
+    }
+
+    // Whole blocks are copied as they are, only blocks straddling the checkpoint are decoded and filtered
+    DatasetBlock *rows = new DatasetBlock();
+    DatasetBlock *kept = new DatasetBlock();
+    init_dataset_block(rows);
+    init_dataset_block(kept);
+    bool copied = true;
+    for (uint32_t block = 0; block < reader->blocks.size() && copied; block++)
+    {
+        rows->rowCount = reader->blocks[block].rowCount;
+        copied = read_dataset_column(reader, block, DATASET_COLUMN_GAME, rows->columns[DATASET_COLUMN_GAME].data()) &&
+                 read_dataset_column(reader, block, DATASET_COLUMN_PIECE, rows->columns[DATASET_COLUMN_PIECE].data());
+        uint32_t playedRows = 0;
+        for (uint32_t row = 0; row < rows->rowCount && copied; row++)
+        {
+            uint64_t game;
+            uint16_t piece;
+            memcpy(&game, rows->columns[DATASET_COLUMN_GAME].data() + static_cast<size_t>(row) * sizeof(game), sizeof(game));
+            memcpy(&piece, rows->columns[DATASET_COLUMN_PIECE].data() + static_cast<size_t>(row) * sizeof(piece), sizeof(piece));
+            playedRows += is_sweep_sample_played(sweep, game, piece);
+        }
+        if (!copied || playedRows == 0)
+        {
+            continue;
+        }
+        if (playedRows == rows->rowCount)
+        {
+            copied = copy_dataset_block(writer, reader, block);
+            continue;
+        }
+        for (uint32_t column = 0; column < DATASET_COLUMN_COUNT && copied; column++)
+        {
+            copied = read_dataset_column(reader, block, static_cast<DatasetColumn>(column), rows->columns[column].data());
+        }
+        for (uint32_t row = 0; row < rows->rowCount && copied; row++)
+        {
+            DatasetSample sample;
+            get_dataset_sample(rows, row, &sample);
+            if (is_sweep_sample_played(sweep, sample.game, sample.piece))
+            {
+                add_dataset_sample(writer, kept, &sample);
+            }
+        }
+    }
+    flush_dataset_block(writer, kept);
+    close_dataset(reader);
+    delete reader;
+    delete rows;
+    delete kept;
+
+    if (!copied || writer->failed || rename(temporaryPath.c_str(), path) != 0)
+    {
+        close(writer->fd);
+        writer->fd = -1;
+        unlink(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Asks a running sweep to stop and write its final checkpoint. Safe to call from a signal handler.
+ *
+ * @param sweep - pointer to the sweep
+ */
+void stop_sweep(Sweep *sweep)
+{
+    sweep->stopping.store(true);
+}
+
+/**
+ * @brief Writes a buffer completely to a file descriptor
+ *
+ * @param fd - file descriptor
+ * @param data - data to be written
+ * @param size - size of the data in bytes
+ * @return true - the data was written
+ * @return false - a write failed
+ */
+static bool write_all(int32_t fd, const void *data, size_t size)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    while (size > 0)
+    {
+        ssize_t result = write(fd, bytes, size);
+        if (result < 0)
+        {
+            return false;
+        }
+        bytes += result;
+        size -= static_cast<size_t>(result);
+    }
+    return true;
+}
+
+/**
+ * @brief Writes a checkpoint of a sweep, replacing the previous one only once it is on disk
+ *
+ * @param path - path of the checkpoint file
+ * @param sweep - pointer to the sweep
+ * @param lanes - lanes to be written, the live lanes or a snapshot of them
+ * @return true - the checkpoint was written
+ * @return false - the checkpoint could not be written, the previous one is left as it was
+ */
+bool write_sweep_checkpoint(const char *path, const Sweep *sweep, const std::vector<SweepLane> &lanes)
+{
+    SweepHeader header = {};
+    header.magic = SWEEP_MAGIC;
+    header.version = SWEEP_VERSION;
+    header.boardWidth = GameState::BOARD_WIDTH;
+    header.laneSize = sizeof(SweepLane);
+    header.laneCount = static_cast<uint32_t>(lanes.size());
+    header.seed = sweep->seed;
+    header.gameCount = sweep->gameCount;
+    header.maxPieces = sweep->maxPieces;
+    header.complete = 1;
+    for (size_t i = 0; i < lanes.size(); i++)
+    {
+        header.complete = header.complete && lanes[i].gameIndex >= sweep->gameCount;
+    }
+
+    std::string temporaryPath = std::string(path) + ".tmp";
+    int32_t fd = open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+    bool written = write_all(fd, &header, sizeof(header)) && write_all(fd, lanes.data(), lanes.size() * sizeof(SweepLane)) &&
+                   fsync(fd) == 0;
+    written = close(fd) == 0 && written;
+    if (!written || rename(temporaryPath.c_str(), path) != 0)
+    {
+        unlink(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Maps a checkpoint and restores the sweep it was taken from
+ *
+ * @param path - path of the checkpoint file
+ * @param sweep - pointer to the sweep to be restored
+ * @return true - the sweep was restored
+ * @return false - the file could not be read or was written by an incompatible build
+ */
+bool read_sweep_checkpoint(const char *path, Sweep *sweep)
+{
+    int32_t fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(SweepHeader))
+    {
+        close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void *mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+
+    const SweepHeader *header = static_cast<const SweepHeader *>(mapping);
+    bool valid = header->magic == SWEEP_MAGIC && header->version == SWEEP_VERSION &&
+                 header->boardWidth == GameState::BOARD_WIDTH && header->laneSize == sizeof(SweepLane) &&
+                 header->laneCount > 0 && size == sizeof(SweepHeader) + static_cast<size_t>(header->laneCount) * sizeof(SweepLane);
+    if (valid)
+    {
+        const SweepLane *lanes = reinterpret_cast<const SweepLane *>(header + 1);
+        sweep->seed = header->seed;
+        sweep->gameCount = header->gameCount;
+        sweep->maxPieces = header->maxPieces;
+        sweep->lanes.assign(lanes, lanes + header->laneCount);
+        sweep->cache = NULL;
+        sweep->dataset = NULL;
+        sweep->cacheHits.store(0);
+        sweep->cacheMisses.store(0);
+        sweep->generation.store(0);
+        sweep->stopping.store(false);
+    }
+    munmap(mapping, size);
+    return valid;
+}
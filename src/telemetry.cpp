@@ -0,0 +1,86 @@
+#include <cstddef>
+#include "../inc/telemetry.h"
+
+static std::atomic<TelemetryCounters *> telemetryBlocks(NULL);
+
+// Releases the calling thread's block when the thread exits
+struct TelemetryThread
+{
+    TelemetryCounters *counters;
+
+    ~TelemetryThread()
+    {
+        if (counters)
+        {
+            counters->claimed.store(false, std::memory_order_release);
+        }
+    }
+};
+
+static thread_local TelemetryThread telemetryThread = {NULL};
+
+/**
+ * @brief Gets the counter block of the calling thread, claiming a released block or
+ * publishing a new one on the first call of the thread
+ *
+ * @return TelemetryCounters* - block only written by the calling thread
+ */
+TelemetryCounters *get_telemetry_counters()
+{
+    TelemetryCounters *counters = telemetryThread.counters;
+    if (counters)
+    {
+        return counters;
+    }
+
+    for (counters = telemetryBlocks.load(std::memory_order_acquire); counters; counters = counters->next)
+    {
+        bool expected = false;
+        if (!counters->claimed.load(std::memory_order_relaxed) &&
+            counters->claimed.compare_exchange_strong(expected, true, std::memory_order_acquire))
+        {
+            telemetryThread.counters = counters;
+            return counters;
+        }
+    }
+
+    // Value-initialized, so every counter starts at zero
+    counters = new TelemetryCounters();
+    counters->claimed.store(true, std::memory_order_relaxed);
+    counters->next = telemetryBlocks.load(std::memory_order_relaxed);
+    while (!telemetryBlocks.compare_exchange_weak(counters->next, counters, std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+    telemetryThread.counters = counters;
+    return counters;
+}
+
+/**
+ * @brief Sums the counters of every thread. Counts added concurrently may or may not be included.
+ *
+ * @param snapshot - receives the totals
+ */
+void collect_telemetry(TelemetrySnapshot *snapshot)
+{
+    *snapshot = {};
+    for (TelemetryCounters *counters = telemetryBlocks.load(std::memory_order_acquire); counters; counters = counters->next)
+    {
+        for (int32_t i = 0; i < TELEMETRY_TETROMINOS; i++)
+        {
+            snapshot->pieceSpawns[i] += counters->pieceSpawns[i].load(std::memory_order_relaxed);
+        }
+        snapshot->softDrops += counters->softDrops.load(std::memory_order_relaxed);
+        snapshot->hardDrops += counters->hardDrops.load(std::memory_order_relaxed);
+        for (int32_t i = 0; i < 4; i++)
+        {
+            snapshot->lineClears[i] += counters->lineClears[i].load(std::memory_order_relaxed);
+        }
+        snapshot->levelUps += counters->levelUps.load(std::memory_order_relaxed);
+        snapshot->gamesStarted += counters->gamesStarted.load(std::memory_order_relaxed);
+        for (int32_t i = 0; i < TELEMETRY_LEVELS; i++)
+        {
+            snapshot->gameOvers[i] += counters->gameOvers[i].load(std::memory_order_relaxed);
+        }
+        snapshot->playFrames += counters->playFrames.load(std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,148 @@
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "../inc/telemetry_export.h"
+
+// Background export started by start_telemetry_export()
+struct TelemetryExport
+{
+    std::mutex mutex;
+    std::condition_variable stopped;
+    std::thread thread;
+    std::string path;
+    uint32_t intervalSeconds;
+    bool running;
+};
+
+// Function Prototypes
+static void write_counter_header(FILE *file, const char *name, const char *help);
+static void run_telemetry_export(TelemetryExport *telemetry);
+
+static const char TETROMINO_NAMES[] = "IOTSZLJ"; // Labels of the tetrominos in TETROMINOS order
+
+static TelemetryExport telemetryExport;
+
+/**
+ * @brief Writes the HELP and TYPE lines of a counter
+ *
+ * @param file - output file
+ * @param name - name of the counter
+ * @param help - description of the counter
+ */
+static void write_counter_header(FILE *file, const char *name, const char *help)
+{
+    fprintf(file, "# HELP %s %s\n# TYPE %s counter\n", name, help, name);
+}
+
+/**
+ * @brief Writes the current totals in the Prometheus text format, replacing the file atomically
+ *
+ * @param path - path of the file
+ * @return true - the file was written
+ * @return false - the file could not be written
+ */
+bool write_telemetry(const char *path)
+{
+    TelemetrySnapshot snapshot;
+    collect_telemetry(&snapshot);
+
+    std::string temporaryPath = std::string(path) + ".tmp";
+    FILE *file = fopen(temporaryPath.c_str(), "w");
+    if (!file)
+    {
+        return false;
+    }
+
+    write_counter_header(file, "tetris_piece_spawns_total", "Pieces spawned by tetromino");
+    for (int32_t i = 0; i < TELEMETRY_TETROMINOS; i++)
+    {
+        fprintf(file, "tetris_piece_spawns_total{tetromino=\"%c\"} %llu\n", TETROMINO_NAMES[i],
+                static_cast<unsigned long long>(snapshot.pieceSpawns[i]));
+    }
+    write_counter_header(file, "tetris_soft_drops_total", "Soft drops asked for by players");
+    fprintf(file, "tetris_soft_drops_total %llu\n", static_cast<unsigned long long>(snapshot.softDrops));
+    write_counter_header(file, "tetris_hard_drops_total", "Hard drops asked for by players");
+    fprintf(file, "tetris_hard_drops_total %llu\n", static_cast<unsigned long long>(snapshot.hardDrops));
+    write_counter_header(file, "tetris_line_clears_total", "Line clears by number of lines cleared at once");
+    for (int32_t i = 0; i < 4; i++)
+    {
+        fprintf(file, "tetris_line_clears_total{lines=\"%d\"} %llu\n", i + 1, static_cast<unsigned long long>(snapshot.lineClears[i]));
+    }
+    write_counter_header(file, "tetris_level_ups_total", "Level ups");
+    fprintf(file, "tetris_level_ups_total %llu\n", static_cast<unsigned long long>(snapshot.levelUps));
+    write_counter_header(file, "tetris_games_started_total", "Games started from the start screen");
+    fprintf(file, "tetris_games_started_total %llu\n", static_cast<unsigned long long>(snapshot.gamesStarted));
+    write_counter_header(file, "tetris_game_overs_total", "Game overs by level reached (the last level includes every higher one)");
+    for (int32_t i = 0; i < TELEMETRY_LEVELS; i++)
+    {
+        fprintf(file, "tetris_game_overs_total{level=\"%d\"} %llu\n", i, static_cast<unsigned long long>(snapshot.gameOvers[i]));
+    }
+    write_counter_header(file, "tetris_play_frames_total", "Frames stepped while a game is in play");
+    fprintf(file, "tetris_play_frames_total %llu\n", static_cast<unsigned long long>(snapshot.playFrames));
+
+    bool written = ferror(file) == 0;
+    written = fclose(file) == 0 && written;
+    if (!written || rename(temporaryPath.c_str(), path) != 0)
+    {
+        remove(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Export thread. Writes the telemetry every interval and once more when stopped.
+ *
+ * @param telemetry - pointer to the export state
+ */
+static void run_telemetry_export(TelemetryExport *telemetry)
+{
+    std::unique_lock<std::mutex> lock(telemetry->mutex);
+    while (telemetry->running)
+    {
+        telemetry->stopped.wait_for(lock, std::chrono::seconds(telemetry->intervalSeconds));
+        write_telemetry(telemetry->path.c_str());
+    }
+}
+
+/**
+ * @brief Starts writing the telemetry to a file periodically from a background thread
+ *
+ * @param path - path of the file
+ * @param intervalSeconds - seconds between two writes
+ * @return true - the export was started and the file written once
+ * @return false - an export is already running or the file could not be written
+ */
+bool start_telemetry_export(const char *path, uint32_t intervalSeconds)
+{
+    std::lock_guard<std::mutex> lock(telemetryExport.mutex);
+    if (telemetryExport.running || !write_telemetry(path))
+    {
+        return false;
+    }
+    telemetryExport.path = path;
+    telemetryExport.intervalSeconds = intervalSeconds > 0 ? intervalSeconds : 1;
+    telemetryExport.running = true;
+    telemetryExport.thread = std::thread(run_telemetry_export, &telemetryExport);
+    return true;
+}
+
+/**
+ * @brief Stops the periodic export after a last write of the telemetry
+ */
+void stop_telemetry_export()
+{
+    {
+        std::lock_guard<std::mutex> lock(telemetryExport.mutex);
+        if (!telemetryExport.running)
+        {
+            return;
+        }
+        telemetryExport.running = false;
+    }
+    telemetryExport.stopped.notify_all();
+    telemetryExport.thread.join();
+}
@@ -1,14 +1,13 @@
 #include <cassert>
 // #include <SDL2/SDL.h>
 #include "../inc/tetris.h"
+#include "../inc/telemetry.h"
 
 // Function Prototypes
-inline int32_t generate_random_int(int32_t min, int32_t max);
-inline float get_time_to_next_drop(int32_t gameLevel);
-inline uint8_t check_row_filled(const uint8_t *values, int32_t width, int32_t row);
+inline int32_t generate_random_int(uint32_t *randomState, int32_t min, int32_t max);
+inline uint32_t get_frames_to_next_drop(int32_t gameLevel);
 inline int32_t compute_score(int32_t level, int32_t lineCount);
 inline int32_t get_lines_for_next_level(int32_t startLevel, int32_t currentLevel);
-inline uint8_t check_row_empty(const uint8_t *values, int32_t width, int32_t row);
 
 /**
  * @brief Gets the data from the tetromino considering rotation
@@ -83,69 +82,310 @@ void matrix_set(uint8_t *values, int32_t width, int32_t row, int32_t col, uint8_
     values[index] = value;
 }
 
+/*
+Occupancy masks of every tetromino in every rotation, built once from TETROMINOS
+*/
+struct PieceMaskTable
+{
+    PieceMask masks[ARRAY_COUNT(TETROMINOS)][4];
+
+    PieceMaskTable()
+    {
+        for (uint32_t index = 0; index < ARRAY_COUNT(TETROMINOS); index++)
+        {
+            const Tetromino *tetromino = TETROMINOS + index;
+            for (int32_t rotation = 0; rotation < 4; rotation++)
+            {
+                PieceMask *mask = &masks[index][rotation];
+                *mask = {};
+                mask->minRow = mask->minCol = 4;
+                mask->maxRow = mask->maxCol = -1;
+                for (int32_t row = 0; row < tetromino->side; row++)
+                {
+                    for (int32_t col = 0; col < tetromino->side; col++)
+                    {
+                        if (tetromino_get(tetromino, row, col, rotation))
+                        {
+                            mask->rows[row] |= static_cast<uint8_t>(1 << col);
+                            mask->minRow = static_cast<int8_t>(row < mask->minRow ? row : mask->minRow);
+                            mask->maxRow = static_cast<int8_t>(row > mask->maxRow ? row : mask->maxRow);
+                            mask->minCol = static_cast<int8_t>(col < mask->minCol ? col : mask->minCol);
+                            mask->maxCol = static_cast<int8_t>(col > mask->maxCol ? col : mask->maxCol);
+                        }
+                    }
+                }
+            }
+        }
+    }
+};
+
+static const PieceMaskTable PIECE_MASKS;
+
 /**
- * @brief - Checks whether the piece is valid or not and returns true/false accordingly
- * Moves that are not permitted:
- * (i) If piece's movements (left, right, drop faster) goes out of bounds or collides
- * (ii) If piece's rotation overlaps with something else on the board
+ * @brief Gets the precomputed occupancy mask of a tetromino in the given rotation
  *
- * @param piece - Pointer to PieceState
- * @param board - board array
- * @param width - width of the board
- * @param height - height of the board
- * @return true - valid piece
- * @return false - invalid piece
+ * @param tetrominoIndex - index of the tetromino in TETROMINOS
+ * @param rotation - rotation of the tetromino (0 - 3)
+ * @return const PieceMask* - occupancy mask of the rotated tetromino
  */
-bool check_piece_valid(PieceState *piece, const uint8_t *board, int32_t width, int32_t height)
+const PieceMask *get_piece_mask(uint8_t tetrominoIndex, int32_t rotation)
+{
+    return &PIECE_MASKS.masks[tetrominoIndex][rotation & 3];
+}
+
+/*
+Rotations of every tetromino out of every rotation in both directions, built once from
+the kick tables
+*/
+struct RotationTable
 {
-    const Tetromino *tetromino = TETROMINOS + piece->tetrominoIndex;
-    assert(tetromino);
+    RotationKicks rotations[ARRAY_COUNT(TETROMINOS)][4][2];
 
-    // Loop through all the cells of the tetromino and check
-    // whether the non-empty (non-zero) cells collide or
-    // are out-of-bounds.
-    for (int32_t row = 0; row < tetromino->side; row++)
+    RotationTable()
     {
-        for (int32_t col = 0; col < tetromino->side; col++)
+        static_assert(ARRAY_COUNT(TETROMINO_KICK_TABLES) == ARRAY_COUNT(TETROMINOS) &&
+                          ARRAY_COUNT(TETROMINO_KICK_STATES) == ARRAY_COUNT(TETROMINOS),
+                      "every tetromino has a kick table");
+        for (uint32_t index = 0; index < ARRAY_COUNT(TETROMINOS); index++)
         {
-            uint8_t value = tetromino_get(tetromino, row, col, piece->rotation);
-            if (value > 0)
+            const KickTable &kicks = *TETROMINO_KICK_TABLES[index];
+            for (int32_t from = 0; from < 4; from++)
             {
-
-                // Computing corresponding board's row and column
-                // from the piece's row and column
-                int32_t boardRow = piece->offsetRow + row;
-                int32_t boardCol = piece->offsetCol + col;
-
-                // Invalid scenario - out of bounds
-                if ((boardRow < 0) || (boardRow >= height))
+                int32_t state = (from + TETROMINO_KICK_STATES[index]) % 4;
+                for (int32_t direction = ROTATION_CW; direction <= ROTATION_CCW; direction++)
                 {
-                    return false;
-                }
-                if ((boardCol < 0) || (boardCol >= width))
-                {
-                    return false;
-                }
-                // Invalid scenario - collision detected if the matrix_get() returns a value   for the current boardRow and boardCol
-                if (matrix_get(board, width, boardRow, boardCol))
-                {
-                    return false;
+                    RotationKicks *rotation = &rotations[index][from][direction];
+                    *rotation = {};
+                    rotation->rotation = (from + (direction == ROTATION_CW ? 1 : 3)) % 4;
+                    rotation->mask = &PIECE_MASKS.masks[index][rotation->rotation];
+                    for (int32_t kick = 0; kick < TETROMINO_KICKS; kick++)
+                    {
+                        int8_t col = kicks[state][direction][kick][0];
+                        int8_t row = kicks[state][direction][kick][1];
+                        bool repeated = false;
+                        for (int32_t i = 0; i < rotation->kickCount; i++)
+                        {
+                            repeated = repeated || (rotation->rows[i] == row && rotation->cols[i] == col);
+                        }
+                        if (!repeated)
+                        {
+                            rotation->rows[rotation->kickCount] = row;
+                            rotation->cols[rotation->kickCount] = col;
+                            rotation->kickCount++;
+                        }
+                    }
                 }
             }
         }
     }
+};
+
+static const RotationTable ROTATIONS;
+
+/**
+ * @brief Gets the precomputed rotation of a tetromino out of the given rotation
+ *
+ * @param tetrominoIndex - index of the tetromino in TETROMINOS
+ * @param rotation - rotation of the tetromino before rotating (0 - 3)
+ * @param direction - ROTATION_CW or ROTATION_CCW
+ * @return const RotationKicks* - mask, rotation and kicks of the rotated tetromino
+ */
+const RotationKicks *get_rotation_kicks(uint8_t tetrominoIndex, int32_t rotation, RotationDirection direction)
+{
+    return &ROTATIONS.rotations[tetrominoIndex][rotation & 3][direction];
+}
+
+/*
+Row kernels operating on the occupancy masks of the board.
+The primary template handles single integer rows (16, 32 and 64 bit), the
+specialization for WideRow is the generic fallback for boards wider than 64 columns.
+*/
+template <int32_t Width, typename Row>
+struct RowKernel
+{
+    static inline Row full()
+    {
+        return static_cast<Row>(static_cast<Row>(~static_cast<Row>(0)) >> (sizeof(Row) * 8 - Width));
+    }
+
+    static inline bool filled(const Row &row)
+    {
+        return row == full();
+    }
+
+    static inline bool empty(const Row &row)
+    {
+        return row == 0;
+    }
+
+    static inline void clear(Row &row)
+    {
+        row = 0;
+    }
+
+    static inline void set(Row &row, int32_t col)
+    {
+        row = static_cast<Row>(row | (static_cast<Row>(1) << col));
+    }
+
+    // pieceBits holds the cells of one piece row with bit 0 placed at column col
+    static inline bool overlaps(const Row &row, int32_t col, uint8_t pieceBits)
+    {
+        uint64_t shifted = col >= 0 ? static_cast<uint64_t>(pieceBits) << col : static_cast<uint64_t>(pieceBits) >> -col;
+        return (row & shifted) != 0;
+    }
+};
+
+template <int32_t Width>
+struct RowKernel<Width, WideRow<Width> >
+{
+    static const int32_t WORDS = (Width + 63) / 64;
+
+    static inline bool filled(const WideRow<Width> &row)
+    {
+        for (int32_t word = 0; word < WORDS - 1; word++)
+        {
+            if (row.words[word] != ~0ull)
+            {
+                return false;
+            }
+        }
+        int32_t lastBits = Width - (WORDS - 1) * 64;
+        return row.words[WORDS - 1] == (~0ull >> (64 - lastBits));
+    }
+
+    static inline bool empty(const WideRow<Width> &row)
+    {
+        for (int32_t word = 0; word < WORDS; word++)
+        {
+            if (row.words[word])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static inline void clear(WideRow<Width> &row)
+    {
+        memset(row.words, 0, sizeof(row.words));
+    }
+
+    static inline void set(WideRow<Width> &row, int32_t col)
+    {
+        row.words[col >> 6] |= 1ull << (col & 63);
+    }
+
+    static inline bool overlaps(const WideRow<Width> &row, int32_t col, uint8_t pieceBits)
+    {
+        for (int32_t bit = 0; pieceBits >> bit; bit++)
+        {
+            int32_t boardCol = col + bit;
+            if (((pieceBits >> bit) & 1) && ((row.words[boardCol >> 6] >> (boardCol & 63)) & 1))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+/**
+ * @brief - Checks whether a piece mask fits on the board at the given offsets: in bounds and
+ * clear of the occupancy masks of the board rows it covers
+ *
+ * @param mask - occupancy mask of the rotated tetromino
+ * @param offsetRow - row of the tetromino matrix on the board
+ * @param offsetCol - column of the tetromino matrix on the board
+ * @param game - pointer to GameState whose board is checked for collisions
+ * @return true - the piece fits
+ * @return false - the piece is out of bounds or collides
+ */
+template <typename Game>
+bool check_mask_valid(const PieceMask *mask, int32_t offsetRow, int32_t offsetCol, const Game *game)
+{
+    typedef RowKernel<Game::BOARD_WIDTH, typename Game::RowMask> Kernel;
+
+    // Invalid scenario - out of bounds
+    if ((offsetRow + mask->minRow < 0) || (offsetRow + mask->maxRow >= Game::BOARD_HEIGHT))
+    {
+        return false;
+    }
+    if ((offsetCol + mask->minCol < 0) || (offsetCol + mask->maxCol >= Game::BOARD_WIDTH))
+    {
+        return false;
+    }
+
+    // Invalid scenario - collision detected if any filled cell of the piece row
+    // overlaps with the occupancy mask of the corresponding board row
+    for (int32_t row = mask->minRow; row <= mask->maxRow; row++)
+    {
+        if (Kernel::overlaps(game->rows[offsetRow + row], offsetCol, mask->rows[row]))
+        {
+            return false;
+        }
+    }
 
     // Else true
     return true;
 }
 
+/**
+ * @brief - Checks whether the piece is valid or not and returns true/false accordingly
+ * Moves that are not permitted:
+ * (i) If piece's movements (left, right, drop faster) goes out of bounds or collides
+ * (ii) If piece's rotation overlaps with something else on the board
+ *
+ * @param piece - Pointer to PieceState
+ * @param game - pointer to GameState whose board is checked for collisions
+ * @return true - valid piece
+ * @return false - invalid piece
+ */
+template <typename Game>
+bool check_piece_valid(const PieceState *piece, const Game *game)
+{
+    const PieceMask *mask = get_piece_mask(piece->tetrominoIndex, piece->rotation);
+    return check_mask_valid(mask, piece->offsetRow, piece->offsetCol, game);
+}
+
+/**
+ * @brief - Rotates a piece a quarter turn, trying the wall kicks of its tetromino in order
+ * (tetromino.h) until the rotated mask fits. The piece is left untouched if no kick fits.
+ *
+ * @param piece - Pointer to PieceState to be rotated, at a valid position
+ * @param direction - ROTATION_CW or ROTATION_CCW
+ * @param game - pointer to GameState whose board is checked for collisions
+ * @return true - piece rotated, possibly moved by a kick
+ * @return false - every kick collides
+ */
+template <typename Game>
+bool rotate_piece(PieceState *piece, RotationDirection direction, const Game *game)
+{
+    const RotationKicks *rotation = get_rotation_kicks(piece->tetrominoIndex, piece->rotation, direction);
+    for (int32_t kick = 0; kick < rotation->kickCount; kick++)
+    {
+        int32_t offsetRow = piece->offsetRow + rotation->rows[kick];
+        int32_t offsetCol = piece->offsetCol + rotation->cols[kick];
+        if (check_mask_valid(rotation->mask, offsetRow, offsetCol, game))
+        {
+            piece->offsetRow = offsetRow;
+            piece->offsetCol = offsetCol;
+            piece->rotation = rotation->rotation;
+            return true;
+        }
+    }
+    return false;
+}
+
 /**
  * @brief Merges the collided piece with the board by copying its contents onto the board
  *
  * @param game - pointer to GameState holding the current state of the game
  */
-void merge_piece(GameState *game)
+template <typename Game>
+void merge_piece(Game *game)
 {
+    typedef RowKernel<Game::BOARD_WIDTH, typename Game::RowMask> Kernel;
     const Tetromino *tetromino = TETROMINOS + game->piece.tetrominoIndex;
     for (int32_t row = 0; row < tetromino->side; row++)
     {
@@ -156,32 +396,49 @@ void merge_piece(GameState *game)
             {
                 int32_t boardRow = game->piece.offsetRow + row;
                 int32_t boardCol = game->piece.offsetCol + col;
-                matrix_set(game->board, WIDTH, boardRow, boardCol, value);
+                matrix_set(game->board, Game::BOARD_WIDTH, boardRow, boardCol, value);
+                Kernel::set(game->rows[boardRow], boardCol);
             }
         }
     }
 }
 
-inline int32_t generate_random_int(int32_t min, int32_t max)
+/**
+ * @brief Generates a random integer in [min, max) from the game's own xorshift32 generator.
+ * Every game carries its own generator state so that games stepped on different threads
+ * do not share the global rand() state and replay identically from the same seed.
+ *
+ * @param randomState - pointer to the generator state, a zero state is seeded with a fixed constant
+ * @param min - smallest value that can be returned
+ * @param max - one past the largest value that can be returned
+ * @return int32_t - random integer
+ */
+inline int32_t generate_random_int(uint32_t *randomState, int32_t min, int32_t max)
 {
+    uint32_t x = *randomState ? *randomState : 0x9E3779B9u;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *randomState = x;
+
     int32_t range = max - min;
-    return min + rand() % range;
+    return min + static_cast<int32_t>(x % static_cast<uint32_t>(range));
 }
 
 /**
- * @brief Computes and returns the time for next tetromino piece to drop based on the current level
+ * @brief Computes and returns the frames until the next drop of the tetromino piece based on the current level
  * Information about the game level is taken from Nintendo Tetris's wiki page
  *
  * @param gameLevel - current level of the game
- * @return float - time for next drop
+ * @return uint32_t - frames until the next drop
  */
-inline float get_time_to_next_drop(int32_t gameLevel)
+inline uint32_t get_frames_to_next_drop(int32_t gameLevel)
 {
     if (gameLevel > 29)
     {
         gameLevel = 29;
     }
-    return FRAMES_PER_DROP[gameLevel] * TARGET_SECONDS_PER_FRAME;
+    return FRAMES_PER_DROP[gameLevel];
 }
 
 /**
@@ -189,12 +446,14 @@ inline float get_time_to_next_drop(int32_t gameLevel)
  *
  * @param game - pointer to GameState holding the current state of the game
  */
-void spawn_piece(GameState *game)
+template <typename Game>
+void spawn_piece(Game *game)
 {
     game->piece = {};
-    game->piece.tetrominoIndex = static_cast<uint8_t>(generate_random_int(0, ARRAY_COUNT(TETROMINOS)));
-    game->piece.offsetCol = WIDTH / 2;
-    game->nextDropTime = game->time + get_time_to_next_drop(game->level);
+    game->piece.tetrominoIndex = static_cast<uint8_t>(generate_random_int(&game->randomState, 0, ARRAY_COUNT(TETROMINOS)));
+    game->piece.offsetCol = Game::BOARD_WIDTH / 2;
+    game->nextDropFrame = game->frame + get_frames_to_next_drop(game->level);
+    add_telemetry(&get_telemetry_counters()->pieceSpawns[game->piece.tetrominoIndex]);
 }
 
 /**
@@ -204,13 +463,14 @@ void spawn_piece(GameState *game)
  * @return true - next drop occurs
  * @return false - spawned a new piece and next drop did not occur
  */
-bool soft_drop(GameState *game)
+template <typename Game>
+bool soft_drop(Game *game)
 {
     // Move the piece down by incrementing its row offset
     game->piece.offsetRow++;
 
     // If piece is invalid then collision occurred
-    if (!check_piece_valid(&game->piece, game->board, WIDTH, HEIGHT))
+    if (!check_piece_valid(&game->piece, game))
     {
         // Move the piece up by decrementing its row offset
         game->piece.offsetRow--;
@@ -223,77 +483,58 @@ bool soft_drop(GameState *game)
         return false;
     }
 
-    game->nextDropTime = game->time + get_time_to_next_drop(game->level);
+    game->nextDropFrame = game->frame + get_frames_to_next_drop(game->level);
     return true;
 }
 
 /**
- * @brief - Checks whether the lines are filled or not.
+ * @brief - Finds lines on the board that are filled and populates game->lines with 1 or 0. 1 indicates that the line (row) is filled while 0 indicates empty. It returns the number of filled lines.
  *
- * @param values - array containing board data
- * @param width - width of the board
- * @param row - number of rows in the board
- * @return uint8_t - 1 indicates filled while 0 indicates empty
- */
-inline uint8_t check_row_filled(const uint8_t *values, int32_t width, int32_t row)
-{
-    for (int32_t col = 0; col < width; col++)
-    {
-        if (!matrix_get(values, width, row, col))
-        {
-            return 0;
-        }
-    }
-    return 1;
-}
-
-/**
- * @brief - Finds lines on the board that are filled and populates an array containing height elements with 1 or 0. 1 indicates that the line (row) is filled while 0 indicates empty. It returns the number of filled lines.
- *
- * @param values - array containing board data
- * @param width - width of the board
- * @param height - height of the board
- * @param linesOut - array of length height that contains the number of filled rows
+ * @param game - pointer to GameState holding the board to be checked
  * @return int32_t - number of filled lines
  */
-int32_t find_lines(const uint8_t *values, int32_t width, int32_t height, uint8_t *linesOut)
+template <typename Game>
+int32_t find_lines(Game *game)
 {
+    typedef RowKernel<Game::BOARD_WIDTH, typename Game::RowMask> Kernel;
     int32_t count = 0;
-    for (int32_t row = 0; row < height; row++)
+    for (int32_t row = 0; row < Game::BOARD_HEIGHT; row++)
     {
-        uint8_t filled = check_row_filled(values, width, row);
-        linesOut[row] = filled;
+        uint8_t filled = Kernel::filled(game->rows[row]);
+        game->lines[row] = filled;
         count += filled;
     }
     return count;
 }
 
 /**
- * @brief Clears the filled lines by copying the filled lines from the source matrix to the destination matrix
+ * @brief Clears the filled lines marked in game->lines by moving the remaining rows of the board (and their occupancy masks) down
  *
- * @param values - array containing board information
- * @param width - width of the board
- * @param height - height of the board
- * @param lines - array containing number of filled lines
+ * @param game - pointer to GameState holding the board to be cleared
  */
-void clear_lines(const uint8_t *values, int32_t width, int32_t height, const uint8_t *lines)
+template <typename Game>
+void clear_lines(Game *game)
 {
-    int32_t srcRow = height - 1;
-    for (int32_t destRow = height - 1; destRow >= 0; destRow--)
+    typedef RowKernel<Game::BOARD_WIDTH, typename Game::RowMask> Kernel;
+    const int32_t width = Game::BOARD_WIDTH;
+    int32_t srcRow = Game::BOARD_HEIGHT - 1;
+    for (int32_t destRow = Game::BOARD_HEIGHT - 1; destRow >= 0; destRow--)
     {
 
         // Decrementing srcRow as long as the lines[srcRow] is filled (i.e 1)
-        while (srcRow > 0 && lines[srcRow])
+        while (srcRow > 0 && game->lines[srcRow])
         {
             srcRow--;
         }
         if (srcRow < 0)
         {
-            memset((uint8_t *)values + destRow * width, 0, width);
+            memset(game->board + destRow * width, 0, width);
+            Kernel::clear(game->rows[destRow]);
         }
         else
         {
-            memcpy((uint8_t *)values + destRow * width, values + srcRow * width, width);
+            memcpy(game->board + destRow * width, game->board + srcRow * width, width);
+            game->rows[destRow] = game->rows[srcRow];
             srcRow--;
         }
     }
@@ -361,7 +602,8 @@ inline int32_t get_lines_for_next_level(int32_t startLevel, int32_t currentLevel
  * @param game - a pointer to GameState that stores the current information about the game
  * @param input - a pointer to InputState that holds the current input from the user 
  */
-void update_game_start(GameState *game, const InputState* input){
+template <typename Game>
+void update_game_start(Game *game, const InputState* input){
     if(input->deltaUp > 0){
         game->startLevel++;
     }
@@ -372,12 +614,14 @@ void update_game_start(GameState *game, const InputState* input){
 
     if(input->deltaA > 0){
         // Reset the game state and set the game phase to PLAY
-        memset(game->board, 0, WIDTH * HEIGHT);
+        memset(game->board, 0, sizeof(game->board));
+        memset(game->rows, 0, sizeof(game->rows));
         game->level = game->startLevel;
         game->score = 0;
         game->lineCount = 0;
         spawn_piece(game);
         game->phase = GAME_PHASE_PLAY;
+        add_telemetry(&get_telemetry_counters()->gamesStarted);
     }
 }
 
@@ -387,7 +631,8 @@ void update_game_start(GameState *game, const InputState* input){
  * @param game - a pointer to GameState that stores the current information about the game
  * @param input - a pointer to InputState that holds the current input from the user
  */
-void update_game_gameover(GameState *game, const InputState* input){
+template <typename Game>
+void update_game_gameover(Game *game, const InputState* input){
     if(input->deltaA > 0){
         game->phase = GAME_PHASE_START;
     }
@@ -398,11 +643,15 @@ void update_game_gameover(GameState *game, const InputState* input){
  *
  * @param game - a pointer to GameState that stores the current information about the game
  */
-void update_game_line(GameState *game)
+template <typename Game>
+void update_game_line(Game *game)
 {
-    if (game->time >= game->highlightEndTime)
+    TelemetryCounters *telemetry = get_telemetry_counters();
+    add_telemetry(&telemetry->playFrames);
+    if (game->frame >= game->highlightEndFrame)
     {
-        clear_lines(game->board, WIDTH, HEIGHT, game->lines);
+        clear_lines(game);
+        add_telemetry(&telemetry->lineClears[min(game->pendingLineCount, 4) - 1]);
 
         game->lineCount += game->pendingLineCount;
         game->score += compute_score(game->level, game->pendingLineCount);
@@ -412,40 +661,25 @@ void update_game_line(GameState *game)
         if (game->lineCount >= linesForNextLevel)
         {
             game->level++;
+            add_telemetry(&telemetry->levelUps);
         }
 
         game->phase = GAME_PHASE_PLAY;
     }
 }
 
-/**
- * @brief - Checks whether the row is empty.
- *
- * @param values - array containing board data
- * @param width - width of the board
- * @param row - number of rows in the board
- * @return uint8_t - 1 indicates filled while 0 indicates empty
- */
-inline uint8_t check_row_empty(const uint8_t *values, int32_t width, int32_t row)
-{
-    for (int32_t col = 0; col < width; col++)
-    {
-        if (matrix_get(values, width, row, col))
-        {
-            return 0;
-        }
-    }
-    return 1;
-}
-
 /**
  * @brief Implements the algorithm for the game phase - GAME_PHASE_PLAY. Updates the game state by validating the game moves and then, setting them on the board
  *
  * @param game - Pointer to GameState that holds the current state of the game
  * @param input - Pointer to InputState that holds the current input from the user
  */
-void update_game_play(GameState *game, const InputState *input)
+template <typename Game>
+void update_game_play(Game *game, const InputState *input)
 {
+    typedef RowKernel<Game::BOARD_WIDTH, typename Game::RowMask> Kernel;
+    TelemetryCounters *telemetry = get_telemetry_counters();
+    add_telemetry(&telemetry->playFrames);
     PieceState piece = game->piece;
 
     // Processing key press
@@ -457,21 +691,28 @@ void update_game_play(GameState *game, const InputState *input)
     {
         piece.offsetCol++;
     }
-    if (input->deltaUp > 0)
-    {
-        piece.rotation = (piece.rotation + 1) % 4;
-    }
 
     // Copy valid piece into the game to update the game's state
-    if (check_piece_valid(&piece, game->board, WIDTH, HEIGHT))
+    if (check_piece_valid(&piece, game))
     {
         game->piece = piece;
     }
 
+    // Rotation after the move, kicked to the first offset that fits
+    if (input->deltaUp > 0)
+    {
+        rotate_piece(&game->piece, ROTATION_CW, game);
+    }
+    if (input->deltaB > 0)
+    {
+        rotate_piece(&game->piece, ROTATION_CCW, game);
+    }
+
     // Soft drop every time down arrow key is pressed
     if (input->deltaDown > 0)
     {
         soft_drop(game);
+        add_telemetry(&telemetry->softDrops);
     }
 
     // Hard drop
@@ -479,26 +720,28 @@ void update_game_play(GameState *game, const InputState *input)
     {
         while (soft_drop(game))
             ;
+        add_telemetry(&telemetry->hardDrops);
     }
 
     // Soft drop
-    while (game->time >= game->nextDropTime)
+    while (game->frame >= game->nextDropFrame)
     {
         soft_drop(game);
     }
 
-    game->pendingLineCount = find_lines(game->board, WIDTH, HEIGHT, game->lines);
+    game->pendingLineCount = find_lines(game);
     if (game->pendingLineCount > 0)
     {
         game->phase = GAME_PHASE_LINE;
-        game->highlightEndTime = game->time + 0.5; // highlight end time is 500 ms
+        game->highlightEndFrame = game->frame + LINE_HIGHLIGHT_FRAMES;
     }
 
     // Game over when tetrominos are in the two hidden rows at the top of the board
     int32_t gameOverRow = 0;
-    if (!check_row_empty(game->board, WIDTH, gameOverRow))
+    if (!Kernel::empty(game->rows[gameOverRow]))
     {
         game->phase = GAME_PHASE_GAMEOVER;
+        add_telemetry(&telemetry->gameOvers[min(game->level, TELEMETRY_LEVELS - 1)]);
     }
 }
 
@@ -508,7 +751,8 @@ void update_game_play(GameState *game, const InputState *input)
  * @param game - Pointer to GameState holding information about the current state of the game
  * @param input - Pointer to InputState holding information about the last input recieved from the user
  */
-void update_game(GameState *game, const InputState *input)
+template <typename Game>
+void update_game(Game *game, const InputState *input)
 {
     switch (game->phase)
     {
@@ -525,4 +769,27 @@ void update_game(GameState *game, const InputState *input)
         update_game_gameover(game, input);
         break;
     }
-}
\ No newline at end of file
+}
+
+/*
+Explicit instantiations of the engine for the board sizes declared in tetris.h
+*/
+#define INSTANTIATE_ENGINE(Game)                                                                                         \
+    template bool check_mask_valid<Game>(const PieceMask *mask, int32_t offsetRow, int32_t offsetCol, const Game *game); \
+    template bool check_piece_valid<Game>(const PieceState *piece, const Game *game);                                    \
+    template bool rotate_piece<Game>(PieceState *piece, RotationDirection direction, const Game *game);                  \
+    template void merge_piece<Game>(Game *game);                                                                         \
+    template void spawn_piece<Game>(Game *game);                                                                         \
+    template bool soft_drop<Game>(Game *game);                                                                           \
+    template int32_t find_lines<Game>(Game *game);                                                                       \
+    template void clear_lines<Game>(Game *game);                                                                         \
+    template void update_game_start<Game>(Game *game, const InputState *input);                                          \
+    template void update_game_line<Game>(Game *game);                                                                    \
+    template void update_game_gameover<Game>(Game *game, const InputState *input);                                       \
+    template void update_game_play<Game>(Game *game, const InputState *input);                                           \
+    template void update_game<Game>(Game *game, const InputState *input);
+
+INSTANTIATE_ENGINE(GameState)
+INSTANTIATE_ENGINE(GameState10)
+INSTANTIATE_ENGINE(GameState40)
+INSTANTIATE_ENGINE(GameState80)
@@ -0,0 +1,417 @@
+#include <climits>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "../inc/vec_env.h"
+#include "../inc/replay.h"
+
+#define VEC_ENV_WAIT_TIMEOUT_NS 100000000 // Sleeps are bounded so a peer that died is noticed
+
+// Function Prototypes
+inline uint64_t align_offset(uint64_t offset);
+static void wake_sequence(std::atomic<uint32_t> *sequence);
+static bool wait_sequence(VecEnv *env, std::atomic<uint32_t> *sequence, uint32_t step);
+static uint32_t next_seed(VecEnvHost *host);
+static void reset_host_game(VecEnvHost *host, uint32_t index);
+static void fill_observation(const GameState *game, uint32_t frame, VecObservation *observation);
+
+/**
+ * @brief Rounds an offset of the shared memory up to a cache line
+ *
+ * @param offset - offset to be rounded
+ * @return uint64_t - multiple of 64
+ */
+inline uint64_t align_offset(uint64_t offset)
+{
+    return (offset + 63) & ~static_cast<uint64_t>(63);
+}
+
+/**
+ * @brief Wakes every process sleeping on a sequence word
+ *
+ * @param sequence - sequence word in the shared memory
+ */
+static void wake_sequence(std::atomic<uint32_t> *sequence)
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(sequence), FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+/**
+ * @brief Waits until a sequence word counts past step. Spins first, since the peer
+ * usually answers within microseconds, then sleeps on the word.
+ *
+ * @param env - pointer to VecEnv holding the word
+ * @param sequence - sequence word in the shared memory
+ * @param step - step to wait for
+ * @return true - the sequence counted past step
+ * @return false - the environment was shut down
+ */
+static bool wait_sequence(VecEnv *env, std::atomic<uint32_t> *sequence, uint32_t step)
+{
+    for (uint32_t spin = 0;; spin++)
+    {
+        uint32_t value = sequence->load(std::memory_order_acquire);
+        if (static_cast<int32_t>(value - step) > 0)
+        {
+            return true;
+        }
+        if (env->header->shutdown.load(std::memory_order_relaxed))
+        {
+            return false;
+        }
+        if (spin >= VEC_ENV_SPIN_COUNT)
+        {
+            timespec timeout = {0, VEC_ENV_WAIT_TIMEOUT_NS};
+            syscall(SYS_futex, reinterpret_cast<uint32_t *>(sequence), FUTEX_WAIT, value, &timeout, NULL, 0);
+        }
+    }
+}
+
+/**
+ * @brief Creates the shared memory object of an environment, replacing a stale one
+ * with the same name
+ *
+ * @param env - pointer to VecEnv to be created
+ * @param name - name of the shared memory object, starting with /
+ * @param envCount - number of games stepped together
+ * @param ringSize - number of observation and action slots
+ * @param frameSkip - frames each action is held for
+ * @return true - environment created
+ * @return false - the shared memory could not be created or mapped
+ */
+bool create_vec_env(VecEnv *env, const char *name, uint32_t envCount, uint32_t ringSize, uint32_t frameSkip)
+{
+    env->header = NULL;
+    uint64_t observationOffset = align_offset(sizeof(VecEnvHeader));
+    uint64_t actionOffset = align_offset(observationOffset + static_cast<uint64_t>(ringSize) * envCount * sizeof(VecObservation));
+    uint64_t size = align_offset(actionOffset + static_cast<uint64_t>(ringSize) * envCount);
+
+    int32_t fd = shm_open(name, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0)
+    {
+        return false;
+    }
+    void *mapping = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(size)) == 0)
+    {
+        mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        shm_unlink(name);
+        return false;
+    }
+
+    env->header = static_cast<VecEnvHeader *>(mapping);
+    env->size = size;
+    env->observations = reinterpret_cast<VecObservation *>(static_cast<uint8_t *>(mapping) + observationOffset);
+    env->actions = static_cast<uint8_t *>(mapping) + actionOffset;
+
+    VecEnvHeader *header = env->header;
+    header->version = VEC_ENV_VERSION;
+    header->envCount = envCount;
+    header->ringSize = ringSize;
+    header->boardWidth = GameState::BOARD_WIDTH;
+    header->boardHeight = GameState::BOARD_HEIGHT;
+    header->observationSize = sizeof(VecObservation);
+    header->frameSkip = frameSkip;
+    header->observationOffset = observationOffset;
+    header->actionOffset = actionOffset;
+    header->observationSequence.store(0);
+    header->actionSequence.store(0);
+    header->shutdown.store(0);
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = VEC_ENV_MAGIC;
+    return true;
+}
+
+/**
+ * @brief Maps the shared memory of an environment created by a host process
+ *
+ * @param env - pointer to VecEnv to be attached
+ * @param name - name of the shared memory object
+ * @return true - environment attached
+ * @return false - no environment of this engine exists under that name
+ */
+bool attach_vec_env(VecEnv *env, const char *name)
+{
+    env->header = NULL;
+    int32_t fd = shm_open(name, O_RDWR, 0600);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat status;
+    void *mapping = MAP_FAILED;
+    if (fstat(fd, &status) == 0 && status.st_size >= static_cast<off_t>(sizeof(VecEnvHeader)))
+    {
+        mapping = mmap(NULL, static_cast<size_t>(status.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+
+    env->header = static_cast<VecEnvHeader *>(mapping);
+    env->size = static_cast<size_t>(status.st_size);
+    VecEnvHeader *header = env->header;
+    if (header->magic != VEC_ENV_MAGIC || header->version != VEC_ENV_VERSION ||
+        header->boardWidth != GameState::BOARD_WIDTH || header->boardHeight != GameState::BOARD_HEIGHT ||
+        header->observationSize != sizeof(VecObservation) ||
+        header->actionOffset + static_cast<uint64_t>(header->ringSize) * header->envCount > env->size)
+    {
+        close_vec_env(env);
+        return false;
+    }
+
+    env->observations = reinterpret_cast<VecObservation *>(static_cast<uint8_t *>(mapping) + header->observationOffset);
+    env->actions = static_cast<uint8_t *>(mapping) + header->actionOffset;
+    return true;
+}
+
+/**
+ * @brief Unmaps the shared memory. The object itself stays until unlink_vec_env().
+ *
+ * @param env - pointer to VecEnv to be closed
+ */
+void close_vec_env(VecEnv *env)
+{
+    if (env->header)
+    {
+        munmap(env->header, env->size);
+    }
+    env->header = NULL;
+}
+
+/**
+ * @brief Removes the shared memory object, processes that mapped it keep their mapping
+ *
+ * @param name - name of the shared memory object
+ */
+void unlink_vec_env(const char *name)
+{
+    shm_unlink(name);
+}
+
+/**
+ * @brief Returns the observations of a step, one per game
+ *
+ * @param env - pointer to VecEnv holding the ring
+ * @param step - step of the observations
+ * @return VecObservation* - envCount observations
+ */
+VecObservation *get_observations(VecEnv *env, uint32_t step)
+{
+    return env->observations + static_cast<size_t>(step % env->header->ringSize) * env->header->envCount;
+}
+
+/**
+ * @brief Returns the actions answering the observations of a step, one per game
+ *
+ * @param env - pointer to VecEnv holding the ring
+ * @param step - step of the observations being answered
+ * @return uint8_t* - envCount packed InputKey bits
+ */
+uint8_t *get_actions(VecEnv *env, uint32_t step)
+{
+    return env->actions + static_cast<size_t>(step % env->header->ringSize) * env->header->envCount;
+}
+
+/**
+ * @brief Host side: publishes the observations of a step and wakes the trainer
+ *
+ * @param env - pointer to VecEnv shared with the trainer
+ * @param step - step whose observations were written
+ */
+void publish_observations(VecEnv *env, uint32_t step)
+{
+    env->header->observationSequence.store(step + 1, std::memory_order_release);
+    wake_sequence(&env->header->observationSequence);
+}
+
+/**
+ * @brief Trainer side: waits for the observations of a step
+ *
+ * @param env - pointer to VecEnv shared with the host
+ * @param step - step to wait for
+ * @return true - observations published
+ * @return false - the environment was shut down
+ */
+bool wait_observations(VecEnv *env, uint32_t step)
+{
+    return wait_sequence(env, &env->header->observationSequence, step);
+}
+
+/**
+ * @brief Trainer side: submits the actions answering a step and wakes the host
+ *
+ * @param env - pointer to VecEnv shared with the host
+ * @param step - step whose actions were written
+ */
+void submit_actions(VecEnv *env, uint32_t step)
+{
+    env->header->actionSequence.store(step + 1, std::memory_order_release);
+    wake_sequence(&env->header->actionSequence);
+}
+
+/**
+ * @brief Host side: waits for the actions answering a step
+ *
+ * @param env - pointer to VecEnv shared with the trainer
+ * @param step - step to wait for
+ * @return true - actions submitted
+ * @return false - the environment was shut down
+ */
+bool wait_actions(VecEnv *env, uint32_t step)
+{
+    return wait_sequence(env, &env->header->actionSequence, step);
+}
+
+/**
+ * @brief Stops both sides of the environment
+ *
+ * @param env - pointer to VecEnv to be shut down
+ */
+void shutdown_vec_env(VecEnv *env)
+{
+    env->header->shutdown.store(1, std::memory_order_release);
+    wake_sequence(&env->header->observationSequence);
+    wake_sequence(&env->header->actionSequence);
+}
+
+/**
+ * @brief Draws the seed of a new game
+ *
+ * @param host - pointer to VecEnvHost holding the generator
+ * @return uint32_t - seed
+ */
+static uint32_t next_seed(VecEnvHost *host)
+{
+    host->randomState ^= host->randomState << 13;
+    host->randomState ^= host->randomState >> 17;
+    host->randomState ^= host->randomState << 5;
+    return host->randomState;
+}
+
+/**
+ * @brief Starts a new game at its starting level, skipping the start screen
+ *
+ * @param host - pointer to VecEnvHost owning the game
+ * @param index - index of the game
+ */
+static void reset_host_game(VecEnvHost *host, uint32_t index)
+{
+    GameState *game = &host->games[index];
+    init_replay_game(game, next_seed(host));
+
+    InputState start = {};
+    start.a = 1;
+    start.deltaA = 1;
+    update_game(game, &start);
+
+    host->inputs[index] = {};
+    host->frames[index] = 0;
+}
+
+/**
+ * @brief Writes the state of a game into its observation
+ *
+ * @param game - pointer to GameState of the game
+ * @param frame - frames since the game was reset
+ * @param observation - pointer to VecObservation to be filled, deltas and done are left as they are
+ */
+static void fill_observation(const GameState *game, uint32_t frame, VecObservation *observation)
+{
+    observation->score = game->score;
+    observation->level = game->level;
+    observation->lineCount = game->lineCount;
+    observation->frame = frame;
+    observation->piece = game->piece;
+    observation->phase = static_cast<uint8_t>(game->phase);
+    memcpy(observation->rows, game->rows, sizeof(observation->rows));
+}
+
+/**
+ * @brief Starts a new game in every slot of a host whose environment was created
+ *
+ * @param host - pointer to VecEnvHost with env created
+ * @param seed - seed of the generator of game seeds
+ */
+void init_vec_env_host(VecEnvHost *host, uint32_t seed)
+{
+    uint32_t envCount = host->env.header->envCount;
+    host->games.resize(envCount);
+    host->inputs.resize(envCount);
+    host->frames.resize(envCount);
+    host->randomState = seed ? seed : 0x9E3779B9;
+    for (uint32_t i = 0; i < envCount; i++)
+    {
+        reset_host_game(host, i);
+    }
+}
+
+/**
+ * @brief Steps the games in lockstep with the trainer until the environment is shut down.
+ * Each step holds the submitted keys for frameSkip frames. A game going over is reported
+ * with done set and restarted in the same step.
+ *
+ * @param host - pointer to VecEnvHost to be run
+ * @return uint32_t - number of steps run
+ */
+uint32_t run_vec_env_host(VecEnvHost *host)
+{
+    VecEnv *env = &host->env;
+    uint32_t envCount = env->header->envCount;
+    uint32_t frameSkip = env->header->frameSkip;
+
+    VecObservation *observations = get_observations(env, 0);
+    for (uint32_t i = 0; i < envCount; i++)
+    {
+        observations[i] = {};
+        fill_observation(&host->games[i], host->frames[i], &observations[i]);
+    }
+    publish_observations(env, 0);
+
+    uint32_t step = 0;
+    while (wait_actions(env, step))
+    {
+        const uint8_t *actions = get_actions(env, step);
+        observations = get_observations(env, step + 1);
+        for (uint32_t i = 0; i < envCount; i++)
+        {
+            GameState *game = &host->games[i];
+            int32_t score = game->score;
+            int32_t level = game->level;
+            int32_t lineCount = game->lineCount;
+
+            bool done = false;
+            for (uint32_t frame = 0; frame < frameSkip && !done; frame++)
+            {
+                apply_input_keys(&host->inputs[i], actions[i]);
+                host->frames[i]++;
+                game->frame = host->frames[i];
+                update_game(game, &host->inputs[i]);
+                done = game->phase == GAME_PHASE_GAMEOVER;
+            }
+
+            VecObservation *observation = &observations[i];
+            observation->scoreDelta = game->score - score;
+            observation->levelDelta = game->level - level;
+            observation->lineDelta = game->lineCount - lineCount;
+            observation->done = done;
+            if (done)
+            {
+                reset_host_game(host, i);
+            }
+            fill_observation(game, host->frames[i], observation);
+        }
+        publish_observations(env, ++step);
+    }
+    return step;
+}
@@ -0,0 +1,195 @@
+#include <type_traits>
+#include "../inc/versus.h"
+#include "../inc/replay.h"
+#include "../inc/protocol.h"
+
+static_assert(std::is_trivially_copyable<VersusState>::value, "matches are saved and restored as raw bytes");
+static_assert(VERSUS_GARBAGE_CELL < ARRAY_COUNT(BASE_COLORS), "garbage cells have a color");
+
+// Function Prototypes
+static void add_garbage_rows(VersusState *versus, int32_t player);
+inline uint64_t hash_versus_bytes(uint64_t hash, const void *data, size_t size);
+inline uint64_t hash_versus_value(uint64_t hash, int64_t value);
+
+/**
+ * @brief Starts a match. Both games leave their start screen on frame 0 with the same seed.
+ *
+ * @param versus - pointer to VersusState to be initialised
+ * @param seed - seed of the pieces of both games and of the garbage holes
+ */
+void init_versus(VersusState *versus, uint32_t seed)
+{
+    *versus = {};
+    versus->randomState = seed ^ 0xA5A5A5A5u;
+    versus->winner = VERSUS_NO_WINNER;
+
+    InputState input = {};
+    input.a = 1;
+    input.deltaA = 1;
+    for (int32_t player = 0; player < VERSUS_PLAYERS; player++)
+    {
+        init_replay_game(&versus->games[player], seed ? seed : 1);
+        update_game(&versus->games[player], &input);
+    }
+}
+
+/**
+ * @brief Pushes the pending garbage of a player up from the bottom of its board. A player
+ * whose stack is pushed into the hidden rows or into its piece tops out.
+ *
+ * @param versus - pointer to the match
+ * @param player - index of the player receiving the garbage
+ */
+static void add_garbage_rows(VersusState *versus, int32_t player)
+{
+    const int32_t width = GameState::BOARD_WIDTH;
+    const int32_t height = GameState::BOARD_HEIGHT;
+    GameState *game = &versus->games[player];
+    int32_t count = versus->pendingGarbage[player];
+    count = count > height ? height : count;
+    versus->pendingGarbage[player] = 0;
+
+    uint32_t x = versus->randomState ? versus->randomState : 0x9E3779B9u;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    versus->randomState = x;
+    int32_t hole = static_cast<int32_t>(x % width);
+
+    bool toppedOut = false;
+    for (int32_t row = 0; row < count; row++)
+    {
+        toppedOut = toppedOut || game->rows[row] != 0;
+    }
+    memmove(game->board, game->board + count * width, (height - count) * width);
+    memmove(game->rows, game->rows + count, (height - count) * sizeof(game->rows[0]));
+    for (int32_t row = height - count; row < height; row++)
+    {
+        memset(game->board + row * width, VERSUS_GARBAGE_CELL, width);
+        game->board[row * width + hole] = 0;
+        game->rows[row] = static_cast<GameState::RowMask>(((1u << width) - 1) & ~(1u << hole));
+    }
+
+    if (toppedOut || !check_piece_valid(&game->piece, game) || game->rows[0] != 0)
+    {
+        game->phase = GAME_PHASE_GAMEOVER;
+    }
+}
+
+/**
+ * @brief Steps both games of a match by one frame, exchanging garbage. Nothing changes
+ * but the frame once the match has a winner.
+ *
+ * @param versus - pointer to the match
+ * @param keys - packed InputKey bits held by each player during the frame
+ */
+void step_versus(VersusState *versus, const uint8_t *keys)
+{
+    versus->frame++;
+    if (versus->winner != VERSUS_NO_WINNER)
+    {
+        return;
+    }
+
+    for (int32_t player = 0; player < VERSUS_PLAYERS; player++)
+    {
+        GameState *game = &versus->games[player];
+        GamePhase prevPhase = game->phase;
+        int32_t prevLineCount = game->lineCount;
+        GameState::RowMask prevRows[GameState::BOARD_HEIGHT];
+        memcpy(prevRows, game->rows, sizeof(prevRows));
+
+        apply_input_keys(&versus->inputs[player], keys[player]);
+        game->frame = versus->frame;
+        update_game(game, &versus->inputs[player]);
+
+        // Cleared lines first cancel the garbage coming in, the rest goes to the opponent
+        int32_t cleared = game->lineCount - prevLineCount;
+        int32_t attack = VERSUS_GARBAGE_LINES[cleared < 4 ? cleared : 4];
+        int32_t cancelled = attack < versus->pendingGarbage[player] ? attack : versus->pendingGarbage[player];
+        versus->pendingGarbage[player] -= cancelled;
+        versus->pendingGarbage[1 - player] += attack - cancelled;
+
+        // Garbage rises once a piece has locked and the next one spawned
+        bool spawned = game->phase == GAME_PHASE_PLAY &&
+                       (prevPhase == GAME_PHASE_LINE || memcmp(prevRows, game->rows, sizeof(prevRows)) != 0);
+        if (spawned && versus->pendingGarbage[player] > 0)
+        {
+            add_garbage_rows(versus, player);
+        }
+    }
+
+    bool over[VERSUS_PLAYERS];
+    for (int32_t player = 0; player < VERSUS_PLAYERS; player++)
+    {
+        over[player] = versus->games[player].phase == GAME_PHASE_GAMEOVER;
+    }
+    if (over[0] || over[1])
+    {
+        versus->winner = over[0] && over[1] ? VERSUS_DRAW : (over[0] ? 1 : 0);
+    }
+}
+
+/**
+ * @brief Mixes bytes into a hash (FNV-1a)
+ *
+ * @param hash - running hash
+ * @param data - bytes to be mixed in
+ * @param size - number of bytes
+ * @return uint64_t - updated hash
+ */
+inline uint64_t hash_versus_bytes(uint64_t hash, const void *data, size_t size)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+/**
+ * @brief Mixes an integer into a hash
+ *
+ * @param hash - running hash
+ * @param value - value to be mixed in
+ * @return uint64_t - updated hash
+ */
+inline uint64_t hash_versus_value(uint64_t hash, int64_t value)
+{
+    return hash_versus_bytes(hash, &value, sizeof(value));
+}
+
+/**
+ * @brief Hashes everything that decides the rest of a match, field by field so padding
+ * bytes never make two equal matches differ. Peers compare it to detect a desync.
+ *
+ * @param versus - pointer to the match
+ * @return uint64_t - hash of the match
+ */
+uint64_t hash_versus_state(const VersusState *versus)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (int32_t player = 0; player < VERSUS_PLAYERS; player++)
+    {
+        const GameState *game = &versus->games[player];
+        const InputState *input = &versus->inputs[player];
+        hash = hash_versus_bytes(hash, game->board, sizeof(game->board));
+        hash = hash_versus_value(hash, game->piece.tetrominoIndex);
+        hash = hash_versus_value(hash, game->piece.offsetRow);
+        hash = hash_versus_value(hash, game->piece.offsetCol);
+        hash = hash_versus_value(hash, game->piece.rotation);
+        hash = hash_versus_value(hash, game->phase);
+        hash = hash_versus_value(hash, game->level);
+        hash = hash_versus_value(hash, game->lineCount);
+        hash = hash_versus_value(hash, game->score);
+        hash = hash_versus_value(hash, game->nextDropFrame);
+        hash = hash_versus_value(hash, game->highlightEndFrame);
+        hash = hash_versus_value(hash, game->randomState);
+        hash = hash_versus_value(hash, pack_input_keys(input));
+        hash = hash_versus_value(hash, versus->pendingGarbage[player]);
+    }
+    hash = hash_versus_value(hash, versus->frame);
+    hash = hash_versus_value(hash, versus->randomState);
+    return hash_versus_value(hash, versus->winner);
+}
@@ -0,0 +1,302 @@
+#include <cerrno>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "../inc/protocol.h"
+#include "../inc/spectator.h"
+
+/*
+Load generator for tetris_server. Every connection plays one game by pressing random
+keys at 60 frames per second over loopback and counts the state frames it receives.
+Optionally every game is also watched by spectators that decode the delta stream and
+acknowledge the frames they decoded.
+
+Usage: tetris_client [sessions] [seconds] [port] [spectators per session] [spectator port]
+*/
+
+const uint32_t BOARD_SIZE = GameState::BOARD_WIDTH * GameState::BOARD_HEIGHT;
+
+struct Connection
+{
+    int32_t fd;
+    bool spectator;
+    uint32_t sessionId;
+    SpectatorView *view; // Reconstructed game of a spectator
+    uint64_t bytes;
+    uint8_t keys;
+    std::vector<uint8_t> pending; // Received bytes not yet parsed into messages
+    uint64_t frames;
+    uint64_t boards;
+    int32_t score;
+};
+
+/**
+ * @brief Gets the monotonic clock in seconds
+ *
+ * @return double - current monotonic time
+ */
+double get_seconds()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Parses every complete StateMessage received on the connection
+ *
+ * @param connection - connection whose received bytes are parsed
+ * @return true - stream is well formed
+ * @return false - unexpected message type
+ */
+bool parse_messages(Connection *connection)
+{
+    size_t offset = 0;
+    while (connection->pending.size() - offset >= sizeof(WelcomeMessage))
+    {
+        if (connection->pending[offset] == MESSAGE_WELCOME)
+        {
+            WelcomeMessage welcome;
+            memcpy(&welcome, connection->pending.data() + offset, sizeof(welcome));
+            connection->sessionId = welcome.sessionId;
+            offset += sizeof(welcome);
+            continue;
+        }
+        if (connection->pending.size() - offset < sizeof(StateMessage))
+        {
+            break;
+        }
+
+        const StateMessage *message = reinterpret_cast<const StateMessage *>(connection->pending.data() + offset);
+        if (message->type != MESSAGE_STATE)
+        {
+            return false;
+        }
+        size_t length = sizeof(StateMessage) + (message->boardIncluded ? BOARD_SIZE : 0);
+        if (connection->pending.size() - offset < length)
+        {
+            break;
+        }
+        connection->frames++;
+        connection->boards += message->boardIncluded;
+        connection->score = message->score;
+        offset += length;
+    }
+    connection->pending.erase(connection->pending.begin(), connection->pending.begin() + offset);
+    return true;
+}
+
+/**
+ * @brief Decodes every complete spectator packet received on the connection and
+ * acknowledges the newest decoded frame
+ *
+ * @param connection - spectator connection whose received bytes are decoded
+ * @return true - stream is well formed
+ * @return false - malformed packet or unknown base frame
+ */
+bool decode_packets(Connection *connection)
+{
+    size_t offset = 0;
+    uint32_t lastFrame = connection->view->frame;
+    while (offset < connection->pending.size())
+    {
+        int32_t length = decode_spectator_packet(connection->view, connection->pending.data() + offset,
+                                                 static_cast<uint32_t>(connection->pending.size() - offset));
+        if (length < 0)
+        {
+            return false;
+        }
+        if (length == 0)
+        {
+            break;
+        }
+        connection->frames++;
+        offset += length;
+    }
+    connection->pending.erase(connection->pending.begin(), connection->pending.begin() + offset);
+    connection->score = connection->view->score;
+
+    if (connection->view->frame != lastFrame)
+    {
+        AckMessage ack = {};
+        ack.type = MESSAGE_ACK;
+        ack.frame = connection->view->frame;
+        send(connection->fd, &ack, sizeof(ack), MSG_NOSIGNAL);
+    }
+    return true;
+}
+
+/**
+ * @brief Connects to the server over loopback and registers the connection with epoll
+ *
+ * @param epollFd - epoll instance
+ * @param connection - connection to be opened
+ * @param port - port of the server
+ * @return true - connected
+ * @return false - connection failed
+ */
+bool open_connection(int32_t epollFd, Connection *connection, uint16_t port)
+{
+    connection->fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    if (connect(connection->fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0)
+    {
+        return false;
+    }
+
+    int32_t enable = 1;
+    setsockopt(connection->fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.ptr = connection;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, connection->fd, &event);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int32_t sessionCount = argc > 1 ? atoi(argv[1]) : 100;
+    double seconds = argc > 2 ? atof(argv[2]) : 5.0;
+    uint16_t port = static_cast<uint16_t>(argc > 3 ? atoi(argv[3]) : DEFAULT_SERVER_PORT);
+    int32_t spectatorsPerSession = argc > 4 ? atoi(argv[4]) : 0;
+    uint16_t spectatorPort = static_cast<uint16_t>(argc > 5 ? atoi(argv[5]) : port + 1);
+
+    // Players first, spectators after them, the vector never reallocates
+    int32_t spectatorCount = sessionCount * spectatorsPerSession;
+    int32_t epollFd = epoll_create1(0);
+    std::vector<Connection> connections(sessionCount + spectatorCount);
+    for (int32_t i = 0; i < sessionCount; i++)
+    {
+        if (!open_connection(epollFd, &connections[i], port))
+        {
+            cerr << "Could not connect session " << i << ": " << strerror(errno) << endl;
+            return 1;
+        }
+    }
+
+    // Spectators need the session ids from the welcome messages
+    for (int32_t i = 0; i < sessionCount; i++)
+    {
+        Connection *player = &connections[i];
+        while (player->sessionId == 0)
+        {
+            uint8_t welcome[sizeof(WelcomeMessage)];
+            if (recv(player->fd, welcome, sizeof(welcome), MSG_WAITALL) != sizeof(welcome) || welcome[0] != MESSAGE_WELCOME)
+            {
+                cerr << "No welcome for session " << i << endl;
+                return 1;
+            }
+            memcpy(&player->sessionId, welcome + 1, sizeof(player->sessionId));
+        }
+
+        for (int32_t j = 0; j < spectatorsPerSession; j++)
+        {
+            Connection *connection = &connections[sessionCount + i * spectatorsPerSession + j];
+            connection->spectator = true;
+            connection->sessionId = player->sessionId;
+            connection->view = new SpectatorView();
+            if (!open_connection(epollFd, connection, spectatorPort))
+            {
+                cerr << "Could not connect spectator: " << strerror(errno) << endl;
+                return 1;
+            }
+
+            SubscribeMessage subscribe = {};
+            subscribe.type = MESSAGE_SUBSCRIBE;
+            subscribe.sessionId = player->sessionId;
+            send(connection->fd, &subscribe, sizeof(subscribe), MSG_NOSIGNAL);
+        }
+    }
+
+    srand(static_cast<uint32_t>(time(NULL)));
+    double start = get_seconds();
+    double nextFrame = start;
+    epoll_event events[256];
+    uint8_t buffer[65536];
+
+    while (get_seconds() - start < seconds)
+    {
+        double now = get_seconds();
+        if (now >= nextFrame)
+        {
+            // Press A now and then to start (and restart) the game, otherwise random moves
+            for (int32_t i = 0; i < sessionCount; i++)
+            {
+                InputMessage message = {};
+                message.type = MESSAGE_INPUT;
+                message.keys = static_cast<uint8_t>(rand() % 8 == 0 ? rand() & 0x0F : connections[i].keys);
+                if (rand() % 120 == 0)
+                {
+                    message.keys |= INPUT_KEY_A;
+                }
+                connections[i].keys = message.keys & 0x0F;
+                send(connections[i].fd, &message, sizeof(message), MSG_NOSIGNAL);
+            }
+            nextFrame += TARGET_SECONDS_PER_FRAME;
+        }
+
+        int32_t timeout = static_cast<int32_t>((nextFrame - get_seconds()) * 1000);
+        int32_t count = epoll_wait(epollFd, events, 256, timeout > 0 ? timeout : 0);
+        for (int32_t i = 0; i < count; i++)
+        {
+            Connection *connection = static_cast<Connection *>(events[i].data.ptr);
+            ssize_t length = recv(connection->fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+            if (length <= 0)
+            {
+                continue;
+            }
+            connection->bytes += length;
+            connection->pending.insert(connection->pending.end(), buffer, buffer + length);
+            if (!(connection->spectator ? decode_packets(connection) : parse_messages(connection)))
+            {
+                cerr << "Malformed stream" << endl;
+                return 1;
+            }
+        }
+    }
+
+    uint64_t frames = 0;
+    uint64_t boards = 0;
+    uint64_t spectatorFrames = 0;
+    uint64_t spectatorBytes = 0;
+    int32_t bestScore = 0;
+    for (size_t i = 0; i < connections.size(); i++)
+    {
+        if (connections[i].spectator)
+        {
+            spectatorFrames += connections[i].frames;
+            spectatorBytes += connections[i].bytes;
+            delete connections[i].view;
+        }
+        else
+        {
+            frames += connections[i].frames;
+            boards += connections[i].boards;
+            bestScore = connections[i].score > bestScore ? connections[i].score : bestScore;
+        }
+        close(connections[i].fd);
+    }
+
+    double elapsed = get_seconds() - start;
+    cout << sessionCount << " sessions, " << frames << " frames (" << frames / elapsed << " per second), "
+         << boards << " board updates, best score " << bestScore << endl;
+    if (spectatorCount > 0)
+    {
+        cout << spectatorCount << " spectators, " << spectatorFrames << " frames, "
+             << (spectatorFrames ? spectatorBytes / spectatorFrames : 0) << " bytes per frame (a full snapshot is "
+             << sizeof(StateMessage) + BOARD_SIZE << ")" << endl;
+    }
+    return 0;
+}
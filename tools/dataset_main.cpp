@@ -0,0 +1,139 @@
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "../inc/dataset.h"
+
+/*
+Inspects a dataset written by tetris_sweep (TETRIS_DATASET).
+
+Usage: tetris_dataset <file> info
+       tetris_dataset <file> dump [first row] [row count]
+
+info prints the rows, blocks and compressed size of every column. dump prints rows as
+CSV, with the board as one hexadecimal string of DATASET_BOARD_BYTES bytes. Only the
+blocks holding the requested rows are decoded.
+*/
+
+const char *DATASET_COLUMN_NAMES[DATASET_COLUMN_COUNT] = {"board", "tetromino", "rotation", "column",
+                                                          "lines", "score_delta", "game", "piece"};
+
+/**
+ * @brief Prints the size of every column of a dataset
+ *
+ * @param reader - pointer to the open dataset
+ * @return int32_t - 0
+ */
+int32_t print_dataset_info(const DatasetReader *reader)
+{
+    uint64_t rawSizes[DATASET_COLUMN_COUNT] = {};
+    uint64_t encodedSizes[DATASET_COLUMN_COUNT] = {};
+    for (size_t block = 0; block < reader->blocks.size(); block++)
+    {
+        const DatasetBlockHeader *header =
+            reinterpret_cast<const DatasetBlockHeader *>(reader->data + reader->blocks[block].offset);
+        for (uint32_t column = 0; column < DATASET_COLUMN_COUNT; column++)
+        {
+            rawSizes[column] += static_cast<uint64_t>(header->rowCount) * DATASET_COLUMN_WIDTHS[column];
+            encodedSizes[column] += header->chunks[column].size;
+        }
+    }
+
+    cout << reader->rowCount << " rows in " << reader->blocks.size() << " blocks, " << reader->size << " bytes, board "
+         << reader->header->boardWidth << "x" << reader->header->boardHeight << endl;
+    for (uint32_t column = 0; column < DATASET_COLUMN_COUNT; column++)
+    {
+        cout << DATASET_COLUMN_NAMES[column] << ": " << encodedSizes[column] << " of " << rawSizes[column] << " bytes ("
+             << (rawSizes[column] ? 100.0 * encodedSizes[column] / rawSizes[column] : 0.0) << "%)" << endl;
+    }
+    return 0;
+}
+
+/**
+ * @brief Prints rows of a dataset as CSV
+ *
+ * @param reader - pointer to the open dataset
+ * @param first - first row
+ * @param count - number of rows
+ * @return int32_t - 0 if the rows were decoded, 1 otherwise
+ */
+int32_t dump_dataset(const DatasetReader *reader, uint64_t first, uint64_t count)
+{
+    std::vector<uint8_t> columns[DATASET_COLUMN_COUNT];
+    for (uint32_t column = 0; column < DATASET_COLUMN_COUNT; column++)
+    {
+        columns[column].resize(static_cast<size_t>(reader->header->blockRows) * DATASET_COLUMN_WIDTHS[column]);
+    }
+
+    cout << "board,tetromino,rotation,column,lines,score_delta,game,piece" << endl;
+    uint64_t row = first;
+    uint64_t end = first + count < reader->rowCount ? first + count : reader->rowCount;
+    while (row < end)
+    {
+        uint32_t block = find_dataset_block(reader, row);
+        for (uint32_t column = 0; column < DATASET_COLUMN_COUNT; column++)
+        {
+            if (!read_dataset_column(reader, block, static_cast<DatasetColumn>(column), columns[column].data()))
+            {
+                cerr << "Block " << block << " is corrupt" << endl;
+                return 1;
+            }
+        }
+
+        const DatasetIndexEntry *entry = &reader->blocks[block];
+        for (; row < end && row < entry->firstRow + entry->rowCount; row++)
+        {
+            size_t r = static_cast<size_t>(row - entry->firstRow);
+            DatasetSample sample;
+            memcpy(sample.board, &columns[DATASET_COLUMN_BOARD][r * DATASET_BOARD_BYTES], DATASET_BOARD_BYTES);
+            sample.tetrominoIndex = columns[DATASET_COLUMN_TETROMINO][r];
+            sample.rotation = columns[DATASET_COLUMN_ROTATION][r];
+            sample.column = static_cast<int8_t>(columns[DATASET_COLUMN_COLUMN][r]);
+            sample.lineCount = columns[DATASET_COLUMN_LINES][r];
+            memcpy(&sample.scoreDelta, &columns[DATASET_COLUMN_SCORE_DELTA][r * 4], 4);
+            memcpy(&sample.game, &columns[DATASET_COLUMN_GAME][r * 8], 8);
+            memcpy(&sample.piece, &columns[DATASET_COLUMN_PIECE][r * 2], 2);
+
+            const char digits[] = "0123456789abcdef";
+            char board[DATASET_BOARD_BYTES * 2 + 1];
+            for (uint32_t i = 0; i < DATASET_BOARD_BYTES; i++)
+            {
+                board[i * 2] = digits[sample.board[i] >> 4];
+                board[i * 2 + 1] = digits[sample.board[i] & 15];
+            }
+            board[DATASET_BOARD_BYTES * 2] = '\0';
+            cout << board << "," << static_cast<int32_t>(sample.tetrominoIndex) << "," << static_cast<int32_t>(sample.rotation)
+                 << "," << static_cast<int32_t>(sample.column) << "," << static_cast<int32_t>(sample.lineCount) << ","
+                 << sample.scoreDelta << "," << sample.game << "," << sample.piece << "\n";
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3 || (strcmp(argv[2], "info") != 0 && strcmp(argv[2], "dump") != 0))
+    {
+        cerr << "Usage: tetris_dataset <file> info | dump [first row] [row count]" << endl;
+        return 1;
+    }
+
+    DatasetReader reader;
+    if (!open_dataset(&reader, argv[1]))
+    {
+        cerr << "Could not open the dataset " << argv[1] << endl;
+        return 1;
+    }
+    int32_t result;
+    if (strcmp(argv[2], "info") == 0)
+    {
+        result = print_dataset_info(&reader);
+    }
+    else
+    {
+        uint64_t first = argc > 3 ? strtoull(argv[3], NULL, 10) : 0;
+        uint64_t count = argc > 4 ? strtoull(argv[4], NULL, 10) : reader.rowCount;
+        result = dump_dataset(&reader, first, count);
+    }
+    close_dataset(&reader);
+    return result;
+}
@@ -0,0 +1,136 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "../inc/leaderboard.h"
+
+/*
+Queries and fills a leaderboard written by the game or tetris_server.
+
+Usage: tetris_leaderboard <path> top [count] [first rank]
+       tetris_leaderboard <path> rank <score>
+       tetris_leaderboard <path> add <score> <level> <lines>
+       tetris_leaderboard <path> fill <count>   (random games, for benchmarking)
+*/
+
+/**
+ * @brief Prints the games at ranks first to first + count - 1
+ *
+ * @param board - pointer to Leaderboard to be queried
+ * @param first - rank of the first game, 0 for the best score
+ * @param count - number of games to print
+ */
+void print_top_scores(Leaderboard *board, uint64_t first, uint32_t count)
+{
+    std::vector<LeaderboardEntry> entries(count);
+    uint32_t found = get_top_scores(board, first, entries.data(), count);
+    for (uint32_t i = 0; i < found; i++)
+    {
+        cout << first + i + 1 << ". " << entries[i].score << " (level " << entries[i].level << ", "
+             << entries[i].lineCount << " lines, player " << entries[i].playerId << ")" << endl;
+    }
+    cout << get_leaderboard_size(board) << " games" << endl;
+}
+
+/**
+ * @brief Records count games with random results and reports the insert and query rates
+ *
+ * @param board - pointer to Leaderboard opened for writing
+ * @param count - number of games to record
+ * @return int32_t - 0 on success, 1 if an insert failed
+ */
+int32_t fill_leaderboard(Leaderboard *board, uint64_t count)
+{
+    uint32_t randomState = 0x9E3779B9;
+    LeaderboardEntry entry = {};
+    entry.time = static_cast<int64_t>(::time(NULL));
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < count; i++)
+    {
+        randomState ^= randomState << 13;
+        randomState ^= randomState >> 17;
+        randomState ^= randomState << 5;
+        entry.score = static_cast<int32_t>(randomState % 1000000);
+        entry.level = entry.score / 50000;
+        entry.lineCount = entry.score / 2000;
+        if (record_score(board, &entry) < 0)
+        {
+            cerr << "Could not record game " << i << endl;
+            return 1;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    cout << "Recorded " << count << " games in " << seconds << " s (" << count / seconds << " per second)" << endl;
+
+    const uint32_t queryCount = 1000000;
+    uint64_t checksum = 0;
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < queryCount; i++)
+    {
+        checksum += get_score_rank(board, static_cast<int32_t>((i * 2654435761u) % 1000000));
+    }
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    cout << "Ranked " << queryCount << " scores in " << seconds << " s (" << queryCount / seconds << " per second, checksum "
+         << checksum << ")" << endl;
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        cerr << "Usage: tetris_leaderboard <path> top [count] [first rank] | rank <score> | add <score> <level> <lines> | fill <count>" << endl;
+        return 1;
+    }
+
+    const char *command = argv[2];
+    bool readOnly = strcmp(command, "top") == 0 || strcmp(command, "rank") == 0;
+    Leaderboard board;
+    if (!open_leaderboard(&board, argv[1], readOnly))
+    {
+        cerr << "Could not open leaderboard " << argv[1] << endl;
+        return 1;
+    }
+
+    int32_t result = 0;
+    if (strcmp(command, "top") == 0)
+    {
+        uint32_t count = static_cast<uint32_t>(argc > 3 ? atoi(argv[3]) : 10);
+        uint64_t first = argc > 4 ? strtoull(argv[4], NULL, 10) - 1 : 0;
+        print_top_scores(&board, first, count);
+    }
+    else if (strcmp(command, "rank") == 0 && argc > 3)
+    {
+        int32_t score = atoi(argv[3]);
+        cout << "A score of " << score << " ranks " << get_score_rank(&board, score) + 1 << " of "
+             << get_leaderboard_size(&board) + 1 << endl;
+    }
+    else if (strcmp(command, "add") == 0 && argc > 5)
+    {
+        LeaderboardEntry entry = {};
+        entry.score = atoi(argv[3]);
+        entry.level = atoi(argv[4]);
+        entry.lineCount = atoi(argv[5]);
+        entry.time = static_cast<int64_t>(::time(NULL));
+        int64_t rank = record_score(&board, &entry);
+        if (rank < 0)
+        {
+            result = 1;
+        }
+        cout << "Ranked " << rank + 1 << " of " << get_leaderboard_size(&board) << endl;
+    }
+    else if (strcmp(command, "fill") == 0 && argc > 3)
+    {
+        result = fill_leaderboard(&board, strtoull(argv[3], NULL, 10));
+    }
+    else
+    {
+        cerr << "Unknown command " << command << endl;
+        result = 1;
+    }
+
+    close_leaderboard(&board);
+    return result;
+}
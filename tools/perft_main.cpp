@@ -0,0 +1,399 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../inc/placement.h"
+
+/*
+Counts the distinct boards reachable by placing a fixed sequence of pieces, like a chess
+perft. It is both a correctness oracle for engine optimizations (the counts and the
+checksum of a run must not change) and a benchmark of check_piece_valid(),
+merge_piece() and clear_lines().
+
+Usage: tetris_perft <pieces> <depth> [threads] [width] [board file]
+
+<pieces> is a sequence of IOTSZLJ letters, repeated if shorter than <depth>. The board
+is 14 (default) or 10 columns wide and starts empty, or with the cells marked # in the
+board file, whose last line is the bottom row.
+
+The search goes depth by depth. The boards of a depth are deduplicated in a transposition
+set, so a board reached by several orders of placements is only expanded once. Its
+PERFT_SHARDS shards are handed out to the threads as work items, and each thread inserts
+the boards it reaches into the set of the next depth under the lock of their shard.
+Boards are compared by occupancy, the colors of the cells are ignored. Placements that
+end the game are counted as game overs and reach no board.
+*/
+#define PERFT_SHARDS 256
+#define PERFT_SHARD_CAPACITY 1024 // Initial slots of a shard, doubled when half full
+
+const char PIECE_LETTERS[] = "IOTSZLJ"; // Letters of the tetrominos in TETROMINOS order
+
+template <typename Game>
+struct BoardKey
+{
+    typename Game::RowMask rows[Game::BOARD_HEIGHT];
+};
+
+// Open addressing hash set of boards, a zero hash marks an empty slot
+template <typename Game>
+struct TranspositionShard
+{
+    std::mutex mutex;
+    std::vector<uint64_t> hashes;
+    std::vector<BoardKey<Game> > keys;
+    size_t count;
+};
+
+template <typename Game>
+struct TranspositionSet
+{
+    TranspositionShard<Game> shards[PERFT_SHARDS];
+};
+
+// Counters of one thread over one depth
+struct PerftCounters
+{
+    uint64_t parents;
+    uint64_t placements;
+    uint64_t gameOvers;
+};
+
+template <typename Game>
+struct PerftJob
+{
+    const TranspositionSet<Game> *boards; // Boards of the current depth
+    TranspositionSet<Game> *children;     // Boards of the next depth
+    uint8_t tetrominoIndex;               // Piece placed on the boards of the current depth
+    std::atomic<uint32_t> nextShard;
+};
+
+/**
+ * @brief Hashes the occupancy of a board
+ *
+ * @param key - pointer to the board
+ * @return uint64_t - hash of the board, never 0
+ */
+template <typename Game>
+uint64_t hash_board(const BoardKey<Game> *key)
+{
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(key->rows);
+    uint64_t hash = 0x9E3779B97F4A7C15ull;
+    for (size_t offset = 0; offset < sizeof(key->rows); offset += 8)
+    {
+        uint64_t word = 0;
+        memcpy(&word, bytes + offset, sizeof(key->rows) - offset < 8 ? sizeof(key->rows) - offset : 8);
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 32;
+    }
+    return hash | 1;
+}
+
+/**
+ * @brief Empties every shard of a transposition set
+ *
+ * @param set - pointer to the set
+ */
+template <typename Game>
+void clear_transposition_set(TranspositionSet<Game> *set)
+{
+    for (uint32_t i = 0; i < PERFT_SHARDS; i++)
+    {
+        TranspositionShard<Game> *shard = &set->shards[i];
+        shard->hashes.assign(PERFT_SHARD_CAPACITY, 0);
+        shard->keys.resize(PERFT_SHARD_CAPACITY);
+        shard->count = 0;
+    }
+}
+
+/**
+ * @brief Inserts a board into a shard without locking or growing it
+ *
+ * @param shard - pointer to the shard, with a free slot
+ * @param key - pointer to the board
+ * @param hash - hash of the board
+ * @return true - the board was inserted
+ * @return false - the board was already in the shard
+ */
+template <typename Game>
+bool insert_shard_board(TranspositionShard<Game> *shard, const BoardKey<Game> *key, uint64_t hash)
+{
+    size_t mask = shard->hashes.size() - 1;
+    for (size_t slot = hash & mask;; slot = (slot + 1) & mask)
+    {
+        if (shard->hashes[slot] == 0)
+        {
+            shard->hashes[slot] = hash;
+            shard->keys[slot] = *key;
+            shard->count++;
+            return true;
+        }
+        if (shard->hashes[slot] == hash && memcmp(&shard->keys[slot], key, sizeof(*key)) == 0)
+        {
+            return false;
+        }
+    }
+}
+
+/**
+ * @brief Inserts a board into the transposition set, under the lock of its shard
+ *
+ * @param set - pointer to the set
+ * @param key - pointer to the board
+ */
+template <typename Game>
+void insert_board(TranspositionSet<Game> *set, const BoardKey<Game> *key)
+{
+    uint64_t hash = hash_board(key);
+    TranspositionShard<Game> *shard = &set->shards[hash >> 56];
+    std::lock_guard<std::mutex> lock(shard->mutex);
+
+    if ((shard->count + 1) * 2 > shard->hashes.size())
+    {
+        std::vector<uint64_t> hashes(shard->hashes.size() * 2, 0);
+        std::vector<BoardKey<Game> > keys(shard->hashes.size() * 2);
+        hashes.swap(shard->hashes);
+        keys.swap(shard->keys);
+        shard->count = 0;
+        for (size_t slot = 0; slot < hashes.size(); slot++)
+        {
+            if (hashes[slot])
+            {
+                insert_shard_board(shard, &keys[slot], hashes[slot]);
+            }
+        }
+    }
+    insert_shard_board(shard, key, hash);
+}
+
+/**
+ * @brief Perft thread. Takes shards of the current depth until none are left and places
+ * the piece in every reachable way on each of their boards.
+ *
+ * @param job - pointer to PerftJob shared by the threads
+ * @param counters - pointer to the counters of this thread
+ */
+template <typename Game>
+void expand_boards(PerftJob<Game> *job, PerftCounters *counters)
+{
+    // Only the occupancy masks are loaded, check_piece_valid() and find_lines() never read the cells
+    Game *parent = new Game();
+    Game *child = new Game();
+    std::vector<PieceState> placements;
+    PieceState spawn;
+    init_spawn_piece<Game>(&spawn, job->tetrominoIndex);
+
+    for (uint32_t i = job->nextShard++; i < PERFT_SHARDS; i = job->nextShard++)
+    {
+        const TranspositionShard<Game> *shard = &job->boards->shards[i];
+        for (size_t slot = 0; slot < shard->hashes.size(); slot++)
+        {
+            if (shard->hashes[slot] == 0)
+            {
+                continue;
+            }
+            memcpy(parent->rows, shard->keys[slot].rows, sizeof(parent->rows));
+            find_placements(parent, &spawn, &placements);
+            counters->parents++;
+            counters->placements += placements.size();
+
+            for (size_t p = 0; p < placements.size(); p++)
+            {
+                memcpy(child->rows, parent->rows, sizeof(child->rows));
+                if (place_piece(child, &placements[p]) < 0)
+                {
+                    counters->gameOvers++;
+                    continue;
+                }
+                BoardKey<Game> key;
+                memcpy(key.rows, child->rows, sizeof(key.rows));
+                insert_board(job->children, &key);
+            }
+        }
+    }
+
+    delete parent;
+    delete child;
+}
+
+/**
+ * @brief Reads the starting board, # marks a filled cell and the last line is the bottom row
+ *
+ * @param path - path of the board file
+ * @param key - receives the board
+ * @return true - the board was read
+ * @return false - the file could not be opened or does not fit the board
+ */
+template <typename Game>
+bool read_board(const char *path, BoardKey<Game> *key)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        return false;
+    }
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        lines.push_back(line);
+    }
+    if (lines.size() > static_cast<size_t>(Game::BOARD_VISIBLE_HEIGHT))
+    {
+        return false;
+    }
+
+    int32_t firstRow = Game::BOARD_HEIGHT - static_cast<int32_t>(lines.size());
+    for (size_t i = 0; i < lines.size(); i++)
+    {
+        for (size_t col = 0; col < lines[i].size(); col++)
+        {
+            if (lines[i][col] != '#')
+            {
+                continue;
+            }
+            if (col >= static_cast<size_t>(Game::BOARD_WIDTH))
+            {
+                return false;
+            }
+            typename Game::RowMask *row = &key->rows[firstRow + i];
+            *row = static_cast<typename Game::RowMask>(*row | (1u << col));
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Counts the distinct boards of every depth and prints them
+ *
+ * @param pieces - tetromino indices of the pieces, repeated if shorter than depth
+ * @param depth - number of pieces to place
+ * @param threadCount - number of threads
+ * @param boardPath - path of the starting board, or NULL for an empty board
+ * @return int32_t - 0 on success, 1 if the board could not be read
+ */
+template <typename Game>
+int32_t run_perft(const std::vector<uint8_t> &pieces, int32_t depth, int32_t threadCount, const char *boardPath)
+{
+    static_assert(sizeof(typename Game::RowMask) <= 4, "boards are read as integer row masks");
+    TranspositionSet<Game> *boards = new TranspositionSet<Game>();
+    TranspositionSet<Game> *children = new TranspositionSet<Game>();
+    clear_transposition_set(boards);
+
+    BoardKey<Game> root = {};
+    if (boardPath && !read_board(boardPath, &root))
+    {
+        cerr << "Could not read a " << Game::BOARD_WIDTH << " wide board from " << boardPath << endl;
+        delete boards;
+        delete children;
+        return 1;
+    }
+    insert_board(boards, &root);
+
+    uint64_t totalPlacements = 0;
+    uint64_t checksum = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (int32_t d = 0; d < depth; d++)
+    {
+        std::chrono::steady_clock::time_point depthStart = std::chrono::steady_clock::now();
+        clear_transposition_set(children);
+
+        PerftJob<Game> job;
+        job.boards = boards;
+        job.children = children;
+        job.tetrominoIndex = pieces[d % pieces.size()];
+        job.nextShard = 0;
+
+        std::vector<PerftCounters> counters(threadCount, PerftCounters());
+        std::vector<std::thread> threads;
+        for (int32_t i = 0; i < threadCount; i++)
+        {
+            threads.push_back(std::thread(expand_boards<Game>, &job, &counters[i]));
+        }
+        PerftCounters total = {};
+        for (int32_t i = 0; i < threadCount; i++)
+        {
+            threads[i].join();
+            total.parents += counters[i].parents;
+            total.placements += counters[i].placements;
+            total.gameOvers += counters[i].gameOvers;
+        }
+
+        uint64_t boardCount = 0;
+        checksum = 0;
+        for (uint32_t i = 0; i < PERFT_SHARDS; i++)
+        {
+            const TranspositionShard<Game> *shard = &children->shards[i];
+            boardCount += shard->count;
+            for (size_t slot = 0; slot < shard->hashes.size(); slot++)
+            {
+                checksum += shard->hashes[slot];
+            }
+        }
+        totalPlacements += total.placements;
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - depthStart).count();
+        cout << "depth " << d + 1 << " (" << PIECE_LETTERS[job.tetrominoIndex] << "): " << boardCount << " boards, "
+             << total.placements << " placements from " << total.parents << " boards, " << total.gameOvers
+             << " game overs, " << seconds << " s" << endl;
+
+        TranspositionSet<Game> *swap = boards;
+        boards = children;
+        children = swap;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    cout << "checksum " << std::hex << checksum << std::dec << ", " << totalPlacements << " placements in " << seconds
+         << " s (" << totalPlacements / seconds << " placements per second) with " << threadCount << " threads" << endl;
+
+    delete boards;
+    delete children;
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        cerr << "Usage: tetris_perft <pieces> <depth> [threads] [width] [board file]" << endl;
+        return 1;
+    }
+
+    std::vector<uint8_t> pieces;
+    for (const char *letter = argv[1]; *letter; letter++)
+    {
+        const char *found = strchr(PIECE_LETTERS, toupper(*letter));
+        if (!found)
+        {
+            cerr << "Unknown piece " << *letter << ", pieces are " << PIECE_LETTERS << endl;
+            return 1;
+        }
+        pieces.push_back(static_cast<uint8_t>(found - PIECE_LETTERS));
+    }
+    int32_t depth = atoi(argv[2]);
+    int32_t threadCount = argc > 3 ? atoi(argv[3]) : static_cast<int32_t>(std::thread::hardware_concurrency());
+    threadCount = threadCount < 1 ? 1 : threadCount;
+    int32_t width = argc > 4 ? atoi(argv[4]) : WIDTH;
+    const char *boardPath = argc > 5 ? argv[5] : NULL;
+    if (pieces.empty() || depth < 1)
+    {
+        cerr << "Expected at least one piece and a depth of at least 1" << endl;
+        return 1;
+    }
+
+    if (width == WIDTH)
+    {
+        return run_perft<GameState>(pieces, depth, threadCount, boardPath);
+    }
+    if (width == GameState10::BOARD_WIDTH)
+    {
+        return run_perft<GameState10>(pieces, depth, threadCount, boardPath);
+    }
+    cerr << "Boards are " << WIDTH << " or " << GameState10::BOARD_WIDTH << " columns wide" << endl;
+    return 1;
+}
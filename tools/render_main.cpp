@@ -0,0 +1,214 @@
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../inc/draw_list.h"
+#include "../inc/replay.h"
+#include "../inc/software_renderer.h"
+
+/*
+Renders every frame of a replay without a window, with the same layout as the game.
+
+Usage: tetris_render <replay> <output> [threads] [first frame] [last frame]
+
+An output of - streams raw RGB24 frames to stdout, e.g. into
+    ffmpeg -f rawvideo -pix_fmt rgb24 -s 420x720 -r 60 -i - clip.mp4
+any other output is a directory receiving one frame_NNNNNN.ppm image per frame. The
+frames default to the recorded game, from leaving the start screen to the end.
+
+The frames are cut into segments of RENDER_SEGMENT_FRAMES. A thread taking a segment
+copies the replay cursor at its start (the per-segment snapshot) and the shared cursor
+moves on to the next segment, so threads only replay their own segment. Rendered frames
+go through a reorder window of RENDER_WINDOW_SEGMENTS segments per thread and are
+written in order, so memory stays constant however long the replay is.
+*/
+#define RENDER_SEGMENT_FRAMES 16
+#define RENDER_WINDOW_SEGMENTS 2
+
+struct RenderJob
+{
+    const Replay *replay;
+    uint32_t firstFrame;
+    uint32_t lastFrame;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+
+    ReplayCursor cursor;       // At the start of the next segment to hand out
+    uint32_t nextSegmentFrame; // First frame of the next segment to hand out
+
+    std::vector<Framebuffer> window; // Frame f is rendered into window[f % window.size()]
+    std::vector<bool> ready;
+    uint32_t nextWriteFrame;
+    bool failed; // The output could not be written, workers stop
+};
+
+/**
+ * @brief Render thread. Takes segments until none are left and renders each frame of a
+ * segment into the reorder window once its slot has been written out.
+ *
+ * @param job - pointer to RenderJob shared by the threads
+ */
+void render_segments(RenderJob *job)
+{
+    RenderSnapshot<GameState> *snapshot = new RenderSnapshot<GameState>();
+    std::vector<DrawCommand> commands;
+    uint32_t windowSize = static_cast<uint32_t>(job->window.size());
+
+    while (true)
+    {
+        ReplayCursor cursor;
+        uint32_t first;
+        uint32_t last;
+        {
+            std::lock_guard<std::mutex> lock(job->mutex);
+            if (job->failed || job->nextSegmentFrame > job->lastFrame)
+            {
+                break;
+            }
+            cursor = job->cursor;
+            first = job->nextSegmentFrame;
+            last = std::min(first + RENDER_SEGMENT_FRAMES - 1, job->lastFrame);
+            while (job->cursor.frame <= last && step_replay(&job->cursor, job->replay))
+            {
+            }
+            job->nextSegmentFrame = last + 1;
+        }
+
+        for (uint32_t frame = first; frame <= last; frame++)
+        {
+            if (frame > first)
+            {
+                step_replay(&cursor, job->replay);
+            }
+            capture_render_snapshot(&cursor.game, frame, snapshot);
+            snapshot->leaderboardRank = -1;
+            build_draw_list(snapshot, &commands);
+
+            {
+                std::unique_lock<std::mutex> lock(job->mutex);
+                job->changed.wait(lock, [&] { return job->failed || frame < job->nextWriteFrame + windowSize; });
+                if (job->failed)
+                {
+                    break;
+                }
+            }
+            rasterize_draw_list(&job->window[frame % windowSize], &commands);
+            {
+                std::lock_guard<std::mutex> lock(job->mutex);
+                job->ready[frame % windowSize] = true;
+            }
+            job->changed.notify_all();
+        }
+    }
+    delete snapshot;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        cerr << "Usage: tetris_render <replay> <output> [threads] [first frame] [last frame]" << endl;
+        return 1;
+    }
+
+    Replay replay;
+    if (!read_replay(argv[1], &replay))
+    {
+        cerr << "Could not read replay " << argv[1] << endl;
+        return 1;
+    }
+
+    int32_t threadCount = argc > 3 ? atoi(argv[3]) : static_cast<int32_t>(std::thread::hardware_concurrency());
+    threadCount = threadCount < 1 ? 1 : threadCount;
+    uint32_t frameCount = static_cast<uint32_t>(replay.keys.size());
+    uint32_t firstFrame = argc > 4 ? static_cast<uint32_t>(atoi(argv[4])) : replay.gameStartFrame;
+    uint32_t lastFrame = argc > 5 ? static_cast<uint32_t>(atoi(argv[5])) : frameCount;
+    lastFrame = lastFrame > frameCount ? frameCount : lastFrame;
+    if (firstFrame > lastFrame)
+    {
+        cerr << "No frames to render" << endl;
+        return 1;
+    }
+
+    bool toStdout = strcmp(argv[2], "-") == 0;
+    RenderJob job;
+    job.replay = &replay;
+    job.firstFrame = firstFrame;
+    job.lastFrame = lastFrame;
+    init_replay_cursor(&job.cursor, &replay);
+    while (job.cursor.frame < firstFrame && step_replay(&job.cursor, &replay))
+    {
+    }
+    job.nextSegmentFrame = firstFrame;
+    job.window.resize(static_cast<size_t>(threadCount) * RENDER_SEGMENT_FRAMES * RENDER_WINDOW_SEGMENTS);
+    for (size_t i = 0; i < job.window.size(); i++)
+    {
+        init_framebuffer(&job.window[i], GameState::BOARD_WIDTH * GRID_SIZE, WINDOW_HEIGHT);
+    }
+    job.ready.assign(job.window.size(), false);
+    job.nextWriteFrame = firstFrame;
+    job.failed = false;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int32_t i = 0; i < threadCount; i++)
+    {
+        threads.push_back(std::thread(render_segments, &job));
+    }
+
+    // Write the frames in order as they become ready
+    uint32_t windowSize = static_cast<uint32_t>(job.window.size());
+    for (uint32_t frame = firstFrame; frame <= lastFrame; frame++)
+    {
+        {
+            std::unique_lock<std::mutex> lock(job.mutex);
+            job.changed.wait(lock, [&] { return job.ready[frame % windowSize]; });
+        }
+
+        bool written;
+        const Framebuffer *framebuffer = &job.window[frame % windowSize];
+        if (toStdout)
+        {
+            written = write_framebuffer(stdout, framebuffer, false);
+        }
+        else
+        {
+            char name[32];
+            snprintf(name, sizeof(name), "/frame_%06u.ppm", frame);
+            std::string path = std::string(argv[2]) + name;
+            FILE *file = fopen(path.c_str(), "wb");
+            written = file && write_framebuffer(file, framebuffer, true);
+            written = file && fclose(file) == 0 && written;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(job.mutex);
+            job.ready[frame % windowSize] = false;
+            job.nextWriteFrame += written ? 1 : 0;
+            job.failed = !written;
+        }
+        job.changed.notify_all();
+        if (!written)
+        {
+            cerr << "Could not write frame " << frame << endl;
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < threads.size(); i++)
+    {
+        threads[i].join();
+    }
+    fflush(stdout);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint32_t rendered = job.nextWriteFrame - firstFrame;
+    cerr << "Rendered " << rendered << " frames in " << seconds << " s (" << rendered / seconds << " per second) on "
+         << threadCount << " threads" << endl;
+    return job.failed ? 1 : 0;
+}
@@ -0,0 +1,70 @@
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include "../inc/server.h"
+
+/**
+ * @brief Stops the server on SIGINT/SIGTERM
+ *
+ * @param signal - received signal
+ */
+void handle_signal(int signal)
+{
+    (void)signal;
+    stop_server();
+}
+
+/*
+Usage: tetris_server [port] [workers] [spectator port] [cold store path] [idle frames]
+
+With a cold store path, games idle on the start or game over screen are paged out to
+memory-mapped files <path>.<worker> and restored on their next input. Set
+TETRIS_PAUSE_IDLE=1 to also page out (and pause) idle games in play. Set
+TETRIS_LEADERBOARD=<path> to record every finished game in a persistent leaderboard, and
+TETRIS_REPLAYS=<directory> to save a replay of every finished game for tetris_render. Set
+TETRIS_TELEMETRY=<path> to export gameplay counters in the Prometheus text format every
+TELEMETRY_EXPORT_SECONDS.
+*/
+int main(int argc, char **argv)
+{
+    ServerConfig config;
+    init_server_config(&config);
+    if (argc > 1)
+    {
+        config.port = static_cast<uint16_t>(atoi(argv[1]));
+        config.spectatorPort = static_cast<uint16_t>(config.port + 1);
+    }
+    if (argc > 2)
+    {
+        config.workerCount = atoi(argv[2]);
+    }
+    if (argc > 3)
+    {
+        config.spectatorPort = static_cast<uint16_t>(atoi(argv[3]));
+    }
+    if (argc > 4)
+    {
+        config.coldStorePath = argv[4];
+    }
+    if (argc > 5)
+    {
+        config.idleFrames = static_cast<uint32_t>(atoi(argv[5]));
+    }
+    const char *pauseIdle = getenv("TETRIS_PAUSE_IDLE");
+    config.pauseIdleGames = pauseIdle && atoi(pauseIdle) != 0;
+    config.leaderboardPath = getenv("TETRIS_LEADERBOARD");
+    config.replayPath = getenv("TETRIS_REPLAYS");
+    config.telemetryPath = getenv("TETRIS_TELEMETRY");
+
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+
+    cout << "Hosting games on port " << config.port << " (spectators on " << config.spectatorPort << ") with "
+         << config.workerCount << " workers" << endl;
+    int32_t result = run_server(&config);
+    if (result != 0)
+    {
+        cerr << "Could not start the server" << endl;
+    }
+    return result;
+}
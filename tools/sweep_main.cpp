@@ -0,0 +1,227 @@
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <unistd.h>
+#include "../inc/sweep.h"
+
+/*
+Plays a batch of bot games across threads, checkpointing the whole run so it can be
+resumed after being stopped or preempted.
+
+Usage: tetris_sweep run <checkpoint> <games> [threads] [lanes] [seed] [max pieces]
+       tetris_sweep resume <checkpoint> [threads]
+       tetris_sweep show <checkpoint>
+
+The run is checkpointed every SWEEP_CHECKPOINT_SECONDS (TETRIS_CHECKPOINT_SECONDS
+overrides it) and when it ends or receives SIGINT/SIGTERM. A resumed run ends with the
+same results and checksum as an uninterrupted one, with any number of threads. The
+number of lanes is fixed for the whole run and bounds the number of threads.
+
+Set TETRIS_EVAL_CACHE=<path> to share the decisions of the bot with every other run
+through a persistent evaluation cache (eval_cache.h). The cache never changes a decision,
+so the results and checksum are the same with or without it.
+
+Set TETRIS_DATASET=<path> to record every decision of the bot as a training sample
+(dataset.h). A run creates the file, a resume keeps the samples up to its checkpoint and
+appends to it. Resuming without the file starts a new one holding only the resumed games.
+*/
+
+static Sweep *runningSweep = NULL;
+
+/**
+ * @brief Stops the running sweep on SIGINT/SIGTERM, it then writes its final checkpoint
+ *
+ * @param signal - received signal
+ */
+void handle_signal(int signal)
+{
+    (void)signal;
+    if (runningSweep)
+    {
+        stop_sweep(runningSweep);
+    }
+}
+
+/**
+ * @brief Prints the results of the lanes of a sweep
+ *
+ * @param sweep - pointer to the sweep
+ */
+void print_sweep(const Sweep *sweep)
+{
+    SweepResults results;
+    get_sweep_results(sweep->lanes, &results);
+    double games = results.games > 0 ? static_cast<double>(results.games) : 1.0;
+    cout << results.games << " of " << sweep->gameCount << " games (" << results.cappedGames << " stopped at "
+         << sweep->maxPieces << " pieces), average score " << results.score / games << ", lines " << results.lines / games
+         << ", pieces " << results.pieces / games << ", best score " << results.bestScore << ", best level "
+         << results.bestLevel << ", checksum " << std::hex << results.checksum << std::dec << endl;
+}
+
+/**
+ * @brief Runs a sweep until it is done or stopped and prints its results
+ *
+ * @param sweep - pointer to the new or restored sweep
+ * @param path - path of the checkpoint file
+ * @param threadCount - number of threads
+ * @param resume - the sweep was restored from its checkpoint, so its dataset is appended to
+ * @return int32_t - 0 if the final checkpoint was written, 1 otherwise
+ */
+int32_t run_sweep_tool(Sweep *sweep, const char *path, uint32_t threadCount, bool resume)
+{
+    const char *seconds = getenv("TETRIS_CHECKPOINT_SECONDS");
+    uint32_t checkpointSeconds = seconds ? static_cast<uint32_t>(atoi(seconds)) : SWEEP_CHECKPOINT_SECONDS;
+
+    EvalCache cache;
+    const char *cachePath = getenv("TETRIS_EVAL_CACHE");
+    if (cachePath)
+    {
+        if (!open_eval_cache(&cache, cachePath, false, EVAL_CACHE_DEFAULT_CAPACITY))
+        {
+            cerr << "Could not open the evaluation cache " << cachePath << endl;
+            return 1;
+        }
+        sweep->cache = &cache;
+    }
+
+    DatasetWriter *dataset = NULL;
+    const char *datasetPath = getenv("TETRIS_DATASET");
+    if (datasetPath)
+    {
+        dataset = new DatasetWriter();
+        bool opened;
+        if (resume && access(datasetPath, F_OK) == 0)
+        {
+            opened = resume_sweep_dataset(sweep, dataset, datasetPath);
+        }
+        else
+        {
+            if (resume)
+            {
+                cerr << "No dataset " << datasetPath << " to resume, the games before the checkpoint are not in the new one"
+                     << endl;
+            }
+            opened = open_dataset_writer(dataset, datasetPath);
+        }
+        if (!opened)
+        {
+            cerr << "Could not " << (resume ? "resume" : "create") << " the dataset " << datasetPath << endl;
+            delete dataset;
+            if (sweep->cache)
+            {
+                sweep->cache = NULL;
+                close_eval_cache(&cache);
+            }
+            return 1;
+        }
+        sweep->dataset = dataset;
+    }
+
+    runningSweep = sweep;
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+
+    SweepResults before;
+    get_sweep_results(sweep->lanes, &before);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool written = run_sweep(sweep, threadCount, path, checkpointSeconds);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    runningSweep = NULL;
+
+    SweepResults after;
+    get_sweep_results(sweep->lanes, &after);
+    cout << after.games - before.games << " games and " << after.pieces - before.pieces << " pieces in " << elapsed
+         << " s (" << (after.pieces - before.pieces) / elapsed << " pieces per second)" << endl;
+    print_sweep(sweep);
+    if (sweep->cache)
+    {
+        uint64_t hits = sweep->cacheHits.load();
+        uint64_t lookups = hits + sweep->cacheMisses.load();
+        cout << "Evaluation cache: " << hits << " hits of " << lookups << " lookups ("
+             << (lookups ? 100.0 * hits / lookups : 0.0) << "%), " << count_eval_cache(sweep->cache) << " entries" << endl;
+        sweep->cache = NULL;
+        close_eval_cache(&cache);
+    }
+    if (dataset)
+    {
+        uint64_t rowCount = dataset->rowCount;
+        uint64_t size = dataset->offset;
+        sweep->dataset = NULL;
+        if (!close_dataset_writer(dataset))
+        {
+            cerr << "Could not write the dataset " << datasetPath << endl;
+            written = false;
+        }
+        else
+        {
+            cout << "Dataset: " << rowCount << " samples, " << size << " bytes ("
+                 << (rowCount ? static_cast<double>(size) / rowCount : 0.0) << " bytes per sample)" << endl;
+        }
+        delete dataset;
+    }
+    if (!written)
+    {
+        cerr << "Could not write the checkpoint " << path << endl;
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t hardwareThreads = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+    Sweep *sweep = new Sweep();
+    int32_t result = 1;
+
+    if (argc > 3 && strcmp(argv[1], "run") == 0)
+    {
+        uint64_t gameCount = strtoull(argv[3], NULL, 10);
+        uint32_t threadCount = argc > 4 ? static_cast<uint32_t>(atoi(argv[4])) : hardwareThreads;
+        uint32_t laneCount = argc > 5 ? static_cast<uint32_t>(atoi(argv[5])) : 256;
+        uint64_t seed = argc > 6 ? strtoull(argv[6], NULL, 10) : 1;
+        uint32_t maxPieces = argc > 7 ? static_cast<uint32_t>(atoi(argv[7])) : 1000;
+        if (laneCount == 0 || maxPieces == 0)
+        {
+            cerr << "Expected at least one lane and one piece per game" << endl;
+        }
+        else
+        {
+            init_sweep(sweep, seed, gameCount, laneCount, maxPieces);
+            result = run_sweep_tool(sweep, argv[2], threadCount, false);
+        }
+    }
+    else if (argc > 2 && strcmp(argv[1], "resume") == 0)
+    {
+        uint32_t threadCount = argc > 3 ? static_cast<uint32_t>(atoi(argv[3])) : hardwareThreads;
+        if (!read_sweep_checkpoint(argv[2], sweep))
+        {
+            cerr << "Could not read the checkpoint " << argv[2] << endl;
+        }
+        else
+        {
+            result = run_sweep_tool(sweep, argv[2], threadCount, true);
+        }
+    }
+    else if (argc > 2 && strcmp(argv[1], "show") == 0)
+    {
+        if (!read_sweep_checkpoint(argv[2], sweep))
+        {
+            cerr << "Could not read the checkpoint " << argv[2] << endl;
+        }
+        else
+        {
+            print_sweep(sweep);
+            result = 0;
+        }
+    }
+    else
+    {
+        cerr << "Usage: tetris_sweep run <checkpoint> <games> [threads] [lanes] [seed] [max pieces] | resume <checkpoint> [threads] | show <checkpoint>"
+             << endl;
+    }
+
+    delete sweep;
+    return result;
+}
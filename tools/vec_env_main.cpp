@@ -0,0 +1,141 @@
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include "../inc/vec_env.h"
+
+/*
+Hosts a vectorized environment in shared memory, or drives one like a trainer would.
+
+Usage: tetris_vec_env host <name> [envs] [ring size] [frame skip]
+       tetris_vec_env bench <name> [steps]
+
+bench attaches to a running host, answers every step with random keys and reports the
+step rate. A trainer in another language maps /dev/shm/<name> the same way: read
+VecEnvHeader, wait on observationSequence, read the observations at observationOffset,
+write actions at actionOffset and store step + 1 into actionSequence (then FUTEX_WAKE it).
+*/
+
+static VecEnv *hostEnv = NULL;
+
+/**
+ * @brief Shuts the hosted environment down on SIGINT/SIGTERM
+ *
+ * @param signal - received signal
+ */
+void handle_signal(int signal)
+{
+    (void)signal;
+    if (hostEnv)
+    {
+        shutdown_vec_env(hostEnv);
+    }
+}
+
+/**
+ * @brief Hosts the games until the environment is shut down
+ *
+ * @param name - name of the shared memory object
+ * @param envCount - number of games
+ * @param ringSize - number of observation slots
+ * @param frameSkip - frames each action is held for
+ * @return int32_t - 0 on a clean shutdown, 1 if the environment could not be created
+ */
+int32_t host_vec_env(const char *name, uint32_t envCount, uint32_t ringSize, uint32_t frameSkip)
+{
+    VecEnvHost *host = new VecEnvHost();
+    if (envCount == 0 || ringSize == 0 || frameSkip == 0 || !create_vec_env(&host->env, name, envCount, ringSize, frameSkip))
+    {
+        cerr << "Could not create environment " << name << endl;
+        delete host;
+        return 1;
+    }
+    init_vec_env_host(host, static_cast<uint32_t>(time(NULL)));
+
+    hostEnv = &host->env;
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+    cout << "Hosting " << envCount << " games in /dev/shm" << name << " (ring of " << ringSize << ", frame skip "
+         << frameSkip << ")" << endl;
+
+    uint32_t steps = run_vec_env_host(host);
+    cout << "Stopped after " << steps << " steps" << endl;
+
+    hostEnv = NULL;
+    close_vec_env(&host->env);
+    unlink_vec_env(name);
+    delete host;
+    return 0;
+}
+
+/**
+ * @brief Plays random keys against a hosted environment and reports the step rate
+ *
+ * @param name - name of the shared memory object
+ * @param steps - number of steps to run
+ * @return int32_t - 0 on success, 1 if the environment could not be attached or shut down early
+ */
+int32_t bench_vec_env(const char *name, uint32_t steps)
+{
+    VecEnv env;
+    if (!attach_vec_env(&env, name))
+    {
+        cerr << "Could not attach to environment " << name << endl;
+        return 1;
+    }
+
+    uint32_t envCount = env.header->envCount;
+    uint32_t first = env.header->observationSequence.load() - 1;
+    uint32_t randomState = 0x9E3779B9;
+    uint64_t episodes = 0;
+    int64_t lines = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    uint32_t step = first;
+    for (; step < first + steps; step++)
+    {
+        if (!wait_observations(&env, step))
+        {
+            break;
+        }
+        const VecObservation *observations = get_observations(&env, step);
+        uint8_t *actions = get_actions(&env, step);
+        for (uint32_t i = 0; i < envCount; i++)
+        {
+            episodes += observations[i].done;
+            lines += observations[i].lineDelta;
+
+            randomState ^= randomState << 13;
+            randomState ^= randomState >> 17;
+            randomState ^= randomState << 5;
+            actions[i] = static_cast<uint8_t>(randomState & (INPUT_KEY_LEFT | INPUT_KEY_RIGHT | INPUT_KEY_UP | INPUT_KEY_DOWN));
+        }
+        submit_actions(&env, step);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint32_t stepped = step - first;
+    cout << stepped << " steps of " << envCount << " games in " << seconds << " s (" << stepped / seconds << " steps, "
+         << stepped * static_cast<double>(envCount) / seconds << " game steps per second), " << episodes << " games over, "
+         << lines << " lines" << endl;
+    close_vec_env(&env);
+    return stepped == steps ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 2 && strcmp(argv[1], "host") == 0)
+    {
+        uint32_t envCount = static_cast<uint32_t>(argc > 3 ? atoi(argv[3]) : 256);
+        uint32_t ringSize = static_cast<uint32_t>(argc > 4 ? atoi(argv[4]) : 4);
+        uint32_t frameSkip = static_cast<uint32_t>(argc > 5 ? atoi(argv[5]) : 1);
+        return host_vec_env(argv[2], envCount, ringSize, frameSkip);
+    }
+    if (argc > 2 && strcmp(argv[1], "bench") == 0)
+    {
+        return bench_vec_env(argv[2], static_cast<uint32_t>(argc > 3 ? atoi(argv[3]) : 100000));
+    }
+
+    cerr << "Usage: tetris_vec_env host <name> [envs] [ring size] [frame skip] | bench <name> [steps]" << endl;
+    return 1;
+}
@@ -0,0 +1,116 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include "../inc/rollback.h"
+
+/*
+Plays one peer of a versus match over UDP with rollback netcode, pressing scripted random
+keys in real time at 60 frames per second.
+
+Usage: tetris_versus <local port> <remote port> <player> [frames] [latency ms] [loss %] [seed] [remote address]
+
+Start the other peer with the ports swapped and the other player. Latency and loss are
+added to the packets this peer sends, so two peers on loopback with 50 ms each see a
+100 ms round trip. Once both peers have confirmed the last frame, each prints its
+rollback statistics and the checksum of the match at the last frame, which must be the
+same on both.
+*/
+#define VERSUS_LINGER_TICKS 60 // Ticks spent acknowledging the remote after the last frame
+
+/**
+ * @brief Picks the scripted keys of a frame: random keys held for a few frames at a time
+ *
+ * @param randomState - pointer to the generator of the player
+ * @param heldKeys - pointer to the keys currently held
+ * @param holdFrames - pointer to the number of frames left to hold them
+ * @return uint8_t - packed InputKey bits
+ */
+uint8_t get_scripted_keys(uint32_t *randomState, uint8_t *heldKeys, uint32_t *holdFrames)
+{
+    if (*holdFrames == 0)
+    {
+        uint32_t x = *randomState;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        *randomState = x;
+        const uint8_t KEYS[] = {0, INPUT_KEY_LEFT, INPUT_KEY_RIGHT, INPUT_KEY_UP, INPUT_KEY_DOWN, INPUT_KEY_A, INPUT_KEY_B};
+        *heldKeys = KEYS[x % ARRAY_COUNT(KEYS)];
+        *holdFrames = 1 + (x >> 8) % 12;
+    }
+    (*holdFrames)--;
+    return *heldKeys;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 4)
+    {
+        cerr << "Usage: tetris_versus <local port> <remote port> <player> [frames] [latency ms] [loss %] [seed] [remote address]" << endl;
+        return 1;
+    }
+    uint16_t localPort = static_cast<uint16_t>(atoi(argv[1]));
+    uint16_t remotePort = static_cast<uint16_t>(atoi(argv[2]));
+    int32_t player = atoi(argv[3]);
+    uint32_t frames = argc > 4 ? static_cast<uint32_t>(atoi(argv[4])) : 1800;
+    uint32_t seed = argc > 7 ? static_cast<uint32_t>(atoi(argv[7])) : 1;
+    const char *remoteAddress = argc > 8 ? argv[8] : "127.0.0.1";
+
+    RollbackSession *session = new RollbackSession();
+    session->link.latencyMilliseconds = argc > 5 ? static_cast<uint32_t>(atoi(argv[5])) : 50;
+    session->link.lossPercent = argc > 6 ? static_cast<uint32_t>(atoi(argv[6])) : 0;
+    if (!open_rollback_session(session, localPort, remoteAddress, remotePort, player, seed))
+    {
+        cerr << "Could not open the session on port " << localPort << endl;
+        delete session;
+        return 1;
+    }
+
+    uint32_t randomState = seed * 2654435761u + static_cast<uint32_t>(player) * 40503u + 1;
+    uint8_t heldKeys = 0;
+    uint32_t holdFrames = 0;
+    uint8_t keys = get_scripted_keys(&randomState, &heldKeys, &holdFrames);
+    uint32_t lingerTicks = 0;
+    auto frameDuration = std::chrono::nanoseconds(static_cast<int64_t>(TARGET_SECONDS_PER_FRAME * 1e9));
+    auto nextTick = std::chrono::steady_clock::now();
+    while (lingerTicks < VERSUS_LINGER_TICKS)
+    {
+        if (session->state.frame < frames)
+        {
+            // The keys of a frame are only consumed once it is simulated, stalls keep them held
+            if (advance_rollback_session(session, keys))
+            {
+                keys = get_scripted_keys(&randomState, &heldKeys, &holdFrames);
+            }
+        }
+        else
+        {
+            poll_rollback_session(session);
+            if (get_confirmed_frame(session) >= frames && session->remoteAck >= frames)
+            {
+                lingerTicks++;
+            }
+        }
+        nextTick += frameDuration;
+        std::this_thread::sleep_until(nextTick);
+    }
+
+    const RollbackStats *stats = &session->stats;
+    double rollbacks = stats->rollbacks > 0 ? static_cast<double>(stats->rollbacks) : 1.0;
+    cout << "Player " << player << ": " << frames << " frames, winner " << session->state.winner << ", " << stats->rollbacks
+         << " rollbacks (" << stats->resimulatedFrames / rollbacks << " frames on average, " << stats->maxRollbackFrames
+         << " at most), " << stats->stalledTicks << " stalled ticks, " << stats->syncTicks << " sync ticks, "
+         << stats->packetsSent << " packets sent (" << stats->packetsLost << " lost), " << stats->packetsReceived
+         << " received" << endl;
+    if (session->desynced)
+    {
+        cout << "Desync at frame " << session->desyncFrame << endl;
+    }
+    cout << "Checksum " << std::hex << hash_versus_state(&session->state) << std::dec << endl;
+
+    bool desynced = session->desynced;
+    close_rollback_session(session);
+    delete session;
+    return desynced ? 1 : 0;
+}